@@ -0,0 +1,93 @@
+/*
+ *  This file is owned by the Embedded Systems Laboratory of Seoul National University of Science and Technology
+ *  to benchmark Xenomai and RT_PREEMPT
+ *
+ *  Benchmark scenarios selectable from the command line, e.g. ./start.sh ipc
+*/
+#ifndef _BENCH_H_
+#define _BENCH_H_
+/*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+/*****************************************************************************/
+#include <embdCOMMON.h>
+#include <rt_tasks.h>
+#include <rt_itc.h>
+#include <rt_hist.h>
+#include <rt_probe.h>
+/*****************************************************************************/
+#define BENCH_FILE_PATH "./results/"
+#define BENCH_FILE_EXT ".dat"
+#define BENCH_META_SIZE (8192)
+#define BENCH_CLOCK_ENV "RT_BENCH_CLOCK" // clock name or "auto", default monotonic
+#define BENCH_CPU_AUTO (-1) // let bench_select_cpu() pick the quietest cpu
+#define BENCH_SIM_ENV "RT_BENCH_SIM" // overheads of the sim backend, "ctx=2000,wake=5000,jitter=1000,read=20,seed=1" ns
+#define BENCH_WAIT_SEC (1) // longest futex wait of bench_wait_done(), a quit lost before it
+#define BENCH_QUIT_GRACE (3) // such waits after a quit before a task is given up
+
+/* set by SIGINT/SIGTERM, every scenario should stop measuring when raised */
+extern volatile FLAG bBenchQuit;
+/* probe calibration of this run, see bench_calibrate() */
+extern RT_PROBE_CAL BenchProbe;
+/*****************************************************************************/
+/* common helpers */
+/*****************************************************************************/
+/* signals, mlockall, host profile, clock selection and probe calibration on
+ * the cpu the scenario uses */
+void bench_init(int cpu);
+int bench_num_cpus(void);
+/* blocks until another thread raises the flag with bench_signal_done(),
+ * -ETIMEDOUT when the task did not finish BENCH_QUIT_GRACE s after a quit */
+int bench_wait_done(volatile int *done);
+void bench_signal_done(volatile int *done);
+/* raises bBenchQuit and wakes bench_wait_done(), async-signal-safe */
+void bench_quit(void);
+/* opens ./results/<name>_<k>.dat with the first free k, filename may be NULL.
+ * The run metadata is written first as "# key: value" lines. */
+FILE* bench_open_result(char *name, char *filename, int size);
+/* run metadata, a "key: value" line replaces the previous one of that key */
+void bench_meta(const char *fmt, ...);
+char* bench_meta_text(void);
+void bench_write_meta(FILE *fp);
+/* measures the rt_timer_read() probes on cpu and records them as metadata */
+int bench_calibrate(int cpu);
+/* switches the task clock to $RT_BENCH_CLOCK, "auto" characterizes every
+ * source on cpu first and takes the cheapest trustworthy one */
+int bench_clock_init(int cpu);
+/* host profile into the metadata, holds /dev/cpu_dma_latency until exit */
+int bench_host_init(void);
+/* overheads of the sim backend from $RT_BENCH_SIM into the metadata, then
+ * the model statistics at the end of a run; nothing on other backends */
+int bench_sim_init(void);
+void bench_sim_report(void);
+/* scheduler statistics of the calling thread for a response time
+ * decomposition: -1 from bench_sched_open() when the backend has none (sim,
+ * Xenomai primary mode). A sample costs three system calls. */
+typedef struct {
+	uint64_t run; // ns on the cpu, CLOCK_THREAD_CPUTIME_ID
+	uint64_t wait; // ns runnable on a run queue, /proc/thread-self/schedstat
+	long nvcsw; // voluntary switches: sleeps, blocking on a mutex
+	long nivcsw; // involuntary switches: preemptions
+}BENCH_SCHED;
+int bench_sched_open(void);
+int bench_sched_sample(int fd, BENCH_SCHED *s);
+/* BENCH_CPU_AUTO: the quietest cpu (isolated, nohz_full, fewest interrupts) */
+int bench_select_cpu(int cpu);
+/* the rank-th quietest cpu, wraps around */
+int bench_quiet_cpu(int rank);
+/*****************************************************************************/
+/* scenarios */
+/*****************************************************************************/
+int bench_ipc_main(int argc, char **argv);
+int bench_pipeline_main(int argc, char **argv);
+int bench_cyclic_main(int argc, char **argv);
+int bench_forkjoin_main(int argc, char **argv);
+int bench_clock_main(int argc, char **argv);
+int bench_sporadic_main(int argc, char **argv);
+int bench_crpd_main(int argc, char **argv);
+int bench_global_main(int argc, char **argv);
+int bench_exchange_main(int argc, char **argv);
+int bench_suite_main(int argc, char **argv);
+int bench_compare_main(int argc, char **argv);
+#endif // _BENCH_H_
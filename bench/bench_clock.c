@@ -0,0 +1,479 @@
+/*
+ *  Time source characterization.
+ *
+ *  Every clock the benchmarks could run on is read back to back from a
+ *  pinned RT task and, for every other cpu, in a ping-pong with a second
+ *  pinned RT task. Per source we report
+ *    read : average cost of one read
+ *    res  : clock_getres() and the smallest non-zero step actually observed
+ *    viol : reads going backwards on one cpu / across cpus
+ *    skew : largest cross-core offset (t_b - (t_a1 + t_a2) / 2) of the
+ *           fastest round trip, +- half that round trip
+ *  A source is trustworthy without violations, with a resolution and skew
+ *  below 1 us, and for the TSC only if it is invariant. The cheapest
+ *  trustworthy clock that can be slept on is the one to select at runtime
+ *  with RT_BENCH_CLOCK (see bench_clock_init()).
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CLK_HAVE_TSC
+#endif
+/*****************************************************************************/
+#define CLK_PRIO		(99)
+#define CLK_SAMPLES		(100000)
+#define CLK_ROUNDS		(2000) // ping-pongs per cpu pair
+#define CLK_LOOP		(1000) // reads per averaging loop
+#define CLK_MAX_RES		(1000) // ns, trustworthy bound
+#define CLK_MAX_SKEW	(1000) // ns, trustworthy bound
+#define CLK_TSC_CAL_US	(100000)
+#define CLK_AUTO_SAMPLES (10000)
+#define CLK_AUTO_ROUNDS	(200)
+
+typedef enum {
+	CLK_VDSO = 0, // clock_gettime(), served by the vDSO when the kernel can
+	CLK_SYSCALL, // forced system call
+	CLK_TSC
+}CLK_READ;
+
+typedef struct {
+	char *name;
+	clockid_t id;
+	CLK_READ read;
+	/* results */
+	FLAG avail;
+	FLAG sleepable;
+	FLAG trusted;
+	double scale; // ns per raw unit
+	double read_avg;
+	uint64_t getres;
+	uint64_t observed_res;
+	uint64_t zero_deltas;
+	uint64_t violations;
+	uint64_t cross_violations;
+	int64_t skew;
+	uint64_t skew_err;
+	RT_HIST delta;
+}CLK_SOURCE;
+
+typedef struct {
+	CLK_SOURCE *src;
+	int samples;
+	int rounds;
+	volatile uint64_t seq; // ping-pong round, odd: a -> b, even: b -> a
+	volatile uint64_t t_b;
+	uint64_t violations;
+	uint64_t best_rtt;
+	int64_t offset;
+	volatile int abort;
+	volatile int done_a;
+	volatile int done_b;
+}CLK_RUN;
+/*****************************************************************************/
+static CLK_SOURCE ClkSources[] = {
+	{"monotonic",			CLOCK_MONOTONIC,		CLK_VDSO},
+	{"monotonic_syscall",	CLOCK_MONOTONIC,		CLK_SYSCALL},
+	{"monotonic_raw",		CLOCK_MONOTONIC_RAW,	CLK_VDSO},
+	{"monotonic_coarse",	CLOCK_MONOTONIC_COARSE,	CLK_VDSO},
+	{"boottime",			CLOCK_BOOTTIME,			CLK_VDSO},
+	{"tsc",					0,						CLK_TSC},
+	{NULL}
+};
+#define CLK_NSOURCES (sizeof(ClkSources) / sizeof(ClkSources[0]) - 1)
+
+static CLK_RUN Run;
+/*****************************************************************************/
+static inline uint64_t _clk_read(CLK_SOURCE *src)
+{
+	struct timespec ts;
+
+	switch (src->read) {
+#ifdef CLK_HAVE_TSC
+		case CLK_TSC:
+			return __rdtsc();
+#endif
+		case CLK_SYSCALL:
+			syscall(SYS_clock_gettime, src->id, &ts);
+			break;
+		default:
+			clock_gettime(src->id, &ts);
+			break;
+	}
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+/*****************************************************************************/
+/* TSC usable as a clock: constant rate and not stopped in idle states */
+static FLAG _clk_tsc_invariant(void)
+{
+	char line[4096];
+	FLAG constant = off, nonstop = off;
+	FILE *fp;
+
+	fp = fopen("/proc/cpuinfo", "r");
+	if (fp == NULL)
+		return off;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (strncmp(line, "flags", 5) != 0)
+			continue;
+		constant = (strstr(line, " constant_tsc") != NULL) ? on : off;
+		nonstop = (strstr(line, " nonstop_tsc") != NULL) ? on : off;
+		break;
+	}
+	fclose(fp);
+	return (constant == on && nonstop == on) ? on : off;
+}
+/*****************************************************************************/
+static void _clk_probe(CLK_SOURCE *src)
+{
+	struct timespec ts;
+	uint64_t c0, c1, t0, t1;
+
+	src->avail = off;
+	src->sleepable = off;
+	src->scale = 1.0;
+	src->getres = 0;
+
+	if (src->read == CLK_TSC) {
+#ifdef CLK_HAVE_TSC
+		clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+		t0 = (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+		c0 = __rdtsc();
+		usleep(CLK_TSC_CAL_US);
+		clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+		t1 = (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+		c1 = __rdtsc();
+		if (c1 > c0) {
+			src->scale = (double)(t1 - t0) / (double)(c1 - c0);
+			src->getres = (src->scale < 1.0) ? 1 : (uint64_t)(src->scale + 0.5);
+			src->avail = on;
+		}
+#endif
+		return;
+	}
+
+	if (clock_getres(src->id, &ts) != 0)
+		return;
+	src->getres = (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+	src->avail = on;
+	/* only the libc path can back pt_timer_read() */
+	if (src->read == CLK_VDSO) {
+		ts.tv_sec = 0;
+		ts.tv_nsec = 0;
+		src->sleepable = (clock_nanosleep(src->id, TIMER_ABSTIME, &ts, NULL) == 0) ? on : off;
+	}
+}
+/*****************************************************************************/
+/* back to back reads on one cpu */
+/*****************************************************************************/
+static void ClkLocalTask(void *arg)
+{
+	CLK_RUN *run = arg;
+	CLK_SOURCE *src = run->src;
+	struct timespec ts0, ts1;
+	uint64_t t0, t1, d;
+	int i;
+
+	for (i = 0; i < CLK_LOOP; ++i)
+		_clk_read(src);
+
+	src->observed_res = UINT64_MAX;
+	for (i = 0; i < run->samples && bBenchQuit == off; ++i) {
+		t0 = _clk_read(src);
+		t1 = _clk_read(src);
+		if (t1 < t0) {
+			src->violations++;
+			continue;
+		}
+		d = (uint64_t)((t1 - t0) * src->scale);
+		add_rt_hist(&src->delta, d);
+		if (d == 0)
+			src->zero_deltas++;
+		else if (d < src->observed_res)
+			src->observed_res = d;
+	}
+	if (src->observed_res == UINT64_MAX)
+		src->observed_res = 0;
+
+	/* the average is taken on CLOCK_MONOTONIC, whatever the source is */
+	clock_gettime(CLOCK_MONOTONIC, &ts0);
+	for (i = 0; i < CLK_LOOP; ++i)
+		_clk_read(src);
+	clock_gettime(CLOCK_MONOTONIC, &ts1);
+	src->read_avg = (double)(((uint64_t)ts1.tv_sec * NSEC_PER_SEC + ts1.tv_nsec)
+			- ((uint64_t)ts0.tv_sec * NSEC_PER_SEC + ts0.tv_nsec)) / CLK_LOOP;
+
+	bench_signal_done(&run->done_a);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* cross-core ping-pong, a stamps and hands over to b which stamps and hands
+ * back: t_a1 <= t_b <= t_a2 has to hold for a globally monotonic clock */
+/*****************************************************************************/
+static void ClkPingTask(void *arg)
+{
+	CLK_RUN *run = arg;
+	CLK_SOURCE *src = run->src;
+	uint64_t t1, t2, tb, r;
+
+	run->best_rtt = UINT64_MAX;
+	for (r = 0; r < run->rounds && run->abort == 0; ++r) {
+		if (bBenchQuit == on) {
+			run->abort = 1;
+			break;
+		}
+		t1 = _clk_read(src);
+		__atomic_store_n(&run->seq, 2 * r + 1, __ATOMIC_RELEASE);
+		while (__atomic_load_n(&run->seq, __ATOMIC_ACQUIRE) != 2 * r + 2 && run->abort == 0)
+			cpu_relax();
+		if (run->abort)
+			break;
+		t2 = _clk_read(src);
+		tb = run->t_b;
+
+		if (tb < t1 || t2 < tb)
+			run->violations++;
+		if (t2 >= t1 && t2 - t1 < run->best_rtt) {
+			run->best_rtt = t2 - t1;
+			run->offset = (int64_t)tb - (int64_t)(t1 + (t2 - t1) / 2);
+		}
+	}
+	bench_signal_done(&run->done_a);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void ClkPongTask(void *arg)
+{
+	CLK_RUN *run = arg;
+	uint64_t r;
+
+	for (r = 0; r < run->rounds && run->abort == 0; ++r) {
+		while (__atomic_load_n(&run->seq, __ATOMIC_ACQUIRE) != 2 * r + 1 && run->abort == 0)
+			cpu_relax();
+		run->t_b = _clk_read(run->src);
+		__atomic_store_n(&run->seq, 2 * r + 2, __ATOMIC_RELEASE);
+	}
+	bench_signal_done(&run->done_b);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static int _clk_cross(CLK_SOURCE *src, int cpu, int other, int rounds)
+{
+	RT_TASK ping, pong;
+	int64_t skew;
+
+	memset(&Run, 0, sizeof(Run));
+	Run.src = src;
+	Run.rounds = rounds;
+
+	if (create_rt_task(&pong, "clk_pong", CLK_PRIO) != 0 || create_rt_task(&ping, "clk_ping", CLK_PRIO) != 0)
+		return -1;
+	set_rt_task_affinity(&pong, other);
+	set_rt_task_affinity(&ping, cpu);
+	if (start_rt_task_arg(1, &pong, &ClkPongTask, &Run) != 0)
+		return -1;
+	if (start_rt_task_arg(1, &ping, &ClkPingTask, &Run) != 0) {
+		Run.abort = 1;
+		bench_wait_done(&Run.done_b);
+		return -1;
+	}
+	if (bench_wait_done(&Run.done_a) != 0 || bench_wait_done(&Run.done_b) != 0)
+		return -1;
+
+	src->cross_violations += Run.violations;
+	if (Run.best_rtt == UINT64_MAX)
+		return 0;
+	skew = (int64_t)(Run.offset * src->scale);
+	if (llabs(skew) > llabs(src->skew)) {
+		src->skew = skew;
+		src->skew_err = (uint64_t)(Run.best_rtt * src->scale / 2);
+	}
+	return 0;
+}
+/*****************************************************************************/
+static void _clk_measure(CLK_SOURCE *src, int cpu, int samples, int rounds)
+{
+	RT_TASK task;
+	int k, ncpu = bench_num_cpus();
+
+	init_rt_hist(&src->delta, src->name);
+	src->read_avg = 0;
+	src->observed_res = 0;
+	src->zero_deltas = 0;
+	src->violations = 0;
+	src->cross_violations = 0;
+	src->skew = 0;
+	src->skew_err = 0;
+	src->trusted = off;
+
+	_clk_probe(src);
+	if (src->avail == off)
+		return;
+
+	memset(&Run, 0, sizeof(Run));
+	Run.src = src;
+	Run.samples = samples;
+	if (create_rt_task(&task, "clk_local", CLK_PRIO) != 0)
+		return;
+	set_rt_task_affinity(&task, cpu);
+	if (start_rt_task_arg(1, &task, &ClkLocalTask, &Run) != 0 || bench_wait_done(&Run.done_a) != 0)
+		return;
+
+	for (k = 0; k < ncpu && bBenchQuit == off; ++k)
+		if (k != cpu)
+			_clk_cross(src, cpu, k, rounds);
+
+	src->trusted = (src->violations == 0 && src->cross_violations == 0
+			&& src->observed_res <= CLK_MAX_RES && src->getres <= CLK_MAX_RES
+			&& (uint64_t)llabs(src->skew) <= CLK_MAX_SKEW + src->skew_err) ? on : off;
+	if (src->read == CLK_TSC && _clk_tsc_invariant() == off)
+		src->trusted = off;
+}
+/*****************************************************************************/
+static CLK_SOURCE* _clk_find(char *name)
+{
+	int i;
+
+	for (i = 0; ClkSources[i].name != NULL; ++i)
+		if (strcmp(ClkSources[i].name, name) == 0)
+			return &ClkSources[i];
+	return NULL;
+}
+/*****************************************************************************/
+/* cheapest trustworthy clock the tasks can sleep on */
+static CLK_SOURCE* _clk_best(void)
+{
+	CLK_SOURCE *best = NULL;
+	int i;
+
+	for (i = 0; ClkSources[i].name != NULL; ++i) {
+		if (ClkSources[i].trusted == off || ClkSources[i].sleepable == off)
+			continue;
+		if (best == NULL || ClkSources[i].read_avg < best->read_avg)
+			best = &ClkSources[i];
+	}
+	return best;
+}
+/*****************************************************************************/
+int bench_clock_init(int cpu)
+{
+	char *name = getenv(BENCH_CLOCK_ENV);
+	CLK_SOURCE *src;
+	int i, ret;
+
+	if (name == NULL || name[0] == '\0')
+		name = "monotonic";
+
+	if (strcmp(name, "auto") == 0) {
+		for (i = 0; ClkSources[i].name != NULL && bBenchQuit == off; ++i)
+			_clk_measure(&ClkSources[i], cpu, CLK_AUTO_SAMPLES, CLK_AUTO_ROUNDS);
+		src = _clk_best();
+		if (src == NULL) {
+			fprintf(stderr, "[CLOCK] no trustworthy clock found, staying on monotonic\n");
+			src = _clk_find("monotonic");
+		}
+	} else {
+		src = _clk_find(name);
+		if (src != NULL)
+			_clk_probe(src);
+		if (src == NULL || src->sleepable == off) {
+			fprintf(stderr, "[CLOCK] %s cannot drive the task timers\n", name);
+			return -EINVAL;
+		}
+	}
+
+	ret = set_rt_clock(src->id);
+	if (ret != 0) {
+		fprintf(stderr, "[CLOCK] cannot switch to %s (%d)\n", src->name, ret);
+		return ret;
+	}
+	bench_meta("clock: %s", src->name);
+	return 0;
+}
+/*****************************************************************************/
+static void _clk_usage(void)
+{
+	printf("usage: clock [-s source] [-n samples] [-r rounds] [-c cpu]\n");
+}
+/*****************************************************************************/
+int bench_clock_main(int argc, char **argv)
+{
+	char *only = NULL;
+	char filename[256];
+	RT_HIST *hists[CLK_NSOURCES];
+	int samples = CLK_SAMPLES, rounds = CLK_ROUNDS, cpu = BENCH_CPU_AUTO;
+	int c, i, nhists = 0;
+	CLK_SOURCE *src;
+	FILE *fp;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "s:n:r:c:h")) != -1) {
+		switch (c) {
+			case 's': only = optarg; break;
+			case 'n': samples = atoi(optarg); break;
+			case 'r': rounds = atoi(optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			default: _clk_usage(); return 1;
+		}
+	}
+	cpu = bench_select_cpu(cpu);
+
+	bench_init(cpu);
+	fp = bench_open_result("clock_summary", filename, sizeof(filename));
+	if (fp == NULL)
+		return 1;
+	fprintf(fp, "# source,read_ns,delta_p50_ns,delta_p99_ns,getres_ns,observed_res_ns,zero_deltas,violations,cross_violations,skew_ns,skew_err_ns,sleepable,trusted\n");
+
+	printf("Clock sources on cpu %d, %d samples, %d ping-pongs per cpu pair\n", cpu, samples, rounds);
+	printf("%-18s %8s %8s %8s %8s %8s %6s %6s %16s %s\n", "[ns]", "read", "p50", "p99",
+			"getres", "res", "viol", "xviol", "skew", "");
+	for (i = 0; ClkSources[i].name != NULL && bBenchQuit == off; ++i) {
+		src = &ClkSources[i];
+		if (only != NULL && strcmp(only, src->name) != 0)
+			continue;
+		_clk_measure(src, cpu, samples, rounds);
+		if (src->avail == off) {
+			printf("%-18s not available\n", src->name);
+			continue;
+		}
+		printf("%-18s %8.1f %8lu %8lu %8lu %8lu %6lu %6lu %8ld+-%-6lu %s%s\n", src->name, src->read_avg,
+				(unsigned long)get_rt_hist_percentile(&src->delta, 50),
+				(unsigned long)get_rt_hist_percentile(&src->delta, 99),
+				(unsigned long)src->getres, (unsigned long)src->observed_res,
+				(unsigned long)src->violations, (unsigned long)src->cross_violations,
+				(long)src->skew, (unsigned long)src->skew_err,
+				src->trusted == on ? "trusted" : "untrusted",
+				src->sleepable == on ? "" : ", no timers");
+		fprintf(fp, "%s,%.1f,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%ld,%lu,%d,%d\n", src->name, src->read_avg,
+				(unsigned long)get_rt_hist_percentile(&src->delta, 50),
+				(unsigned long)get_rt_hist_percentile(&src->delta, 99),
+				(unsigned long)src->getres, (unsigned long)src->observed_res,
+				(unsigned long)src->zero_deltas, (unsigned long)src->violations,
+				(unsigned long)src->cross_violations, (long)src->skew, (unsigned long)src->skew_err,
+				src->sleepable == on, src->trusted == on);
+		hists[nhists++] = &src->delta;
+	}
+	if (bench_num_cpus() == 1)
+		printf("[CLOCK] only one cpu online, cross-core checks skipped\n");
+
+	src = _clk_best();
+	if (src != NULL) {
+		printf("Cheapest trustworthy clock: %s (RT_BENCH_CLOCK=%s or =auto)\n", src->name, src->name);
+		fprintf(fp, "# recommended: %s\n", src->name);
+	}
+	fclose(fp);
+
+	fp = bench_open_result("clock_hist", NULL, 0);
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, nhists);
+		fclose(fp);
+	}
+	printf("Clock summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
@@ -0,0 +1,264 @@
+/*****************************************************************************/
+#define _GNU_SOURCE // RUSAGE_THREAD
+#include <bench.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#ifndef _XENOMAI_TASKS_
+#include <rt_sim.h>
+#endif
+/*****************************************************************************/
+volatile FLAG bBenchQuit = off;
+RT_PROBE_CAL BenchProbe;
+
+static char BenchMeta[BENCH_META_SIZE];
+static int BenchMetaLen = 0;
+static volatile int *BenchWaiting = NULL; // flag of bench_wait_done()
+/*****************************************************************************/
+static void _bench_signal_handler(int signum)
+{
+	bench_quit();
+}
+/*****************************************************************************/
+void bench_init(int cpu)
+{
+	signal(SIGTERM, _bench_signal_handler);
+	signal(SIGINT, _bench_signal_handler);
+	mlockall(MCL_CURRENT|MCL_FUTURE);
+	bench_host_init();
+	bench_meta("rt_cpu: %d", cpu);
+	bench_meta("backend: %s", get_rt_backend());
+	bench_sim_init();
+	bench_clock_init(cpu);
+	bench_calibrate(cpu);
+}
+/*****************************************************************************/
+int bench_num_cpus(void)
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	return (ncpu > 0) ? (int)ncpu : 1;
+}
+/*****************************************************************************/
+/* the waiter sleeps on the flag itself and a quit wakes it, the timeout only
+ * catches a quit between the check and the wait */
+int bench_wait_done(volatile int *done)
+{
+	struct timespec tmo = {BENCH_WAIT_SEC, 0};
+	int grace = BENCH_QUIT_GRACE;
+
+	BenchWaiting = done;
+	while (__atomic_load_n(done, __ATOMIC_ACQUIRE) == 0) {
+		if (bBenchQuit == on && grace-- == 0) {
+			BenchWaiting = NULL;
+			fprintf(stderr, "[BENCH] a task did not stop after the quit, not waited for\n");
+			return -ETIMEDOUT;
+		}
+		syscall(SYS_futex, (int *)done, FUTEX_WAIT_PRIVATE, 0, &tmo, NULL, 0);
+	}
+	BenchWaiting = NULL;
+	return 0;
+}
+/*****************************************************************************/
+void bench_signal_done(volatile int *done)
+{
+	__atomic_store_n(done, 1, __ATOMIC_RELEASE);
+	syscall(SYS_futex, (int *)done, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+/*****************************************************************************/
+void bench_quit(void)
+{
+	volatile int *done = BenchWaiting;
+
+	bBenchQuit = on;
+	if (done != NULL)
+		syscall(SYS_futex, (int *)done, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+/*****************************************************************************/
+FILE* bench_open_result(char *name, char *filename, int size)
+{
+	char path[256];
+	FILE *fp;
+	int k = 1;
+
+	while (1) {
+		snprintf(path, sizeof(path), "%s%s_%d%s", BENCH_FILE_PATH, name, k++, BENCH_FILE_EXT);
+		if (access(path, F_OK) == -1)
+			break;
+	}
+
+	fp = fopen(path, "w");
+	if (fp == NULL) {
+		perror(path);
+		return NULL;
+	}
+	if (filename != NULL)
+		snprintf(filename, size, "%s", path);
+	bench_write_meta(fp);
+	return fp;
+}
+/*****************************************************************************/
+void bench_meta(const char *fmt, ...)
+{
+	char line[1024];
+	char *old, *end;
+	va_list args;
+	int len, key;
+
+	len = snprintf(line, sizeof(line), "# ");
+	va_start(args, fmt);
+	vsnprintf(line + len, sizeof(line) - len, fmt, args);
+	va_end(args);
+
+	/* "key: value" replaces an earlier line of the same key */
+	end = strchr(line, ':');
+	if (end != NULL) {
+		key = end - line + 1;
+		for (old = BenchMeta; *old != '\0'; old = end + 1) {
+			end = strchr(old, '\n');
+			if (end == NULL)
+				break;
+			if (strncmp(old, line, key) == 0) {
+				memmove(old, end + 1, BenchMeta + BenchMetaLen - end);
+				BenchMetaLen -= end + 1 - old;
+				break;
+			}
+		}
+	}
+
+	len = snprintf(BenchMeta + BenchMetaLen, BENCH_META_SIZE - BenchMetaLen, "%s\n", line);
+	BenchMetaLen += len;
+	if (BenchMetaLen >= BENCH_META_SIZE) {
+		BenchMetaLen = BENCH_META_SIZE - 2;
+		BenchMeta[BenchMetaLen++] = '\n';
+		BenchMeta[BenchMetaLen] = '\0';
+	}
+}
+/*****************************************************************************/
+char* bench_meta_text(void)
+{
+	return BenchMeta;
+}
+/*****************************************************************************/
+void bench_write_meta(FILE *fp)
+{
+	fputs(BenchMeta, fp);
+}
+/*****************************************************************************/
+int bench_calibrate(int cpu)
+{
+	int ret;
+
+	ret = calibrate_rt_probe(&BenchProbe, cpu, PROBE_SAMPLES);
+	if (ret != 0) {
+		fprintf(stderr, "[BENCH] probe calibration failed on cpu %d (%d)\n", cpu, ret);
+		return ret;
+	}
+	/* format_rt_probe_cal() already prefixes every line */
+	if (BenchMetaLen < BENCH_META_SIZE)
+		BenchMetaLen += format_rt_probe_cal(BenchMeta + BenchMetaLen, BENCH_META_SIZE - BenchMetaLen, &BenchProbe);
+	if (BenchMetaLen >= BENCH_META_SIZE)
+		BenchMetaLen = BENCH_META_SIZE - 1;
+
+	printf("Probe calibration on cpu %d: read %.1f ns, back-to-back p50 %lu ns p99 %lu ns, resolution %lu ns\n",
+			cpu, BenchProbe.read_avg, (unsigned long)BenchProbe.delta_p50,
+			(unsigned long)BenchProbe.delta_p99, (unsigned long)BenchProbe.resolution);
+	return 0;
+}
+/*****************************************************************************/
+int bench_sim_init(void)
+{
+#ifndef _XENOMAI_TASKS_
+	PT_SIM_OVERHEAD ovh = {0, 0, 0, 0, 1};
+	char *env = getenv(BENCH_SIM_ENV), *item, *save, buf[256];
+	unsigned long value;
+	char key[16];
+
+	if (PtBackend->simulated == off)
+		return 0;
+	if (env != NULL) {
+		snprintf(buf, sizeof(buf), "%s", env);
+		for (item = strtok_r(buf, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+			if (sscanf(item, "%15[^=]=%lu", key, &value) != 2) {
+				fprintf(stderr, "[BENCH] %s: '%s' is not key=ns\n", BENCH_SIM_ENV, item);
+				return -1;
+			}
+			if (strcmp(key, "ctx") == 0) ovh.ctx = value;
+			else if (strcmp(key, "wake") == 0) ovh.wake = value;
+			else if (strcmp(key, "jitter") == 0) ovh.jitter = value;
+			else if (strcmp(key, "read") == 0) ovh.read = value;
+			else if (strcmp(key, "seed") == 0) ovh.seed = value;
+			else {
+				fprintf(stderr, "[BENCH] %s: unknown overhead '%s'\n", BENCH_SIM_ENV, key);
+				return -1;
+			}
+		}
+	}
+	pt_sim_set_overhead(&ovh);
+	bench_meta("sim_overhead_ns: ctx=%lu,wake=%lu,jitter=%lu,read=%lu,seed=%u", (unsigned long)ovh.ctx,
+			(unsigned long)ovh.wake, (unsigned long)ovh.jitter, (unsigned long)ovh.read, ovh.seed);
+#endif
+	return 0;
+}
+/*****************************************************************************/
+void bench_sim_report(void)
+{
+#ifndef _XENOMAI_TASKS_
+	PT_SIM_STATS st;
+
+	if (PtBackend->simulated == off)
+		return;
+	pt_sim_get_stats(&st);
+	bench_meta("sim_stats: switches=%lu,preemptions=%lu,blocked=%lu,boosts=%lu", (unsigned long)st.switches,
+			(unsigned long)st.preemptions, (unsigned long)st.blocked, (unsigned long)st.boosts);
+	printf("Simulated: %lu switches, %lu preemptions, %lu blocked acquisitions, %lu priority boosts\n",
+			(unsigned long)st.switches, (unsigned long)st.preemptions, (unsigned long)st.blocked,
+			(unsigned long)st.boosts);
+#endif
+}
+/*****************************************************************************/
+int bench_sched_open(void)
+{
+#ifndef _XENOMAI_TASKS_
+	/* the virtual clock of the model has nothing to do with the threads */
+	if (PtBackend->simulated == on)
+		return -1;
+	return open("/proc/thread-self/schedstat", O_RDONLY | O_CLOEXEC);
+#else
+	return -1;
+#endif
+}
+/*****************************************************************************/
+/* schedstat is "run_ns wait_ns timeslices", its run time is only brought up
+ * to date at ticks and switches, the thread cpu clock is exact */
+int bench_sched_sample(int fd, BENCH_SCHED *s)
+{
+	unsigned long long run, wait;
+	struct timespec ts;
+	struct rusage ru;
+	char buf[96];
+	ssize_t n;
+
+	n = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+	if (sscanf(buf, "%llu %llu", &run, &wait) != 2)
+		return -1;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	getrusage(RUSAGE_THREAD, &ru);
+	s->run = (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+	s->wait = wait;
+	s->nvcsw = ru.ru_nvcsw;
+	s->nivcsw = ru.ru_nivcsw;
+	return 0;
+}
+/*****************************************************************************/
@@ -0,0 +1,505 @@
+/*
+ *  Comparison of test runs and tail latency regression gate.
+ *
+ *  A run is the set of per-task sample files of the periodicity/preemption
+ *  test with one run number, <task><test>_<N>sec_<k>.dat, so `compare 1 4`
+ *  compares run 4 against run 1 and `compare base/1 4 5` compares runs 4
+ *  and 5 against run 1 kept in the directory base. Files are aligned by
+ *  task and test name. The files are mapped and parsed in chunks by a pool
+ *  of threads, meta lines are skipped.
+ *  Per task the percentile deltas of one column (response time by default)
+ *  are reported together with the two-sample Kolmogorov-Smirnov test (any
+ *  change of the distribution) and the Mann-Whitney U test (one run
+ *  stochastically larger). With millions of samples both tests flag tiny
+ *  shifts, so a task regresses only when the gated tail percentile (or the
+ *  maximum) grows beyond its threshold AND the KS test rejects at alpha.
+ *  The exit status is 2 on a regression, 1 on errors, so it can gate kernel
+ *  and BIOS updates in a script.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <math.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+/*****************************************************************************/
+#define CMP_MAX_TASKS	(16) // files per run
+#define CMP_MAX_RUNS	(16)
+#define CMP_CHUNK		(4 << 20) // bytes parsed by one work item
+#define CMP_MIN_LINE	(20) // shortest sample line, bounds a chunk's samples
+#define CMP_TAIL		(99.0) // gated percentile
+#define CMP_TAIL_PCT	(10.0) // allowed growth of the tail percentile
+#define CMP_ALPHA		(0.01)
+
+static char *CmpColumns[] = {"prd", "resp", "jit", NULL};
+
+typedef struct {
+	char key[128]; // task and test name
+	char path[512];
+	int64_t *samples; // ns, sorted once loaded
+	size_t count;
+	char *meta; // the leading # lines
+}CMP_FILE;
+
+typedef struct {
+	char *name;
+	CMP_FILE files[CMP_MAX_TASKS];
+	int nfiles;
+}CMP_RUN;
+
+typedef struct {
+	CMP_FILE *file;
+	const char *begin, *end; // the chunk in the mapping
+	int64_t *samples;
+	size_t count;
+}CMP_CHUNK_JOB;
+/*****************************************************************************/
+static CMP_RUN Runs[CMP_MAX_RUNS];
+static int nruns;
+static int column = 1;
+static CMP_CHUNK_JOB *Jobs;
+static int njobs;
+static int NextJob = 0;
+/*****************************************************************************/
+/* "3.000123" jiffies (ms) with up to 6 decimals to ns */
+static int64_t _cmp_parse_ms(const char **pos, const char *end)
+{
+	const char *p = *pos;
+	int64_t ms = 0, frac = 0;
+	int digits = 0;
+
+	while (p < end && *p >= '0' && *p <= '9')
+		ms = ms * 10 + (*p++ - '0');
+	if (p < end && *p == '.')
+		for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+			if (digits < 6) {
+				frac = frac * 10 + (*p - '0');
+				++digits;
+			}
+	for (; digits < 6; ++digits)
+		frac *= 10;
+	*pos = p;
+	return ms * NSEC_PER_MSEC + frac;
+}
+/*****************************************************************************/
+static void _cmp_parse_chunk(CMP_CHUNK_JOB *job)
+{
+	const char *p = job->begin, *eol;
+	int i;
+
+	while (p < job->end) {
+		eol = memchr(p, '\n', job->end - p);
+		if (eol == NULL)
+			eol = job->end;
+		if (*p != '#' && *p != '\n') {
+			for (i = 0; i < column && p < eol; ++i) {
+				p = memchr(p, ',', eol - p);
+				p = (p == NULL) ? eol : p + 1;
+			}
+			if (p < eol)
+				job->samples[job->count++] = _cmp_parse_ms(&p, eol);
+		}
+		p = eol + 1;
+	}
+}
+/*****************************************************************************/
+static void* _cmp_worker(void *arg)
+{
+	int k;
+
+	while ((k = __atomic_fetch_add(&NextJob, 1, __ATOMIC_RELAXED)) < njobs)
+		_cmp_parse_chunk(&Jobs[k]);
+	return NULL;
+}
+/*****************************************************************************/
+static int _cmp_sort(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+/*****************************************************************************/
+static int _cmp_key(const void *a, const void *b)
+{
+	return strcmp(((const CMP_FILE *)a)->key, ((const CMP_FILE *)b)->key);
+}
+/*****************************************************************************/
+/* maps every file, splits them at line ends into chunks for the pool */
+static int _cmp_load(int threads)
+{
+	CMP_CHUNK_JOB *job, *grown;
+	pthread_t tid[64];
+	struct stat st;
+	char **maps;
+	size_t *sizes;
+	int r, f, n, k, fd, nfiles = 0, ret = 0;
+	FLAG oom = off;
+
+	for (r = 0; r < nruns; ++r)
+		nfiles += Runs[r].nfiles;
+	maps = calloc(nfiles, sizeof(char *));
+	sizes = calloc(nfiles, sizeof(size_t));
+	if (maps == NULL || sizes == NULL) {
+		fprintf(stderr, "[COMPARE] out of memory for %d files\n", nfiles);
+		free(maps);
+		free(sizes);
+		return -1;
+	}
+	Jobs = NULL;
+	njobs = 0;
+
+	for (r = 0, n = 0; r < nruns && oom == off; ++r)
+		for (f = 0; f < Runs[r].nfiles && oom == off; ++f, ++n) {
+			CMP_FILE *file = &Runs[r].files[f];
+			const char *p, *end, *meta;
+
+			fd = open(file->path, O_RDONLY);
+			if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+				fprintf(stderr, "[COMPARE] cannot read %s\n", file->path);
+				if (fd >= 0)
+					close(fd);
+				ret = -1;
+				continue;
+			}
+			maps[n] = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (maps[n] == MAP_FAILED) {
+				perror(file->path);
+				maps[n] = NULL;
+				ret = -1;
+				continue;
+			}
+			sizes[n] = st.st_size;
+			madvise(maps[n], sizes[n], MADV_SEQUENTIAL);
+
+			/* meta lines are few and at the top, kept for the comparison */
+			end = maps[n] + sizes[n];
+			for (meta = p = maps[n]; p < end && *p == '#'; ) {
+				p = memchr(p, '\n', end - p);
+				p = (p == NULL) ? end : p + 1;
+			}
+			file->meta = strndup(meta, p - meta);
+
+			grown = realloc(Jobs, (njobs + sizes[n] / CMP_CHUNK + 1) * sizeof(CMP_CHUNK_JOB));
+			if (grown == NULL) {
+				oom = on;
+				break;
+			}
+			Jobs = grown;
+			while (p < end) {
+				job = &Jobs[njobs];
+				job->file = file;
+				job->begin = p;
+				job->end = (end - p > CMP_CHUNK) ? p + CMP_CHUNK : end;
+				if (job->end < end) {
+					p = memchr(job->end, '\n', end - job->end);
+					job->end = (p == NULL) ? end : p + 1;
+				}
+				p = job->end;
+				job->samples = malloc((job->end - job->begin) / CMP_MIN_LINE * sizeof(int64_t) + sizeof(int64_t));
+				job->count = 0;
+				if (job->samples == NULL) {
+					oom = on;
+					break;
+				}
+				++njobs;
+			}
+		}
+	if (oom == off) {
+		if (threads > (int)(sizeof(tid) / sizeof(tid[0])))
+			threads = sizeof(tid) / sizeof(tid[0]);
+		if (threads > njobs)
+			threads = njobs;
+		NextJob = 0;
+		for (k = 1; k < threads; ++k)
+			if (pthread_create(&tid[k], NULL, _cmp_worker, NULL) != 0)
+				threads = k;
+		_cmp_worker(NULL);
+		for (k = 1; k < threads; ++k)
+			pthread_join(tid[k], NULL);
+	}
+
+	/* the chunks of every file back to back in file order */
+	for (r = 0; r < nruns && oom == off; ++r)
+		for (f = 0; f < Runs[r].nfiles && oom == off; ++f) {
+			CMP_FILE *file = &Runs[r].files[f];
+			size_t count = 0;
+
+			for (k = 0; k < njobs; ++k)
+				if (Jobs[k].file == file)
+					count += Jobs[k].count;
+			file->samples = malloc(count * sizeof(int64_t) + sizeof(int64_t));
+			file->count = 0;
+			if (file->samples == NULL) {
+				oom = on;
+				break;
+			}
+			for (k = 0; k < njobs; ++k)
+				if (Jobs[k].file == file) {
+					memcpy(file->samples + file->count, Jobs[k].samples, Jobs[k].count * sizeof(int64_t));
+					file->count += Jobs[k].count;
+				}
+			qsort(file->samples, file->count, sizeof(int64_t), _cmp_sort);
+		}
+
+	if (oom == on) {
+		fprintf(stderr, "[COMPARE] out of memory\n");
+		ret = -1;
+	}
+	for (k = 0; k < njobs; ++k)
+		free(Jobs[k].samples);
+	free(Jobs);
+	for (n = 0; n < nfiles; ++n)
+		if (maps[n] != NULL)
+			munmap(maps[n], sizes[n]);
+	free(maps);
+	free(sizes);
+	return ret;
+}
+/*****************************************************************************/
+/* "[dir/]k": every <key>_<N>sec_<k>.dat in dir (default ./results/) */
+static int _cmp_find_run(CMP_RUN *run, char *spec)
+{
+	char dir[256], *slash, *name, *sec;
+	struct dirent *ent;
+	DIR *dp;
+	int k, len;
+
+	slash = strrchr(spec, '/');
+	if (slash != NULL)
+		snprintf(dir, sizeof(dir), "%.*s", (int)(slash - spec + 1), spec);
+	else
+		snprintf(dir, sizeof(dir), "%s", BENCH_FILE_PATH);
+	k = atoi(slash != NULL ? slash + 1 : spec);
+
+	run->name = spec;
+	run->nfiles = 0;
+	dp = opendir(dir);
+	if (dp == NULL) {
+		perror(dir);
+		return -1;
+	}
+	while ((ent = readdir(dp)) != NULL && run->nfiles < CMP_MAX_TASKS) {
+		name = ent->d_name;
+		len = strlen(name);
+		if (len < 5 || strcmp(name + len - 4, BENCH_FILE_EXT) != 0)
+			continue;
+		/* ..._<N>sec_<k>.dat */
+		sec = strstr(name, "sec_");
+		if (sec == NULL || atoi(sec + 4) != k || strspn(sec + 4, "0123456789") != (size_t)(name + len - 4 - sec - 4))
+			continue;
+		while (sec > name && sec[-1] >= '0' && sec[-1] <= '9')
+			--sec;
+		if (sec == name || sec[-1] != '_')
+			continue;
+		snprintf(run->files[run->nfiles].key, sizeof(run->files[0].key), "%.*s", (int)(sec - 1 - name), name);
+		snprintf(run->files[run->nfiles].path, sizeof(run->files[0].path), "%s%s", dir, name);
+		run->nfiles++;
+	}
+	closedir(dp);
+	if (run->nfiles == 0) {
+		fprintf(stderr, "[COMPARE] no sample files of run %d in %s\n", k, dir);
+		return -1;
+	}
+	qsort(run->files, run->nfiles, sizeof(CMP_FILE), _cmp_key);
+	return 0;
+}
+/*****************************************************************************/
+static int64_t _cmp_percentile(CMP_FILE *f, double q)
+{
+	size_t i = (size_t)ceil(q / 100.0 * f->count);
+
+	if (f->count == 0)
+		return 0;
+	if (i < 1)
+		i = 1;
+	if (i > f->count)
+		i = f->count;
+	return f->samples[i - 1];
+}
+/*****************************************************************************/
+/* asymptotic Kolmogorov distribution, P(D > d) */
+static double _cmp_ks_prob(double lambda)
+{
+	double sum = 0, term, sign = 1;
+	int j;
+
+	if (lambda < 0.2)
+		return 1.0;
+	for (j = 1; j <= 100; ++j) {
+		term = sign * exp(-2.0 * j * j * lambda * lambda);
+		sum += term;
+		if (fabs(term) < 1e-12 * fabs(sum))
+			break;
+		sign = -sign;
+	}
+	sum *= 2.0;
+	return sum < 0 ? 0 : (sum > 1 ? 1 : sum);
+}
+/*****************************************************************************/
+/* both tests in one merge of the sorted samples. *d: KS statistic, *p_ks,
+ * *p_mw: two sided p-values, *p_greater: P(new > base) */
+static void _cmp_tests(CMP_FILE *base, CMP_FILE *next, double *d, double *p_ks,
+		double *p_mw, double *p_greater)
+{
+	double n1 = base->count, n2 = next->count, nn = n1 + n2;
+	double rank = 0, r1 = 0, ties = 0, avg, ne, u1, var, z;
+	size_t i = 0, j = 0, a, b;
+	int64_t v;
+
+	*d = 0;
+	while (i < base->count || j < next->count) {
+		if (j >= next->count || (i < base->count && base->samples[i] <= next->samples[j]))
+			v = base->samples[i];
+		else
+			v = next->samples[j];
+		for (a = 0; i < base->count && base->samples[i] == v; ++i, ++a);
+		for (b = 0; j < next->count && next->samples[j] == v; ++j, ++b);
+
+		/* tied values share the average of their ranks */
+		avg = rank + (a + b + 1) / 2.0;
+		r1 += a * avg;
+		rank += a + b;
+		ties += ((double)(a + b) * (a + b) * (a + b)) - (a + b);
+		if (fabs(i / n1 - j / n2) > *d)
+			*d = fabs(i / n1 - j / n2);
+	}
+
+	ne = n1 * n2 / nn;
+	*p_ks = _cmp_ks_prob((sqrt(ne) + 0.12 + 0.11 / sqrt(ne)) * *d);
+
+	u1 = r1 - n1 * (n1 + 1) / 2.0; // base above new
+	var = n1 * n2 / 12.0 * ((nn + 1) - ties / (nn * (nn - 1)));
+	z = (var > 0) ? (u1 - n1 * n2 / 2.0) / sqrt(var) : 0;
+	*p_mw = erfc(fabs(z) / M_SQRT2);
+	*p_greater = 1.0 - u1 / (n1 * n2);
+}
+/*****************************************************************************/
+static double _cmp_delta(int64_t base, int64_t next)
+{
+	return (base > 0) ? 100.0 * (next - base) / base : 0;
+}
+/*****************************************************************************/
+/* meta lines of the run that are not in the baseline (kernel, cpu, ...) */
+static void _cmp_print_meta(CMP_FILE *base, CMP_FILE *next)
+{
+	char *line, *eol;
+
+	if (base->meta == NULL || next->meta == NULL)
+		return;
+	for (line = next->meta; *line != '\0'; line = eol + 1) {
+		eol = strchr(line, '\n');
+		if (eol == NULL)
+			break;
+		*eol = '\0';
+		if (strstr(base->meta, line) == NULL)
+			printf("  %s\n", line);
+		*eol = '\n';
+	}
+}
+/*****************************************************************************/
+static void _cmp_usage(void)
+{
+	printf("usage: compare [-c prd|resp|jit] [-q percentile] [-t tail_pct] [-M max_pct] [-a alpha] [-j threads]\n"
+			"               base_run run [run ...]   (run: [dir/]k of <task>_<N>sec_<k>.dat)\n");
+	printf("  regression: the q-th percentile grows more than tail_pct %% (or the max more than max_pct %%)\n"
+			"  and the KS test rejects at alpha; exit status 2\n");
+}
+/*****************************************************************************/
+int bench_compare_main(int argc, char **argv)
+{
+	double q = CMP_TAIL, tail_pct = CMP_TAIL_PCT, max_pct = 0, alpha = CMP_ALPHA;
+	double d, p_ks, p_mw, p_greater, dq, dmax;
+	int threads = bench_num_cpus();
+	int c, r, f, g, regressions = 0;
+	CMP_FILE *base, *next;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "c:q:t:M:a:j:h")) != -1) {
+		switch (c) {
+			case 'c':
+				for (column = 0; CmpColumns[column] != NULL && strcmp(CmpColumns[column], optarg) != 0; ++column);
+				if (CmpColumns[column] == NULL) {
+					_cmp_usage();
+					return 1;
+				}
+				break;
+			case 'q': q = atof(optarg); break;
+			case 't': tail_pct = atof(optarg); break;
+			case 'M': max_pct = atof(optarg); break;
+			case 'a': alpha = atof(optarg); break;
+			case 'j': threads = atoi(optarg); break;
+			default: _cmp_usage(); return 1;
+		}
+	}
+	if (argc - optind < 2 || argc - optind > CMP_MAX_RUNS || q <= 0 || q > 100 || threads < 1) {
+		_cmp_usage();
+		return 1;
+	}
+	for (nruns = 0; optind < argc; ++optind, ++nruns)
+		if (_cmp_find_run(&Runs[nruns], argv[optind]) != 0)
+			return 1;
+	if (_cmp_load(threads) != 0)
+		return 1;
+
+	for (r = 1; r < nruns; ++r) {
+		printf("\n%s vs %s (%s, p%g +%g%%%s, alpha %g)\n", Runs[r].name, Runs[0].name, CmpColumns[column],
+				q, tail_pct, max_pct > 0 ? ", max gated" : "", alpha);
+		_cmp_print_meta(&Runs[0].files[0], &Runs[r].files[0]);
+		printf("%-22s %-4s %9s %11s %11s %11s %11s %11s\n", "task", "", "samples",
+				"p50 [us]", "p90 [us]", "p99 [us]", "p99.9 [us]", "max [us]");
+
+		for (g = 0; g < Runs[0].nfiles; ++g) {
+			base = &Runs[0].files[g];
+			for (f = 0; f < Runs[r].nfiles && strcmp(Runs[r].files[f].key, base->key) != 0; ++f);
+			if (f == Runs[r].nfiles) {
+				printf("%-22s missing in %s\n", base->key, Runs[r].name);
+				continue;
+			}
+			next = &Runs[r].files[f];
+			if (base->count == 0 || next->count == 0) {
+				printf("%-22s no samples\n", base->key);
+				continue;
+			}
+			printf("%-22s %-4s %9lu %11.3f %11.3f %11.3f %11.3f %11.3f\n", base->key, "base",
+					(unsigned long)base->count, _cmp_percentile(base, 50) / 1000.0,
+					_cmp_percentile(base, 90) / 1000.0, _cmp_percentile(base, 99) / 1000.0,
+					_cmp_percentile(base, 99.9) / 1000.0, base->samples[base->count - 1] / 1000.0);
+			printf("%-22s %-4s %9lu %11.3f %11.3f %11.3f %11.3f %11.3f\n", "", "run",
+					(unsigned long)next->count, _cmp_percentile(next, 50) / 1000.0,
+					_cmp_percentile(next, 90) / 1000.0, _cmp_percentile(next, 99) / 1000.0,
+					_cmp_percentile(next, 99.9) / 1000.0, next->samples[next->count - 1] / 1000.0);
+			printf("%-22s %-4s %9s %10.1f%% %10.1f%% %10.1f%% %10.1f%% %10.1f%%\n", "", "diff", "",
+					_cmp_delta(_cmp_percentile(base, 50), _cmp_percentile(next, 50)),
+					_cmp_delta(_cmp_percentile(base, 90), _cmp_percentile(next, 90)),
+					_cmp_delta(_cmp_percentile(base, 99), _cmp_percentile(next, 99)),
+					_cmp_delta(_cmp_percentile(base, 99.9), _cmp_percentile(next, 99.9)),
+					_cmp_delta(base->samples[base->count - 1], next->samples[next->count - 1]));
+
+			_cmp_tests(base, next, &d, &p_ks, &p_mw, &p_greater);
+			dq = _cmp_delta(_cmp_percentile(base, q), _cmp_percentile(next, q));
+			dmax = _cmp_delta(base->samples[base->count - 1], next->samples[next->count - 1]);
+			printf("%-22s KS D %.4f p %.2g, MW p %.2g, P(run > base) %.3f", "", d, p_ks, p_mw, p_greater);
+			if (p_ks < alpha && (dq > tail_pct || (max_pct > 0 && dmax > max_pct))) {
+				printf("  REGRESSION\n");
+				regressions++;
+			}
+			else
+				printf("  ok\n");
+		}
+		for (f = 0; f < Runs[r].nfiles; ++f) {
+			for (g = 0; g < Runs[0].nfiles && strcmp(Runs[r].files[f].key, Runs[0].files[g].key) != 0; ++g);
+			if (g == Runs[0].nfiles)
+				printf("%-22s not in %s\n", Runs[r].files[f].key, Runs[0].name);
+		}
+	}
+
+	printf("\n%d regression(s)\n", regressions);
+	return (regressions > 0) ? 2 : 0;
+}
+/*****************************************************************************/
@@ -0,0 +1,329 @@
+/*
+ *  Cache-related preemption delay (CRPD).
+ *
+ *  A low priority victim repeatedly walks a working set (random pointer
+ *  chase over cache lines, one job = a fixed number of passes) sized for
+ *  L1, L2 and the last level cache. At evenly spaced points of every job it
+ *  wakes a higher priority preemptor on the same cpu, which
+ *    none    : is not woken at all (baseline)
+ *    switch  : returns at once, only the context switches are paid
+ *    pollute : writes a buffer larger than the caches before returning
+ *  The preemptor's own run time is taken out of the victim's job time, so
+ *  (pollute - switch) / preemptions is the cache reload cost of one
+ *  preemption and (switch - none) / preemptions the direct switch cost.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+/*****************************************************************************/
+#define CRPD_PRIO		(70) // victim, the preemptor runs one above
+#define CRPD_JOBS		(200)
+#define CRPD_WARMUP		(20)
+#define CRPD_PASSES		(2) // walks of the working set per job
+#define CRPD_PREEMPT	(4) // preemptions per job
+#define CRPD_GAP		(100) // us of sleep between jobs
+#define CRPD_MAX_SIZES	(8)
+#define CRPD_LINE		(64) // default cache line
+#define CRPD_SEED		(2020)
+/* when sysconf() does not know the caches */
+#define CRPD_L1			(32 * 1024)
+#define CRPD_L2			(1024 * 1024)
+#define CRPD_LLC		(8 * 1024 * 1024)
+/* sysconf() reports the whole LLC, a core only gets its slice of it */
+#define CRPD_MAX_WS		(8 * 1024 * 1024)
+#define CRPD_MAX_POLLUTION (32 * 1024 * 1024)
+
+typedef enum {
+	CRPD_NONE = 0,
+	CRPD_SWITCH,
+	CRPD_POLLUTE,
+	CRPD_MODES,
+	CRPD_STOP = CRPD_MODES
+}CRPD_MODE;
+
+static char *CrpdModeNames[CRPD_MODES] = {"none", "switch", "pollute"};
+
+typedef struct {
+	void **lines; // working set, every line points to the next one
+	size_t size;
+	size_t nlines;
+	CRPD_MODE mode;
+	RT_HIST exe[CRPD_MODES];
+	volatile int done;
+}CRPD_VICTIM;
+/*****************************************************************************/
+static RT_TASK TskVictim, TskPreempt;
+static CRPD_VICTIM Victim;
+static RT_SPSC Wake; // victim -> preemptor
+static char *Pollution;
+static size_t pollution_size;
+static size_t line = CRPD_LINE;
+
+static int jobs = CRPD_JOBS;
+static int passes = CRPD_PASSES;
+static int preemptions = CRPD_PREEMPT;
+
+static RTIME preempt_time; // run time of the last preemption
+static unsigned int preempt_served;
+static volatile int bPreemptDone;
+static uint32_t seed = CRPD_SEED;
+/*****************************************************************************/
+static uint32_t _crpd_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+/*****************************************************************************/
+/* random cyclic order of the lines so that the prefetchers cannot help */
+static int _crpd_build(CRPD_VICTIM *v, size_t size)
+{
+	size_t *order, i, k, tmp;
+
+	v->nlines = size / line;
+	v->size = v->nlines * line;
+	if (v->nlines < 2 || posix_memalign((void **)&v->lines, line, v->size) != 0)
+		return -ENOMEM;
+	order = calloc(v->nlines, sizeof(size_t));
+	if (order == NULL) {
+		free(v->lines);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < v->nlines; ++i)
+		order[i] = i;
+	for (i = v->nlines - 1; i > 0; --i) {
+		k = _crpd_rand() % (i + 1);
+		tmp = order[i];
+		order[i] = order[k];
+		order[k] = tmp;
+	}
+	for (i = 0; i < v->nlines; ++i)
+		*(void **)((char *)v->lines + order[i] * line) = (char *)v->lines + order[(i + 1) % v->nlines] * line;
+	free(order);
+	return 0;
+}
+/*****************************************************************************/
+static void* _crpd_walk(void *p, size_t steps)
+{
+	while (steps--)
+		p = *(void **)p;
+	return p;
+}
+/*****************************************************************************/
+static void CrpdPreemptTask(void *arg)
+{
+	RTIME start;
+	int mode;
+	size_t i;
+
+	while (1) {
+		pop_rt_spsc(&Wake, &mode);
+		if (mode == CRPD_STOP)
+			break;
+		start = rt_timer_read();
+		if (mode == CRPD_POLLUTE)
+			for (i = 0; i < pollution_size; i += line)
+				Pollution[i]++;
+		preempt_time = rt_timer_read() - start;
+		__atomic_add_fetch(&preempt_served, 1, __ATOMIC_RELEASE);
+	}
+	bench_signal_done(&bPreemptDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void CrpdVictimTask(void *arg)
+{
+	CRPD_VICTIM *v = arg;
+	RTIME start, end, stolen;
+	size_t steps = v->nlines * passes, segment = steps / (preemptions + 1);
+	unsigned int served;
+	void *p = v->lines;
+	int i, k, mode;
+
+	for (i = 0; i < jobs + CRPD_WARMUP && bBenchQuit == off; ++i) {
+		mode = v->mode;
+		stolen = 0;
+		start = rt_timer_read();
+		for (k = 0; k < preemptions; ++k) {
+			p = _crpd_walk(p, segment);
+			if (mode == CRPD_NONE)
+				continue;
+			/* the preemptor is above us on this cpu, it runs inside the push */
+			served = __atomic_load_n(&preempt_served, __ATOMIC_ACQUIRE);
+			push_rt_spsc(&Wake, &mode);
+			while (__atomic_load_n(&preempt_served, __ATOMIC_ACQUIRE) == served)
+				cpu_relax();
+			stolen += preempt_time;
+		}
+		p = _crpd_walk(p, steps - segment * preemptions);
+		end = rt_timer_read();
+
+		if (i >= CRPD_WARMUP)
+			add_rt_hist(&v->exe[mode], end - start - stolen);
+		sleep_rt_task_until(end + CRPD_GAP * NSEC_PER_USEC);
+	}
+	/* keep the walk alive for the compiler */
+	if (p == NULL)
+		printf("\n");
+	bench_signal_done(&v->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static int _crpd_run(CRPD_MODE mode, int prio, int cpu)
+{
+	Victim.mode = mode;
+	Victim.done = 0;
+	if (create_rt_task(&TskVictim, "crpd_victim", prio) != 0) {
+		bBenchQuit = on;
+		return -1;
+	}
+	set_rt_task_affinity(&TskVictim, cpu);
+	if (start_rt_task_arg(1, &TskVictim, &CrpdVictimTask, &Victim) != 0) {
+		bBenchQuit = on;
+		return -1;
+	}
+	return bench_wait_done(&Victim.done);
+}
+/*****************************************************************************/
+static size_t _crpd_cache(int name, size_t fallback)
+{
+	long size = sysconf(name);
+	return (size > 0) ? (size_t)size : fallback;
+}
+/*****************************************************************************/
+static void _crpd_usage(void)
+{
+	printf("usage: crpd [-w working_set_kb,...] [-n jobs] [-k preemptions] [-r passes]\n");
+	printf("            [-P pollution_kb] [-p prio] [-c cpu]\n");
+}
+/*****************************************************************************/
+int bench_crpd_main(int argc, char **argv)
+{
+	size_t sizes[CRPD_MAX_SIZES];
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[CRPD_MODES];
+	int nsizes = 0, prio = CRPD_PRIO, cpu = BENCH_CPU_AUTO;
+	uint64_t med[CRPD_MODES], p99[CRPD_MODES];
+	int c, i, m, mode, ret = 0;
+	char *tok;
+	FILE *summary, *fp;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "w:n:k:r:P:p:c:h")) != -1) {
+		switch (c) {
+			case 'w':
+				for (tok = strtok(optarg, ","); tok != NULL && nsizes < CRPD_MAX_SIZES; tok = strtok(NULL, ","))
+					sizes[nsizes++] = (size_t)atoi(tok) * 1024;
+				break;
+			case 'n': jobs = atoi(optarg); break;
+			case 'k': preemptions = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'r': passes = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'P': pollution_size = (size_t)atoi(optarg) * 1024; break;
+			case 'p': prio = atoi(optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			default: _crpd_usage(); return 1;
+		}
+	}
+
+	line = _crpd_cache(_SC_LEVEL1_DCACHE_LINESIZE, CRPD_LINE);
+	/* half of each level, the rest of the process has to fit too */
+	if (nsizes == 0) {
+		sizes[nsizes++] = _crpd_cache(_SC_LEVEL1_DCACHE_SIZE, CRPD_L1) / 2;
+		sizes[nsizes++] = _crpd_cache(_SC_LEVEL2_CACHE_SIZE, CRPD_L2) / 2;
+		sizes[nsizes] = _crpd_cache(_SC_LEVEL3_CACHE_SIZE, CRPD_LLC) / 2;
+		if (sizes[nsizes] > CRPD_MAX_WS)
+			sizes[nsizes] = CRPD_MAX_WS;
+		nsizes++;
+	}
+	if (pollution_size == 0) {
+		pollution_size = 2 * _crpd_cache(_SC_LEVEL3_CACHE_SIZE, CRPD_LLC);
+		if (pollution_size > CRPD_MAX_POLLUTION)
+			pollution_size = CRPD_MAX_POLLUTION;
+	}
+
+	cpu = bench_select_cpu(cpu);
+	bench_init(cpu);
+	Pollution = calloc(1, pollution_size);
+	if (Pollution == NULL || create_rt_spsc(&Wake, "crpd_wake", sizeof(int), 4) != 0) {
+		fprintf(stderr, "[CRPD] out of memory\n");
+		return 1;
+	}
+	bPreemptDone = 0;
+	if (create_rt_task(&TskPreempt, "crpd_preempt", prio + 1) != 0) {
+		delete_rt_spsc(&Wake);
+		free(Pollution);
+		return 1;
+	}
+	set_rt_task_affinity(&TskPreempt, cpu);
+	if (start_rt_task(1, &TskPreempt, &CrpdPreemptTask) != 0) {
+		delete_rt_spsc(&Wake);
+		free(Pollution);
+		return 1;
+	}
+
+	bench_meta("crpd_line_bytes: %lu", (unsigned long)line);
+	bench_meta("crpd_pollution_bytes: %lu", (unsigned long)pollution_size);
+	summary = bench_open_result("crpd_summary", filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# ws_bytes,preemptions,none_p50_ns,switch_p50_ns,pollute_p50_ns,none_p99_ns,switch_p99_ns,pollute_p99_ns,switch_cost_ns,crpd_p50_ns,crpd_p99_ns\n");
+
+	printf("CRPD: %d jobs of %d passes, %d preemptions per job, pollution %lu kB, line %lu B\n",
+			jobs, passes, preemptions, (unsigned long)(pollution_size / 1024), (unsigned long)line);
+	for (i = 0; i < nsizes && bBenchQuit == off; ++i) {
+		if (_crpd_build(&Victim, sizes[i]) != 0) {
+			fprintf(stderr, "[CRPD] cannot allocate a %lu byte working set\n", (unsigned long)sizes[i]);
+			continue;
+		}
+		for (m = 0; m < CRPD_MODES; ++m) {
+			init_rt_hist(&Victim.exe[m], CrpdModeNames[m]);
+			hists[m] = &Victim.exe[m];
+		}
+		for (m = 0; m < CRPD_MODES && bBenchQuit == off && ret == 0; ++m)
+			ret = _crpd_run(m, prio, cpu);
+		if (ret != 0)
+			break; // a victim still running walks its lines
+		free(Victim.lines);
+
+		for (m = 0; m < CRPD_MODES; ++m) {
+			med[m] = get_rt_hist_percentile(&Victim.exe[m], 50);
+			p99[m] = get_rt_hist_percentile(&Victim.exe[m], 99);
+		}
+		printf("working set %lu kB\n", (unsigned long)(Victim.size / 1024));
+		print_rt_hist_header(stdout);
+		for (m = 0; m < CRPD_MODES; ++m)
+			print_rt_hist(stdout, &Victim.exe[m]);
+		printf("per preemption: switch %.3f us, cache reload p50 %.3f us p99 %.3f us\n",
+				((double)med[CRPD_SWITCH] - med[CRPD_NONE]) / preemptions / 1000.0,
+				((double)med[CRPD_POLLUTE] - med[CRPD_SWITCH]) / preemptions / 1000.0,
+				((double)p99[CRPD_POLLUTE] - p99[CRPD_SWITCH]) / preemptions / 1000.0);
+
+		fprintf(summary, "%lu,%d,%lu,%lu,%lu,%lu,%lu,%lu,%ld,%ld,%ld\n", (unsigned long)Victim.size, preemptions,
+				(unsigned long)med[CRPD_NONE], (unsigned long)med[CRPD_SWITCH], (unsigned long)med[CRPD_POLLUTE],
+				(unsigned long)p99[CRPD_NONE], (unsigned long)p99[CRPD_SWITCH], (unsigned long)p99[CRPD_POLLUTE],
+				((long)med[CRPD_SWITCH] - (long)med[CRPD_NONE]) / preemptions,
+				((long)med[CRPD_POLLUTE] - (long)med[CRPD_SWITCH]) / preemptions,
+				((long)p99[CRPD_POLLUTE] - (long)p99[CRPD_SWITCH]) / preemptions);
+
+		snprintf(name, sizeof(name), "crpd_%lukB_hist", (unsigned long)(Victim.size / 1024));
+		fp = bench_open_result(name, NULL, 0);
+		if (fp != NULL) {
+			write_rt_hist(fp, hists, CRPD_MODES);
+			fclose(fp);
+		}
+	}
+	fclose(summary);
+
+	mode = CRPD_STOP;
+	push_rt_spsc(&Wake, &mode);
+	bench_wait_done(&bPreemptDone);
+	delete_rt_spsc(&Wake);
+	free(Pollution);
+	printf("CRPD summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
@@ -0,0 +1,521 @@
+/*
+ *  Cyclic executive vs. thread-per-task for many small periodic jobs.
+ *
+ *  A job set (harmonic periods of 1..100 ms, random execution times for a
+ *  target utilization) is partitioned over one executor per cpu and run in
+ *    thread : one RT_TASK per job, rate monotonic priorities (baseline)
+ *    table  : one RT_TASK per cpu walking a precomputed hyperperiod table,
+ *             one minor frame = gcd of the periods
+ *    queue  : one RT_TASK per cpu with a time-triggered run queue (min-heap
+ *             on the next release)
+ *  Releases of every mode lie on the same absolute time grid. Per job we
+ *  record release latency and response time from the nominal release, and
+ *  the start-to-start jitter of the main test. Process cpu time and context
+ *  switches give the scheduling overhead per job.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+/*****************************************************************************/
+#define CYC_JOBS		(200)
+#define CYC_MAX_JOBS	(4096)
+#define CYC_MAX_CPUS	(64)
+#define CYC_UTIL		(0.3) // per cpu
+#define CYC_DURATION	(10) // seconds per mode
+#define CYC_PRIO		(90)
+#define CYC_MIN_EXE		(NSEC_PER_USEC)
+#define CYC_SEED		(2020)
+
+static const uint64_t CycPeriodsMs[] = {1, 2, 5, 10, 20, 50, 100};
+#define CYC_NPERIODS (sizeof(CycPeriodsMs) / sizeof(CycPeriodsMs[0]))
+
+typedef enum {
+	CYC_THREAD = 0,
+	CYC_TABLE,
+	CYC_QUEUE,
+	CYC_MODES
+}CYC_MODE;
+
+static char *CycModeNames[CYC_MODES] = {"thread", "table", "queue"};
+
+typedef struct {
+	int id;
+	int cpu;
+	int prio;
+	uint64_t period;
+	uint64_t exe;
+	uint64_t next; // run queue key
+	uint64_t last_start;
+	uint64_t jobs;
+	uint64_t misses;
+	RT_HIST release;
+	RT_HIST resp;
+	RT_HIST jitter;
+	RT_TASK task;
+	char name[20]; // cyc_job_<int>
+	volatile int done;
+}CYC_JOB;
+
+typedef struct {
+	RT_TASK task;
+	char name[16];
+	int cpu;
+	double util;
+	CYC_JOB **jobs; // jobs of this cpu, rate monotonic order
+	int njobs;
+	uint64_t frame; // table: minor frame
+	int nframes;
+	int *frame_start; // table: first entry of frame f, nframes + 1 entries
+	int *table;
+	CYC_JOB **heap; // queue: min-heap on next release
+	uint64_t frame_overruns;
+	volatile int done;
+}CYC_EXEC;
+/*****************************************************************************/
+static CYC_JOB *Jobs;
+static int njobs = CYC_JOBS;
+static CYC_EXEC Execs[CYC_MAX_CPUS];
+static int nexecs = 1;
+static uint64_t t_start, t_end;
+static uint32_t seed = CYC_SEED;
+/*****************************************************************************/
+static double _cyc_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (double)((seed >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+/*****************************************************************************/
+static uint64_t _cyc_gcd(uint64_t a, uint64_t b)
+{
+	uint64_t t;
+
+	while (b != 0) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+/*****************************************************************************/
+static void _cyc_run_job(CYC_JOB *job, uint64_t release)
+{
+	uint64_t start, end, prd;
+
+	start = rt_timer_read();
+	rt_timer_spin(job->exe);
+	end = rt_timer_read();
+
+	add_rt_hist(&job->release, start - release);
+	add_rt_hist(&job->resp, end - release);
+	if (job->last_start != 0) {
+		prd = start - job->last_start;
+		add_rt_hist(&job->jitter, prd > job->period ? prd - job->period : job->period - prd);
+	}
+	if (end - release > job->period)
+		job->misses++;
+	job->last_start = start;
+	job->jobs++;
+}
+/*****************************************************************************/
+/* thread per task */
+/*****************************************************************************/
+static void CycJobTask(void *arg)
+{
+	CYC_JOB *job = arg;
+	uint64_t release;
+
+	for (release = t_start; release < t_end && bBenchQuit == off; release += job->period) {
+		sleep_rt_task_until(release);
+		_cyc_run_job(job, release);
+	}
+	bench_signal_done(&job->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* hyperperiod table */
+/*****************************************************************************/
+static void _cyc_build_table(CYC_EXEC *ex)
+{
+	uint64_t hyper, frame;
+	int f, i, n = 0;
+
+	frame = ex->jobs[0]->period;
+	hyper = ex->jobs[0]->period;
+	for (i = 1; i < ex->njobs; ++i) {
+		frame = _cyc_gcd(frame, ex->jobs[i]->period);
+		hyper = hyper / _cyc_gcd(hyper, ex->jobs[i]->period) * ex->jobs[i]->period;
+	}
+	ex->frame = frame;
+	ex->nframes = hyper / frame;
+
+	for (i = 0; i < ex->njobs; ++i)
+		n += hyper / ex->jobs[i]->period;
+	ex->table = calloc(n, sizeof(int));
+	ex->frame_start = calloc(ex->nframes + 1, sizeof(int));
+
+	n = 0;
+	for (f = 0; f < ex->nframes; ++f) {
+		ex->frame_start[f] = n;
+		for (i = 0; i < ex->njobs; ++i)
+			if ((f * frame) % ex->jobs[i]->period == 0)
+				ex->table[n++] = ex->jobs[i]->id;
+	}
+	ex->frame_start[ex->nframes] = n;
+}
+/*****************************************************************************/
+static void CycTableTask(void *arg)
+{
+	CYC_EXEC *ex = arg;
+	uint64_t release;
+	int f = 0, i;
+
+	for (release = t_start; release < t_end && bBenchQuit == off; release += ex->frame) {
+		sleep_rt_task_until(release);
+		for (i = ex->frame_start[f]; i < ex->frame_start[f + 1]; ++i)
+			_cyc_run_job(&Jobs[ex->table[i]], release);
+		if (rt_timer_read() > release + ex->frame)
+			ex->frame_overruns++;
+		if (++f == ex->nframes)
+			f = 0;
+	}
+	bench_signal_done(&ex->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* time-triggered run queue */
+/*****************************************************************************/
+static int _cyc_before(CYC_JOB *a, CYC_JOB *b)
+{
+	if (a->next != b->next)
+		return a->next < b->next;
+	if (a->period != b->period)
+		return a->period < b->period;
+	return a->id < b->id;
+}
+/*****************************************************************************/
+static void _cyc_sift_down(CYC_EXEC *ex, int i)
+{
+	CYC_JOB *tmp;
+	int l, r, m;
+
+	while (1) {
+		l = 2 * i + 1;
+		r = l + 1;
+		m = i;
+		if (l < ex->njobs && _cyc_before(ex->heap[l], ex->heap[m]))
+			m = l;
+		if (r < ex->njobs && _cyc_before(ex->heap[r], ex->heap[m]))
+			m = r;
+		if (m == i)
+			return;
+		tmp = ex->heap[i];
+		ex->heap[i] = ex->heap[m];
+		ex->heap[m] = tmp;
+		i = m;
+	}
+}
+/*****************************************************************************/
+static void CycQueueTask(void *arg)
+{
+	CYC_EXEC *ex = arg;
+	CYC_JOB *job;
+	uint64_t now;
+	int i;
+
+	/* every job is released at t_start, jobs are in rate monotonic order so
+	 * the array already is a valid heap */
+	for (i = 0; i < ex->njobs; ++i) {
+		ex->heap[i] = ex->jobs[i];
+		ex->heap[i]->next = t_start;
+	}
+
+	while (bBenchQuit == off && ex->heap[0]->next < t_end) {
+		sleep_rt_task_until(ex->heap[0]->next);
+		now = rt_timer_read();
+		while (ex->heap[0]->next <= now && ex->heap[0]->next < t_end) {
+			job = ex->heap[0];
+			_cyc_run_job(job, job->next);
+			job->next += job->period;
+			_cyc_sift_down(ex, 0);
+			now = rt_timer_read();
+		}
+	}
+	bench_signal_done(&ex->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* job set */
+/*****************************************************************************/
+static int _cyc_by_period(const void *a, const void *b)
+{
+	CYC_JOB *ja = *(CYC_JOB **)a, *jb = *(CYC_JOB **)b;
+
+	if (ja->period != jb->period)
+		return ja->period < jb->period ? -1 : 1;
+	return ja->id - jb->id;
+}
+/*****************************************************************************/
+static void _cyc_generate(double util)
+{
+	double *weight = calloc(njobs, sizeof(double));
+	double wsum = 0;
+	CYC_EXEC *ex;
+	int i, k, best;
+
+	for (i = 0; i < njobs; ++i) {
+		Jobs[i].id = i;
+		Jobs[i].period = CycPeriodsMs[(int)(_cyc_rand() * CYC_NPERIODS)] * NSEC_PER_MSEC;
+		weight[i] = 0.5 + _cyc_rand();
+		wsum += weight[i];
+	}
+
+	/* total utilization util * cpus, worst-fit partitioning onto the cpus */
+	for (k = 0; k < nexecs; ++k) {
+		Execs[k].jobs = calloc(njobs, sizeof(CYC_JOB *));
+		Execs[k].heap = calloc(njobs, sizeof(CYC_JOB *));
+	}
+	for (i = 0; i < njobs; ++i) {
+		Jobs[i].exe = (uint64_t)(util * nexecs * weight[i] / wsum * Jobs[i].period);
+		if (Jobs[i].exe < CYC_MIN_EXE)
+			Jobs[i].exe = CYC_MIN_EXE;
+
+		best = 0;
+		for (k = 1; k < nexecs; ++k)
+			if (Execs[k].util < Execs[best].util)
+				best = k;
+		ex = &Execs[best];
+		ex->util += (double)Jobs[i].exe / Jobs[i].period;
+		ex->jobs[ex->njobs++] = &Jobs[i];
+		Jobs[i].cpu = ex->cpu;
+		snprintf(Jobs[i].name, sizeof(Jobs[i].name), "cyc_job_%d", i);
+	}
+	free(weight);
+
+	for (k = 0; k < nexecs; ++k) {
+		ex = &Execs[k];
+		qsort(ex->jobs, ex->njobs, sizeof(CYC_JOB *), _cyc_by_period);
+		if (ex->njobs > 0)
+			_cyc_build_table(ex);
+	}
+
+	/* rate monotonic priorities for the thread mode, one level per period */
+	for (i = 0; i < njobs; ++i) {
+		Jobs[i].prio = CYC_PRIO;
+		for (k = 0; k < (int)CYC_NPERIODS; ++k)
+			if (CycPeriodsMs[k] * NSEC_PER_MSEC < Jobs[i].period)
+				Jobs[i].prio--;
+	}
+}
+/*****************************************************************************/
+static void _cyc_reset(void)
+{
+	int i;
+
+	for (i = 0; i < njobs; ++i) {
+		init_rt_hist(&Jobs[i].release, "release");
+		init_rt_hist(&Jobs[i].resp, "response");
+		init_rt_hist(&Jobs[i].jitter, "jitter");
+		Jobs[i].last_start = 0;
+		Jobs[i].jobs = 0;
+		Jobs[i].misses = 0;
+		Jobs[i].done = 0;
+	}
+	for (i = 0; i < nexecs; ++i) {
+		Execs[i].frame_overruns = 0;
+		Execs[i].done = 0;
+	}
+}
+/*****************************************************************************/
+static uint64_t _cyc_cpu_time(struct rusage *ru)
+{
+	return ((uint64_t)ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * NSEC_PER_SEC +
+			((uint64_t)ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * NSEC_PER_USEC;
+}
+/*****************************************************************************/
+static void _cyc_run(CYC_MODE mode, int duration, FILE *summary)
+{
+	char name[128];
+	char filename[256];
+	struct rusage ru_start, ru_end;
+	RT_HIST release, resp, jitter;
+	RT_HIST *hists[3] = {&release, &resp, &jitter};
+	uint64_t jobs = 0, misses = 0, overruns = 0, demand = 0, cpu, ctxsw;
+	double overhead;
+	FILE *fp;
+	int i, started;
+
+	_cyc_reset();
+	t_start = rt_timer_read() + NSEC_PER_SEC;
+	t_end = t_start + (uint64_t)duration * NSEC_PER_SEC;
+	getrusage(RUSAGE_SELF, &ru_start);
+
+	/* a failed task aborts the run, the started ones end at once */
+	if (mode == CYC_THREAD) {
+		for (started = 0; started < njobs; ++started) {
+			if (create_rt_task(&Jobs[started].task, Jobs[started].name, Jobs[started].prio) != 0)
+				break;
+			set_rt_task_affinity(&Jobs[started].task, Jobs[started].cpu);
+			if (start_rt_task_arg(1, &Jobs[started].task, &CycJobTask, &Jobs[started]) != 0)
+				break;
+		}
+		if (started < njobs)
+			bBenchQuit = on;
+		for (i = 0; i < started; ++i)
+			if (bench_wait_done(&Jobs[i].done) != 0)
+				return;
+		if (started < njobs)
+			return;
+	} else {
+		for (started = 0; started < nexecs; ++started) {
+			if (Execs[started].njobs == 0) {
+				bench_signal_done(&Execs[started].done);
+				continue;
+			}
+			if (create_rt_task(&Execs[started].task, Execs[started].name, CYC_PRIO) != 0)
+				break;
+			set_rt_task_affinity(&Execs[started].task, Execs[started].cpu);
+			if (start_rt_task_arg(1, &Execs[started].task, mode == CYC_TABLE ? &CycTableTask : &CycQueueTask,
+					&Execs[started]) != 0)
+				break;
+		}
+		if (started < nexecs)
+			bBenchQuit = on;
+		for (i = 0; i < started; ++i)
+			if (bench_wait_done(&Execs[i].done) != 0)
+				return;
+		if (started < nexecs)
+			return;
+	}
+	getrusage(RUSAGE_SELF, &ru_end);
+
+	init_rt_hist(&release, "release");
+	init_rt_hist(&resp, "response");
+	init_rt_hist(&jitter, "jitter");
+	snprintf(name, sizeof(name), "cyclic_%s_%djobs_jobs", CycModeNames[mode], njobs);
+	fp = bench_open_result(name, NULL, 0);
+	if (fp != NULL)
+		fprintf(fp, "# id,cpu,prio,period_ns,exe_ns,jobs,misses,release_max_ns,resp_p99_ns,resp_max_ns,jitter_max_ns\n");
+	for (i = 0; i < njobs; ++i) {
+		CYC_JOB *job = &Jobs[i];
+		merge_rt_hist(&release, &job->release);
+		merge_rt_hist(&resp, &job->resp);
+		merge_rt_hist(&jitter, &job->jitter);
+		jobs += job->jobs;
+		misses += job->misses;
+		demand += job->jobs * job->exe;
+		if (fp != NULL)
+			fprintf(fp, "%d,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", job->id, job->cpu, job->prio,
+					(unsigned long)job->period, (unsigned long)job->exe,
+					(unsigned long)job->jobs, (unsigned long)job->misses,
+					(unsigned long)job->release.max,
+					(unsigned long)get_rt_hist_percentile(&job->resp, 99),
+					(unsigned long)job->resp.max, (unsigned long)job->jitter.max);
+	}
+	if (fp != NULL)
+		fclose(fp);
+	for (i = 0; i < nexecs; ++i)
+		overruns += Execs[i].frame_overruns;
+
+	cpu = _cyc_cpu_time(&ru_end) - _cyc_cpu_time(&ru_start);
+	ctxsw = (ru_end.ru_nvcsw - ru_start.ru_nvcsw) + (ru_end.ru_nivcsw - ru_start.ru_nivcsw);
+	overhead = jobs ? ((double)cpu - (double)demand) / jobs : 0;
+
+	printf("[%s] jobs %lu, cpu %.3f ms (demand %.3f ms), overhead %.3f us/job, %lu ctx switches (%.1f/s), %lu misses",
+			CycModeNames[mode], (unsigned long)jobs, (double)cpu / NSEC_PER_MSEC, (double)demand / NSEC_PER_MSEC,
+			overhead / NSEC_PER_USEC, (unsigned long)ctxsw, (double)ctxsw / duration, (unsigned long)misses);
+	if (mode == CYC_TABLE)
+		printf(", %lu frame overruns", (unsigned long)overruns);
+	printf("\n");
+	print_rt_hist(stdout, &release);
+	print_rt_hist(stdout, &resp);
+	print_rt_hist(stdout, &jitter);
+
+	fprintf(summary, "%s,%lu,%lu,%lu,%.0f,%lu,%lu,%lu,%lu,%lu\n", CycModeNames[mode],
+			(unsigned long)jobs, (unsigned long)cpu, (unsigned long)demand, overhead,
+			(unsigned long)ctxsw, (unsigned long)misses,
+			(unsigned long)get_rt_hist_percentile(&resp, 99), (unsigned long)resp.max,
+			(unsigned long)jitter.max);
+
+	snprintf(name, sizeof(name), "cyclic_%s_%djobs_hist", CycModeNames[mode], njobs);
+	fp = bench_open_result(name, filename, sizeof(filename));
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, 3);
+		fclose(fp);
+	}
+}
+/*****************************************************************************/
+static void _cyc_usage(void)
+{
+	printf("usage: cyclic [-m thread|table|queue|all] [-n jobs] [-u util_per_cpu] [-c cpus]\n");
+	printf("              [-C first_cpu] [-d sec_per_mode] [-s seed]\n");
+}
+/*****************************************************************************/
+int bench_cyclic_main(int argc, char **argv)
+{
+	char *only = "all";
+	char name[128];
+	char filename[256];
+	double util = CYC_UTIL;
+	int duration = CYC_DURATION;
+	int first_cpu = BENCH_CPU_AUTO;
+	int ncpu = bench_num_cpus();
+	FILE *summary;
+	int c, k;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "m:n:u:c:C:d:s:h")) != -1) {
+		switch (c) {
+			case 'm': only = optarg; break;
+			case 'n': njobs = atoi(optarg); break;
+			case 'u': util = atof(optarg); break;
+			case 'c': nexecs = atoi(optarg); break;
+			case 'C': first_cpu = atoi(optarg); break;
+			case 'd': duration = atoi(optarg); break;
+			case 's': seed = atoi(optarg); break;
+			default: _cyc_usage(); return 1;
+		}
+	}
+	if (njobs < 1 || njobs > CYC_MAX_JOBS || nexecs < 1 || nexecs > CYC_MAX_CPUS) {
+		fprintf(stderr, "[CYC] jobs must be within 1..%d and cpus within 1..%d\n", CYC_MAX_JOBS, CYC_MAX_CPUS);
+		return 1;
+	}
+
+	first_cpu = bench_select_cpu(first_cpu);
+
+	Jobs = calloc(njobs, sizeof(CYC_JOB));
+	if (Jobs == NULL)
+		return 1;
+	for (k = 0; k < nexecs; ++k) {
+		Execs[k].cpu = (first_cpu + k) % ncpu;
+		snprintf(Execs[k].name, sizeof(Execs[k].name), "cyc_exec_%d", k);
+	}
+	_cyc_generate(util);
+
+	bench_init(first_cpu);
+	snprintf(name, sizeof(name), "cyclic_%djobs_summary", njobs);
+	summary = bench_open_result(name, filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# mode,jobs,cpu_ns,demand_ns,overhead_ns_per_job,ctx_switches,misses,resp_p99_ns,resp_max_ns,jitter_max_ns\n");
+
+	printf("Cyclic: %d jobs on %d cpu(s), utilization %.2f per cpu, %d s per mode\n", njobs, nexecs, util, duration);
+	for (k = 0; k < nexecs; ++k)
+		if (Execs[k].njobs > 0)
+			printf("  cpu %d: %d jobs, utilization %.3f, minor frame %lu us, %d frames per hyperperiod\n",
+					Execs[k].cpu, Execs[k].njobs, Execs[k].util,
+					(unsigned long)(Execs[k].frame / NSEC_PER_USEC), Execs[k].nframes);
+	print_rt_hist_header(stdout);
+
+	for (k = 0; k < CYC_MODES && bBenchQuit == off; ++k)
+		if (strcmp(only, "all") == 0 || strcmp(only, CycModeNames[k]) == 0)
+			_cyc_run(k, duration, summary);
+
+	fclose(summary);
+	printf("Cyclic summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
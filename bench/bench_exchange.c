@@ -0,0 +1,375 @@
+/*
+ *  State exchange between a writer and a reader task: PI mutex vs. seqlock
+ *  vs. triple buffer.
+ *
+ *  The periodic writer publishes a state vector of 64 B..64 KB every period,
+ *  the lower priority reader polls the latest state for its execution time
+ *  every period (a consumer of a controller state). Every word of the state
+ *  holds its version, so a torn copy is detected. Per mechanism and size:
+ *    access  : one publish / one read including any waiting
+ *    blocked : accesses that found the other side inside the exchange (mutex
+ *              held, seqlock retried)
+ *    resp    : job response time of writer and reader from the release
+ *  Seqlock reads whose retries ran out are not used (failed), triple buffer
+ *  reads without a new state are counted as stale.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+/*****************************************************************************/
+#define EXC_SIZES		"64,1024,16384,65536"
+#define EXC_MAX_SIZES	(8)
+#define EXC_DURATION	(2) // seconds per mechanism and size
+#define EXC_W_PRD		(1000) // us
+#define EXC_R_PRD		(700) // us
+#define EXC_R_EXE		(300) // us of polling per reader job
+#define EXC_PRIO		(80) // writer, the reader runs one below
+
+typedef enum {
+	EXC_MUTEX = 0,
+	EXC_SEQLOCK,
+	EXC_TRIPLE,
+	EXC_MECHS
+}EXC_MECH;
+
+static char *ExcMechNames[EXC_MECHS] = {"mutex", "seqlock", "triple"};
+
+typedef struct {
+	char *name;
+	uint64_t jobs;
+	uint64_t ops;
+	uint64_t blocked;
+	uint64_t failed; // seqlock retries ran out
+	uint64_t stale; // no new state since the last read
+	uint64_t torn; // inconsistent copies that got through
+	RT_HIST access;
+	RT_HIST wait; // access time of the blocked ones
+	RT_HIST resp;
+	RT_TASK task;
+	volatile int done;
+}EXC_SIDE;
+/*****************************************************************************/
+static EXC_MECH mech;
+static size_t size;
+static RT_MUTEX ExcLock;
+static char *ExcShared; // state behind the mutex
+static int ExcBusy = 0; // inside the mutex
+static RT_SEQLOCK ExcSeq;
+static RT_TRIPLE ExcTriple;
+static EXC_SIDE Writer = {.name = "writer"}, Reader = {.name = "reader"};
+static RTIME w_period = EXC_W_PRD * NSEC_PER_USEC;
+static RTIME r_period = EXC_R_PRD * NSEC_PER_USEC;
+static RTIME r_exe = EXC_R_EXE * NSEC_PER_USEC;
+static uint64_t t_start, t_end;
+/*****************************************************************************/
+static void _exc_fill(uint64_t *state, uint64_t version)
+{
+	size_t i;
+
+	for (i = 0; i < size / sizeof(uint64_t); ++i)
+		state[i] = version;
+}
+/*****************************************************************************/
+static FLAG _exc_torn(uint64_t *state)
+{
+	size_t i;
+
+	for (i = 1; i < size / sizeof(uint64_t); ++i)
+		if (state[i] != state[0])
+			return on;
+	return off;
+}
+/*****************************************************************************/
+static void _exc_access(EXC_SIDE *side, RTIME start, FLAG blocked)
+{
+	RTIME dt = rt_timer_read() - start;
+
+	add_rt_hist(&side->access, dt);
+	if (blocked == on) {
+		add_rt_hist(&side->wait, dt);
+		side->blocked++;
+	}
+	side->ops++;
+}
+/*****************************************************************************/
+static void _exc_locked_copy(void *dst, const void *src, FLAG *blocked)
+{
+	*blocked = __atomic_load_n(&ExcBusy, __ATOMIC_ACQUIRE) ? on : off;
+	acquire_rt_mutex(&ExcLock);
+	__atomic_store_n(&ExcBusy, 1, __ATOMIC_RELEASE);
+	memcpy(dst, src, size);
+	__atomic_store_n(&ExcBusy, 0, __ATOMIC_RELEASE);
+	release_rt_mutex(&ExcLock);
+}
+/*****************************************************************************/
+static void ExcWriterTask(void *arg)
+{
+	uint64_t *state = calloc(1, size);
+	uint64_t version = 1;
+	RTIME release, start;
+	FLAG blocked;
+
+	for (release = t_start; release < t_end && bBenchQuit == off; release += w_period) {
+		sleep_rt_task_until(release);
+		_exc_fill(state, version++);
+		start = rt_timer_read();
+		blocked = off;
+		if (mech == EXC_MUTEX)
+			_exc_locked_copy(ExcShared, state, &blocked);
+		else if (mech == EXC_SEQLOCK)
+			write_rt_seqlock(&ExcSeq, state);
+		else
+			write_rt_triple(&ExcTriple, state);
+		_exc_access(&Writer, start, blocked);
+		add_rt_hist(&Writer.resp, rt_timer_read() - release);
+		Writer.jobs++;
+	}
+	free(state);
+	bench_signal_done(&Writer.done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void ExcReaderTask(void *arg)
+{
+	uint64_t *state = calloc(1, size);
+	RTIME release, start, end;
+	FLAG blocked;
+	int ret;
+
+	for (release = t_start; release < t_end && bBenchQuit == off; release += r_period) {
+		sleep_rt_task_until(release);
+		end = rt_timer_read() + r_exe;
+		do {
+			start = rt_timer_read();
+			blocked = off;
+			ret = 0;
+			if (mech == EXC_MUTEX) {
+				_exc_locked_copy(state, ExcShared, &blocked);
+			} else if (mech == EXC_SEQLOCK) {
+				ret = read_rt_seqlock(&ExcSeq, state);
+				if (ret != 0)
+					blocked = on;
+				if (ret < 0)
+					Reader.failed++;
+			} else if (read_rt_triple(&ExcTriple, state) == 0) {
+				Reader.stale++;
+			}
+			_exc_access(&Reader, start, blocked);
+			if (ret >= 0 && _exc_torn(state) == on)
+				Reader.torn++;
+		} while (rt_timer_read() < end);
+		add_rt_hist(&Reader.resp, rt_timer_read() - release);
+		Reader.jobs++;
+	}
+	free(state);
+	bench_signal_done(&Reader.done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void _exc_reset(EXC_SIDE *side)
+{
+	side->jobs = side->ops = side->blocked = side->failed = side->stale = side->torn = 0;
+	init_rt_hist(&side->access, "access");
+	init_rt_hist(&side->wait, "blocked");
+	init_rt_hist(&side->resp, "response");
+	side->done = 0;
+}
+/*****************************************************************************/
+static void _exc_report(EXC_SIDE *side, FILE *summary)
+{
+	printf("%s: %lu jobs, %lu accesses, %lu blocked, %lu failed, %lu stale, %lu torn\n", side->name,
+			(unsigned long)side->jobs, (unsigned long)side->ops, (unsigned long)side->blocked,
+			(unsigned long)side->failed, (unsigned long)side->stale, (unsigned long)side->torn);
+	print_rt_hist(stdout, &side->access);
+	print_rt_hist(stdout, &side->wait);
+	print_rt_hist(stdout, &side->resp);
+	fprintf(summary, "%s,%lu,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", ExcMechNames[mech],
+			(unsigned long)size, side->name, (unsigned long)side->jobs, (unsigned long)side->ops,
+			(unsigned long)side->blocked, (unsigned long)side->failed, (unsigned long)side->stale,
+			(unsigned long)side->torn,
+			(unsigned long)get_rt_hist_percentile(&side->access, 99), (unsigned long)side->access.max,
+			(unsigned long)side->wait.max,
+			(unsigned long)get_rt_hist_percentile(&side->resp, 99), (unsigned long)side->resp.max);
+}
+/*****************************************************************************/
+/* the state of the current mechanism */
+static void _exc_free(void)
+{
+	if (mech == EXC_MUTEX) {
+		delete_rt_mutex(&ExcLock);
+		free(ExcShared);
+	} else if (mech == EXC_SEQLOCK) {
+		delete_rt_seqlock(&ExcSeq);
+	} else {
+		delete_rt_triple(&ExcTriple);
+	}
+}
+/*****************************************************************************/
+static int _exc_run(int prio, int cpu, int reader_cpu, FLAG invert, int duration, FILE *summary)
+{
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[6] = {&Writer.access, &Writer.wait, &Writer.resp, &Reader.access, &Reader.wait, &Reader.resp};
+	FILE *fp;
+	int ret;
+
+	if (mech == EXC_MUTEX) {
+		ExcShared = calloc(1, size);
+		ret = (ExcShared == NULL) ? -ENOMEM : create_rt_mutex(&ExcLock, NULL);
+	} else if (mech == EXC_SEQLOCK) {
+		ret = create_rt_seqlock(&ExcSeq, "exc_seqlock", size);
+	} else {
+		ret = create_rt_triple(&ExcTriple, "exc_triple", size);
+	}
+	if (ret != 0) {
+		fprintf(stderr, "[EXC] %s of %lu bytes failed: %d\n", ExcMechNames[mech], (unsigned long)size, ret);
+		return ret;
+	}
+
+	_exc_reset(&Writer);
+	_exc_reset(&Reader);
+	t_start = rt_timer_read() + NSEC_PER_SEC;
+	t_end = t_start + (uint64_t)duration * NSEC_PER_SEC;
+
+	if (create_rt_task(&Reader.task, "exc_reader", invert == on ? prio : prio - 1) != 0 ||
+			create_rt_task(&Writer.task, "exc_writer", invert == on ? prio - 1 : prio) != 0) {
+		bBenchQuit = on;
+		_exc_free();
+		return -1;
+	}
+	set_rt_task_affinity(&Reader.task, reader_cpu);
+	set_rt_task_affinity(&Writer.task, cpu);
+	if (start_rt_task_arg(1, &Reader.task, &ExcReaderTask, NULL) != 0) {
+		bBenchQuit = on;
+		_exc_free();
+		return -1;
+	}
+	if (start_rt_task_arg(1, &Writer.task, &ExcWriterTask, NULL) != 0) {
+		/* the reader ends at once, it is alone with the state */
+		bBenchQuit = on;
+		if (bench_wait_done(&Reader.done) == 0)
+			_exc_free();
+		return -1;
+	}
+	/* a task still running keeps the state */
+	if (bench_wait_done(&Writer.done) != 0 || bench_wait_done(&Reader.done) != 0)
+		return -1;
+
+	printf("%s/%lu\n", ExcMechNames[mech], (unsigned long)size);
+	_exc_report(&Writer, summary);
+	_exc_report(&Reader, summary);
+
+	snprintf(name, sizeof(name), "exchange_%s_%lu_hist", ExcMechNames[mech], (unsigned long)size);
+	fp = bench_open_result(name, filename, sizeof(filename));
+	if (fp != NULL) {
+		Writer.access.name = "w_access";
+		Writer.wait.name = "w_blocked";
+		Writer.resp.name = "w_response";
+		Reader.access.name = "r_access";
+		Reader.wait.name = "r_blocked";
+		Reader.resp.name = "r_response";
+		write_rt_hist(fp, hists, 6);
+		fclose(fp);
+	}
+	_exc_free();
+	return 0;
+}
+/*****************************************************************************/
+static void _exc_usage(void)
+{
+	printf("usage: exchange [-m mutex|seqlock|triple|all] [-s bytes,...] [-d sec] [-w writer_prd_us]\n");
+	printf("                [-r reader_prd_us] [-e reader_exe_us] [-P prio] [-c cpu] [-C reader_cpu] [-i]\n");
+}
+/*****************************************************************************/
+int bench_exchange_main(int argc, char **argv)
+{
+	char *only = "all";
+	char sizes_arg[128] = EXC_SIZES;
+	char filename[256];
+	char *tok;
+	size_t sizes[EXC_MAX_SIZES];
+	uint64_t worst[EXC_MECHS][EXC_MAX_SIZES][2] = {{{0,},},};
+	FLAG ran[EXC_MECHS] = {off, off, off};
+	FLAG invert = off;
+	int duration = EXC_DURATION, prio = EXC_PRIO;
+	int cpu = BENCH_CPU_AUTO, reader_cpu = -1;
+	int nsizes = 0;
+	FILE *summary;
+	int c, k, n;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "m:s:d:w:r:e:P:c:C:ih")) != -1) {
+		switch (c) {
+			case 'm': only = optarg; break;
+			case 's': snprintf(sizes_arg, sizeof(sizes_arg), "%s", optarg); break;
+			case 'd': duration = atoi(optarg); break;
+			case 'w': w_period = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'r': r_period = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'e': r_exe = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'P': prio = atoi(optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			case 'C': reader_cpu = atoi(optarg); break;
+			case 'i': invert = on; break;
+			default: _exc_usage(); return 1;
+		}
+	}
+	for (tok = strtok(sizes_arg, ","); tok != NULL && nsizes < EXC_MAX_SIZES; tok = strtok(NULL, ",")) {
+		sizes[nsizes] = (size_t)atoi(tok) & ~(sizeof(uint64_t) - 1);
+		if (sizes[nsizes] < ITC_MIN_SIZE || sizes[nsizes] > ITC_MAX_SIZE) {
+			fprintf(stderr, "[EXC] sizes must be within %d..%d bytes\n", ITC_MIN_SIZE, ITC_MAX_SIZE);
+			return 1;
+		}
+		nsizes++;
+	}
+	/* same cpu by default, that is where the mutex blocks */
+	cpu = bench_select_cpu(cpu);
+	if (reader_cpu < 0)
+		reader_cpu = cpu;
+
+	bench_init(cpu);
+	bench_meta("exchange_reader_cpu: %d", reader_cpu);
+	summary = bench_open_result("exchange_summary", filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# mech,size,side,jobs,accesses,blocked,failed,stale,torn,access_p99_ns,access_max_ns,blocked_max_ns,resp_p99_ns,resp_max_ns\n");
+
+	printf("State exchange: writer every %lu us at prio %d, reader %lu us of every %lu us at prio %d, cpus %d/%d\n",
+			(unsigned long)(w_period / NSEC_PER_USEC), invert == on ? prio - 1 : prio,
+			(unsigned long)(r_exe / NSEC_PER_USEC), (unsigned long)(r_period / NSEC_PER_USEC),
+			invert == on ? prio : prio - 1, cpu, reader_cpu);
+	print_rt_hist_header(stdout);
+
+	for (k = 0; k < EXC_MECHS && bBenchQuit == off; ++k) {
+		if (strcmp(only, "all") != 0 && strcmp(only, ExcMechNames[k]) != 0)
+			continue;
+		mech = k;
+		for (n = 0; n < nsizes && bBenchQuit == off; ++n) {
+			size = sizes[n];
+			if (_exc_run(prio, cpu, reader_cpu, invert, duration, summary) != 0)
+				continue;
+			worst[k][n][0] = Writer.resp.max;
+			worst[k][n][1] = Reader.resp.max;
+			ran[k] = on;
+		}
+	}
+	fclose(summary);
+
+	printf("Worst-case response writer / reader [us]\n%-8s", "bytes");
+	for (k = 0; k < EXC_MECHS; ++k)
+		if (ran[k] == on)
+			printf(" %21s", ExcMechNames[k]);
+	printf("\n");
+	for (n = 0; n < nsizes; ++n) {
+		printf("%-8lu", (unsigned long)sizes[n]);
+		for (k = 0; k < EXC_MECHS; ++k)
+			if (ran[k] == on)
+				printf(" %10.3f %10.3f", worst[k][n][0] / 1000.0, worst[k][n][1] / 1000.0);
+		printf("\n");
+	}
+	printf("Exchange summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
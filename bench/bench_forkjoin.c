@@ -0,0 +1,205 @@
+/*
+ *  Parallel fork-join real-time jobs.
+ *
+ *  A periodic master task splits a fixed amount of work over an RT_POOL of
+ *  pinned workers (the master takes share 0) and joins before completing.
+ *  For every worker count and barrier type we record per job
+ *    dispatch : fork -> slowest helper wakes up
+ *    skew     : first finished share -> last finished share (stragglers)
+ *    join     : last share done -> master resumes
+ *    response : nominal release of the master -> join
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <rt_pool.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+/*****************************************************************************/
+#define FJ_PRIO			(90)
+#define FJ_PRD			(1000) // us
+#define FJ_WORK			(400) // us, split over the workers
+#define FJ_ITERATIONS	(5000)
+#define FJ_WARMUP		(50)
+#define FJ_MAX_COUNTS	(16)
+
+typedef struct {
+	uint64_t share; // ns of work per worker
+}FJ_JOB;
+/*****************************************************************************/
+static RT_TASK TskMaster;
+static RT_POOL Pool;
+static FJ_JOB Job;
+
+static RT_HIST HistDispatch;
+static RT_HIST HistSkew;
+static RT_HIST HistJoin;
+static RT_HIST HistResp;
+
+static int iterations = FJ_ITERATIONS;
+static RTIME t_start; // first release of the master
+static RTIME prd; // ns
+static volatile int bMasterDone = 0;
+/*****************************************************************************/
+static void _fj_work(int worker, int nworkers, void *arg)
+{
+	FJ_JOB *job = arg;
+
+	rt_timer_spin(job->share);
+}
+/*****************************************************************************/
+static void FjMasterTask(void *arg)
+{
+	RTIME release, first, last, dispatch;
+	int i, k;
+
+	for (i = 0; i < iterations + FJ_WARMUP && bBenchQuit == off; ++i) {
+		wait_rt_period(&TskMaster);
+		release = t_start + (RTIME)i * prd; // its wakeup latency is part of the response
+		fork_rt_pool(&Pool, &_fj_work, &Job);
+		if (i < FJ_WARMUP)
+			continue;
+
+		first = last = Pool.t_done[0];
+		dispatch = 0;
+		for (k = 1; k < Pool.nworkers; ++k) {
+			if (Pool.t_wake[k] - Pool.t_fork > dispatch)
+				dispatch = Pool.t_wake[k] - Pool.t_fork;
+			if (Pool.t_done[k] < first)
+				first = Pool.t_done[k];
+			if (Pool.t_done[k] > last)
+				last = Pool.t_done[k];
+		}
+		add_rt_hist(&HistDispatch, dispatch);
+		add_rt_hist(&HistSkew, last - first);
+		add_rt_hist(&HistJoin, Pool.t_join - last);
+		add_rt_hist(&HistResp, Pool.t_join - release);
+	}
+	bench_signal_done(&bMasterDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static int _fj_run(int nworkers, FLAG spin, int prio, int cpu, int period, int work, FILE *summary)
+{
+	char name[128];
+	RT_HIST *hists[4] = {&HistDispatch, &HistSkew, &HistJoin, &HistResp};
+	char *barrier = (spin == on) ? "spin" : "futex";
+	FILE *fp;
+	int ret;
+
+	ret = create_rt_pool(&Pool, "fj", nworkers, prio, cpu, spin);
+	if (ret != 0) {
+		fprintf(stderr, "[FJ] cannot create %s pool of %d workers (%d), skipped\n", barrier, nworkers, ret);
+		return ret;
+	}
+	Job.share = (uint64_t)work * NSEC_PER_USEC / nworkers;
+	init_rt_hist(&HistDispatch, "dispatch");
+	init_rt_hist(&HistSkew, "skew");
+	init_rt_hist(&HistJoin, "join");
+	init_rt_hist(&HistResp, "response");
+	bMasterDone = 0;
+
+	if (create_rt_task(&TskMaster, "fj_master", prio) != 0) {
+		delete_rt_pool(&Pool);
+		bBenchQuit = on;
+		return -1;
+	}
+	set_rt_task_affinity(&TskMaster, cpu);
+	prd = (RTIME)period * NSEC_PER_USEC;
+	t_start = rt_timer_read() + NSEC_PER_SEC;
+	set_rt_task_release(&TskMaster, t_start, prd);
+	if (start_rt_task(1, &TskMaster, &FjMasterTask) != 0) {
+		delete_rt_pool(&Pool);
+		bBenchQuit = on;
+		return -1;
+	}
+	/* the pool is the master's as long as it runs */
+	if (bench_wait_done(&bMasterDone) != 0)
+		return -1;
+	delete_rt_pool(&Pool);
+
+	printf("%s barrier, %d worker(s), %lu us each\n", barrier, nworkers, (unsigned long)(Job.share / NSEC_PER_USEC));
+	print_rt_hist(stdout, &HistDispatch);
+	print_rt_hist(stdout, &HistSkew);
+	print_rt_hist(stdout, &HistJoin);
+	print_rt_hist(stdout, &HistResp);
+
+	fprintf(summary, "%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", barrier, nworkers,
+			(unsigned long)Job.share,
+			(unsigned long)get_rt_hist_percentile(&HistDispatch, 99), (unsigned long)HistDispatch.max,
+			(unsigned long)get_rt_hist_percentile(&HistSkew, 99), (unsigned long)HistSkew.max,
+			(unsigned long)get_rt_hist_percentile(&HistResp, 50),
+			(unsigned long)get_rt_hist_percentile(&HistResp, 99), (unsigned long)HistResp.max);
+
+	snprintf(name, sizeof(name), "forkjoin_%s_%dw_hist", barrier, nworkers);
+	fp = bench_open_result(name, NULL, 0);
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, 4);
+		fclose(fp);
+	}
+	return 0;
+}
+/*****************************************************************************/
+static void _fj_usage(void)
+{
+	printf("usage: forkjoin [-m spin|futex|both] [-w workers,...] [-W work_us] [-p period_us]\n");
+	printf("                [-n iterations] [-P prio] [-c first_cpu]\n");
+}
+/*****************************************************************************/
+int bench_forkjoin_main(int argc, char **argv)
+{
+	char *mode = "both";
+	char name[128];
+	char filename[256];
+	char *tok;
+	int counts[FJ_MAX_COUNTS], ncounts = 0;
+	int period = FJ_PRD, work = FJ_WORK, prio = FJ_PRIO, cpu = BENCH_CPU_AUTO;
+	int ncpu = bench_num_cpus();
+	FILE *summary;
+	int c, k;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "m:w:W:p:n:P:c:h")) != -1) {
+		switch (c) {
+			case 'm': mode = optarg; break;
+			case 'w':
+				for (tok = strtok(optarg, ","); tok != NULL && ncounts < FJ_MAX_COUNTS; tok = strtok(NULL, ","))
+					counts[ncounts++] = atoi(tok);
+				break;
+			case 'W': work = atoi(optarg); break;
+			case 'p': period = atoi(optarg); break;
+			case 'n': iterations = atoi(optarg); break;
+			case 'P': prio = atoi(optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			default: _fj_usage(); return 1;
+		}
+	}
+	cpu = bench_select_cpu(cpu);
+	/* default sweep 1, 2, 4, ... up to every online cpu */
+	if (ncounts == 0) {
+		for (k = 1; k < ncpu && ncounts < FJ_MAX_COUNTS - 1; k *= 2)
+			counts[ncounts++] = k;
+		counts[ncounts++] = ncpu;
+	}
+
+	bench_init(cpu);
+	snprintf(name, sizeof(name), "forkjoin_summary");
+	summary = bench_open_result(name, filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# barrier,workers,share_ns,dispatch_p99_ns,dispatch_max_ns,skew_p99_ns,skew_max_ns,resp_p50_ns,resp_p99_ns,resp_max_ns\n");
+
+	printf("Fork-join: %d us of work every %d us, %d iterations\n", work, period, iterations);
+	print_rt_hist_header(stdout);
+	for (k = 0; k < ncounts && bBenchQuit == off; ++k) {
+		if (strcmp(mode, "futex") != 0)
+			_fj_run(counts[k], on, prio, cpu, period, work, summary);
+		if (strcmp(mode, "spin") != 0 && bBenchQuit == off)
+			_fj_run(counts[k], off, prio, cpu, period, work, summary);
+	}
+	fclose(summary);
+	printf("Fork-join summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
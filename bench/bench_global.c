@@ -0,0 +1,382 @@
+/*
+ *  Global vs. partitioned fixed-priority scheduling.
+ *
+ *  One periodic task set (rate monotonic priorities, a total utilization
+ *  spread over a set of cpus) is run twice:
+ *    partitioned : every task pinned to one cpu, worst-fit decreasing
+ *                  utilization
+ *    global      : every task allowed on all cpus of the set, the kernel
+ *                  pushes and pulls them
+ *  A job executes its demand in thread cpu time, so preemption stretches the
+ *  response, in slices with a sched_getcpu() after each one. A migration is
+ *  counted when the cpu differs from the previous slice (within a job) or
+ *  from the cpu the previous job ended on (between jobs). Jobs that migrated
+ *  keep their execution stretch apart from the ones that did not, the
+ *  difference is the cost of a migration seen by the task.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+/*****************************************************************************/
+#define GLB_TASKS_PER_CPU	(3)
+#define GLB_MAX_TASKS	(64)
+#define GLB_MAX_CPUS	(64)
+#define GLB_UTIL		(0.5) // per cpu
+#define GLB_DURATION	(10) // seconds per placement
+#define GLB_PRIO		(90)
+#define GLB_SLICE		(10 * NSEC_PER_USEC) // between two sched_getcpu()
+#define GLB_MIN_EXE		(20 * NSEC_PER_USEC)
+#define GLB_SEED		(2020)
+
+static const uint64_t GlbPeriodsMs[] = {2, 5, 10, 20, 50};
+#define GLB_NPERIODS (sizeof(GlbPeriodsMs) / sizeof(GlbPeriodsMs[0]))
+
+typedef enum {
+	GLB_PARTITIONED = 0,
+	GLB_GLOBAL,
+	GLB_PLACEMENTS
+}GLB_PLACEMENT;
+
+static char *GlbPlacementNames[GLB_PLACEMENTS] = {"partitioned", "global"};
+
+typedef struct {
+	uint64_t jobs;
+	uint64_t misses;
+	uint64_t migrated_jobs;
+	uint64_t within; // migrations inside a job
+	uint64_t between; // start cpu != end cpu of the previous job
+	uint64_t cpus_used; // bitmask of the cpus jobs ended on
+	RT_HIST resp;
+	RT_HIST stretch_local; // response - demand, jobs without migration
+	RT_HIST stretch_migrated;
+}GLB_STATS;
+
+typedef struct {
+	int id;
+	int prio;
+	int cpu; // partitioned placement
+	uint64_t period;
+	uint64_t exe;
+	int last_cpu;
+	GLB_STATS *stats; // of the running placement
+	GLB_STATS result[GLB_PLACEMENTS];
+	RT_TASK task;
+	char name[16];
+	volatile int done;
+}GLB_TASK;
+/*****************************************************************************/
+static GLB_TASK Tasks[GLB_MAX_TASKS];
+static int ntasks = 0;
+static int Cpus[GLB_MAX_CPUS];
+static int ncpus = 0;
+static uint64_t t_start, t_end;
+static uint32_t seed = GLB_SEED;
+/*****************************************************************************/
+static double _glb_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (double)((seed >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+/*****************************************************************************/
+static uint64_t _glb_cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+/*****************************************************************************/
+static void _glb_run_job(GLB_TASK *t, uint64_t release)
+{
+	GLB_STATS *s = t->stats;
+	uint64_t begin, used, end;
+	int cpu, last, moves = 0;
+
+	last = sched_getcpu();
+	if (t->last_cpu >= 0 && last != t->last_cpu)
+		s->between++;
+	begin = _glb_cpu_time();
+	do {
+		rt_timer_spin(GLB_SLICE);
+		cpu = sched_getcpu();
+		if (cpu != last) {
+			moves++;
+			last = cpu;
+		}
+		used = _glb_cpu_time() - begin;
+	} while (used < t->exe);
+	end = rt_timer_read();
+
+	add_rt_hist(&s->resp, end - release);
+	add_rt_hist(moves ? &s->stretch_migrated : &s->stretch_local,
+			end - release > used ? end - release - used : 0);
+	if (moves)
+		s->migrated_jobs++;
+	s->within += moves;
+	if (last >= 0 && last < 64)
+		s->cpus_used |= 1ULL << last;
+	if (end - release > t->period)
+		s->misses++;
+	s->jobs++;
+	t->last_cpu = last;
+}
+/*****************************************************************************/
+static void GlbTask(void *arg)
+{
+	GLB_TASK *t = arg;
+	uint64_t release;
+
+	for (release = t_start; release < t_end && bBenchQuit == off; release += t->period) {
+		sleep_rt_task_until(release);
+		_glb_run_job(t, release);
+	}
+	bench_signal_done(&t->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static int _glb_by_util(const void *a, const void *b)
+{
+	const GLB_TASK *ta = *(GLB_TASK * const *)a, *tb = *(GLB_TASK * const *)b;
+	double ua = (double)ta->exe / ta->period, ub = (double)tb->exe / tb->period;
+
+	if (ua != ub)
+		return ua > ub ? -1 : 1;
+	return ta->id - tb->id;
+}
+/*****************************************************************************/
+static void _glb_generate(double util)
+{
+	GLB_TASK *order[GLB_MAX_TASKS];
+	double weight[GLB_MAX_TASKS], load[GLB_MAX_CPUS] = {0,};
+	double wsum = 0;
+	int i, k, best;
+
+	for (i = 0; i < ntasks; ++i) {
+		Tasks[i].id = i;
+		Tasks[i].period = GlbPeriodsMs[(int)(_glb_rand() * GLB_NPERIODS)] * NSEC_PER_MSEC;
+		weight[i] = 0.5 + _glb_rand();
+		wsum += weight[i];
+		snprintf(Tasks[i].name, sizeof(Tasks[i].name), "glb_task_%d", i);
+	}
+	for (i = 0; i < ntasks; ++i) {
+		Tasks[i].exe = (uint64_t)(util * ncpus * weight[i] / wsum * Tasks[i].period);
+		if (Tasks[i].exe < GLB_MIN_EXE)
+			Tasks[i].exe = GLB_MIN_EXE;
+		order[i] = &Tasks[i];
+	}
+
+	/* rate monotonic, one priority level per period */
+	for (i = 0; i < ntasks; ++i) {
+		Tasks[i].prio = GLB_PRIO;
+		for (k = 0; k < (int)GLB_NPERIODS; ++k)
+			if (GlbPeriodsMs[k] * NSEC_PER_MSEC < Tasks[i].period)
+				Tasks[i].prio--;
+	}
+
+	/* worst-fit decreasing for the partitioned placement */
+	qsort(order, ntasks, sizeof(GLB_TASK *), _glb_by_util);
+	for (i = 0; i < ntasks; ++i) {
+		best = 0;
+		for (k = 1; k < ncpus; ++k)
+			if (load[k] < load[best])
+				best = k;
+		load[best] += (double)order[i]->exe / order[i]->period;
+		order[i]->cpu = Cpus[best];
+	}
+}
+/*****************************************************************************/
+static int _glb_run(GLB_PLACEMENT placement, int duration)
+{
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[GLB_MAX_TASKS];
+	RT_HIST all, local, migrated;
+	uint64_t within = 0, between = 0, jobs = 0, misses = 0, moved = 0;
+	cpu_set_t set;
+	FILE *fp;
+	int i, started;
+
+	CPU_ZERO(&set);
+	for (i = 0; i < ncpus; ++i)
+		CPU_SET(Cpus[i], &set);
+
+	for (i = 0; i < ntasks; ++i) {
+		GLB_STATS *s = &Tasks[i].result[placement];
+		memset(s, 0, sizeof(*s));
+		init_rt_hist(&s->resp, Tasks[i].name);
+		init_rt_hist(&s->stretch_local, "stretch_local");
+		init_rt_hist(&s->stretch_migrated, "stretch_migrated");
+		Tasks[i].stats = s;
+		Tasks[i].last_cpu = -1;
+		Tasks[i].done = 0;
+	}
+	t_start = rt_timer_read() + NSEC_PER_SEC;
+	t_end = t_start + (uint64_t)duration * NSEC_PER_SEC;
+
+	/* a failed task aborts the run, the started ones end at once */
+	for (started = 0; started < ntasks; ++started) {
+		if (create_rt_task(&Tasks[started].task, Tasks[started].name, Tasks[started].prio) != 0)
+			break;
+		if (placement == GLB_GLOBAL)
+			set_rt_task_cpus(&Tasks[started].task, &set);
+		else
+			set_rt_task_affinity(&Tasks[started].task, Tasks[started].cpu);
+		if (start_rt_task_arg(1, &Tasks[started].task, &GlbTask, &Tasks[started]) != 0)
+			break;
+	}
+	if (started < ntasks)
+		bBenchQuit = on;
+	for (i = 0; i < started; ++i)
+		if (bench_wait_done(&Tasks[i].done) != 0)
+			return -1;
+	if (started < ntasks)
+		return -1;
+
+	init_rt_hist(&all, "response");
+	init_rt_hist(&local, "stretch_local");
+	init_rt_hist(&migrated, "stretch_migrated");
+	for (i = 0; i < ntasks; ++i) {
+		GLB_STATS *s = &Tasks[i].result[placement];
+		merge_rt_hist(&all, &s->resp);
+		merge_rt_hist(&local, &s->stretch_local);
+		merge_rt_hist(&migrated, &s->stretch_migrated);
+		within += s->within;
+		between += s->between;
+		moved += s->migrated_jobs;
+		jobs += s->jobs;
+		misses += s->misses;
+		hists[i] = &s->resp;
+	}
+
+	printf("%s: %lu jobs, %lu misses, %lu migrations within jobs (%lu jobs), %lu between jobs\n",
+			GlbPlacementNames[placement], (unsigned long)jobs, (unsigned long)misses,
+			(unsigned long)within, (unsigned long)moved, (unsigned long)between);
+	print_rt_hist(stdout, &all);
+	print_rt_hist(stdout, &local);
+	print_rt_hist(stdout, &migrated);
+
+	snprintf(name, sizeof(name), "global_%s_hist", GlbPlacementNames[placement]);
+	fp = bench_open_result(name, filename, sizeof(filename));
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, ntasks);
+		fclose(fp);
+	}
+	snprintf(name, sizeof(name), "global_%s_stretch_hist", GlbPlacementNames[placement]);
+	fp = bench_open_result(name, NULL, 0);
+	if (fp != NULL) {
+		RT_HIST *stretch[2] = {&local, &migrated};
+		write_rt_hist(fp, stretch, 2);
+		fclose(fp);
+	}
+	return 0;
+}
+/*****************************************************************************/
+static void _glb_usage(void)
+{
+	printf("usage: global [-m partitioned|global|all] [-n tasks] [-u util_per_cpu] [-c cpus]\n");
+	printf("              [-d sec_per_placement] [-s seed]\n");
+}
+/*****************************************************************************/
+int bench_global_main(int argc, char **argv)
+{
+	char *only = "all";
+	char filename[256];
+	char list[256];
+	double util = GLB_UTIL;
+	int duration = GLB_DURATION;
+	int online = bench_num_cpus();
+	FLAG ran[GLB_PLACEMENTS] = {off, off};
+	FILE *summary;
+	int c, i, k, len;
+
+	ncpus = online;
+	optind = 1;
+	while ((c = getopt(argc, argv, "m:n:u:c:d:s:h")) != -1) {
+		switch (c) {
+			case 'm': only = optarg; break;
+			case 'n': ntasks = atoi(optarg); break;
+			case 'u': util = atof(optarg); break;
+			case 'c': ncpus = atoi(optarg); break;
+			case 'd': duration = atoi(optarg); break;
+			case 's': seed = atoi(optarg); break;
+			default: _glb_usage(); return 1;
+		}
+	}
+	if (ncpus < 1 || ncpus > online || ncpus > GLB_MAX_CPUS) {
+		fprintf(stderr, "[GLB] cpus must be within 1..%d\n", online < GLB_MAX_CPUS ? online : GLB_MAX_CPUS);
+		return 1;
+	}
+	if (ntasks == 0)
+		ntasks = GLB_TASKS_PER_CPU * ncpus;
+	if (ntasks < 1 || ntasks > GLB_MAX_TASKS) {
+		fprintf(stderr, "[GLB] tasks must be within 1..%d\n", GLB_MAX_TASKS);
+		return 1;
+	}
+
+	/* the quietest cpus form the set */
+	for (k = 0, len = 0; k < ncpus; ++k) {
+		Cpus[k] = bench_quiet_cpu(k);
+		len += snprintf(list + len, sizeof(list) - len, "%s%d", k ? "," : "", Cpus[k]);
+	}
+	_glb_generate(util);
+
+	bench_init(Cpus[0]);
+	bench_meta("global_cpus: %s", list);
+	summary = bench_open_result("global_summary", filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# placement,task,cpu,prio,period_ns,exe_ns,jobs,misses,migrated_jobs,migrations_within,migrations_between,cpus_used,resp_p50_ns,resp_p99_ns,resp_max_ns\n");
+
+	printf("Global scheduling: %d tasks on cpus %s, utilization %.2f per cpu, %d s per placement\n",
+			ntasks, list, util, duration);
+	if (ncpus == 1)
+		printf("[GLB] only one cpu in the set, both placements are the same\n");
+	print_rt_hist_header(stdout);
+
+	for (k = 0; k < GLB_PLACEMENTS && bBenchQuit == off; ++k)
+		if (strcmp(only, "all") == 0 || strcmp(only, GlbPlacementNames[k]) == 0) {
+			if (_glb_run(k, duration) == 0)
+				ran[k] = on;
+		}
+
+	for (k = 0; k < GLB_PLACEMENTS; ++k) {
+		if (ran[k] == off)
+			continue;
+		for (i = 0; i < ntasks; ++i) {
+			GLB_STATS *s = &Tasks[i].result[k];
+			fprintf(summary, "%s,%s,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%d,%lu,%lu,%lu\n",
+					GlbPlacementNames[k], Tasks[i].name, k == GLB_GLOBAL ? -1 : Tasks[i].cpu,
+					Tasks[i].prio, (unsigned long)Tasks[i].period, (unsigned long)Tasks[i].exe,
+					(unsigned long)s->jobs, (unsigned long)s->misses,
+					(unsigned long)s->migrated_jobs, (unsigned long)s->within,
+					(unsigned long)s->between, __builtin_popcountll(s->cpus_used),
+					(unsigned long)get_rt_hist_percentile(&s->resp, 50),
+					(unsigned long)get_rt_hist_percentile(&s->resp, 99),
+					(unsigned long)s->resp.max);
+		}
+	}
+	fclose(summary);
+
+	/* side by side: p99 / max response of every task */
+	printf("Response p99 / max [us]\n%-12s %4s %6s", "", "prio", "T[ms]");
+	for (k = 0; k < GLB_PLACEMENTS; ++k)
+		if (ran[k] == on)
+			printf(" %23s", GlbPlacementNames[k]);
+	printf(" %10s\n", "migrations");
+	for (i = 0; i < ntasks; ++i) {
+		printf("%-12s %4d %6lu", Tasks[i].name, Tasks[i].prio, (unsigned long)(Tasks[i].period / NSEC_PER_MSEC));
+		for (k = 0; k < GLB_PLACEMENTS; ++k)
+			if (ran[k] == on)
+				printf(" %11.3f %11.3f", get_rt_hist_percentile(&Tasks[i].result[k].resp, 99) / 1000.0,
+						Tasks[i].result[k].resp.max / 1000.0);
+		printf(" %10lu\n", ran[GLB_GLOBAL] == on ?
+				(unsigned long)(Tasks[i].result[GLB_GLOBAL].within + Tasks[i].result[GLB_GLOBAL].between) : 0UL);
+	}
+	printf("Global summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
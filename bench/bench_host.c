@@ -0,0 +1,314 @@
+/*
+ *  Host real-time readiness.
+ *
+ *  Collects what decides whether a run is worth comparing: kernel and
+ *  preemption model, isolated / nohz_full cpus, SMT, frequency governors,
+ *  RT throttling, timer migration, clocksource and the interrupt rate of
+ *  every cpu. The profile goes into the run metadata, the quietest cpus are
+ *  offered to the scenarios and the PM QoS request on /dev/cpu_dma_latency
+ *  is held until the process exits.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/utsname.h>
+/*****************************************************************************/
+#define HOST_MAX_CPUS	(256)
+#define HOST_IRQ_US		(200000) // interrupt rate sampling window
+#define HOST_LINE		(4096)
+#define HOST_DMA_LATENCY "/dev/cpu_dma_latency"
+
+typedef struct {
+	int cpu;
+	FLAG allowed; // in our affinity mask
+	FLAG isolated;
+	FLAG nohz;
+	FLAG sibling_busy; // an SMT sibling is not isolated
+	double irq_rate; // per second
+	double score;
+	char governor[32];
+}HOST_CPU;
+/*****************************************************************************/
+static HOST_CPU HostCpus[HOST_MAX_CPUS];
+static int HostOrder[HOST_MAX_CPUS]; // quietest first
+static int ncpus = 0;
+static FLAG bScanned = off;
+static FLAG bProfiled = off;
+static int DmaFd = -1;
+/*****************************************************************************/
+static int _host_read(char *path, char *buf, int size)
+{
+	FILE *fp = fopen(path, "r");
+	int len;
+
+	buf[0] = '\0';
+	if (fp == NULL)
+		return -errno;
+	if (fgets(buf, size, fp) == NULL)
+		buf[0] = '\0';
+	fclose(fp);
+	len = strlen(buf);
+	while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == ' '))
+		buf[--len] = '\0';
+	return len;
+}
+/*****************************************************************************/
+/* "0-2,5" style cpu lists */
+static void _host_parse_list(char *list, FLAG *set, size_t stride)
+{
+	char *tok, *save, *dash;
+	int a, b;
+
+	for (tok = strtok_r(list, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+		a = atoi(tok);
+		dash = strchr(tok, '-');
+		b = (dash != NULL) ? atoi(dash + 1) : a;
+		for (; a <= b && a < ncpus; ++a)
+			if (a >= 0)
+				*(FLAG *)((char *)set + a * stride) = on;
+	}
+}
+/*****************************************************************************/
+/* interrupts per cpu, summed over every line of /proc/interrupts */
+static int _host_irqs(uint64_t *irqs)
+{
+	char line[HOST_LINE];
+	char *p, *end;
+	int k, ncol = 0;
+	FILE *fp;
+
+	memset(irqs, 0, sizeof(uint64_t) * ncpus);
+	fp = fopen("/proc/interrupts", "r");
+	if (fp == NULL)
+		return -errno;
+	if (fgets(line, sizeof(line), fp) != NULL)
+		for (p = strstr(line, "CPU"); p != NULL; p = strstr(p + 3, "CPU"))
+			ncol++;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		p = strchr(line, ':');
+		if (p == NULL)
+			continue;
+		++p;
+		for (k = 0; k < ncol; ++k) {
+			uint64_t v = strtoull(p, &end, 10);
+			if (end == p)
+				break;
+			if (k < ncpus)
+				irqs[k] += v;
+			p = end;
+		}
+	}
+	fclose(fp);
+	return 0;
+}
+/*****************************************************************************/
+static int _host_by_score(const void *a, const void *b)
+{
+	const HOST_CPU *ca = &HostCpus[*(const int *)a], *cb = &HostCpus[*(const int *)b];
+
+	if (ca->score != cb->score)
+		return ca->score > cb->score ? -1 : 1;
+	return ca->cpu - cb->cpu;
+}
+/*****************************************************************************/
+static void _host_scan(void)
+{
+	static uint64_t irq0[HOST_MAX_CPUS], irq1[HOST_MAX_CPUS];
+	char path[256], buf[HOST_LINE];
+	FLAG siblings[HOST_MAX_CPUS];
+	cpu_set_t mask;
+	HOST_CPU *c;
+	int i, k;
+
+	if (bScanned == on)
+		return;
+	bScanned = on;
+
+	ncpus = bench_num_cpus();
+	if (ncpus > HOST_MAX_CPUS)
+		ncpus = HOST_MAX_CPUS;
+	memset(HostCpus, 0, sizeof(HostCpus));
+	CPU_ZERO(&mask);
+	sched_getaffinity(0, sizeof(mask), &mask);
+	for (i = 0; i < ncpus; ++i) {
+		HostCpus[i].cpu = i;
+		HostCpus[i].allowed = CPU_ISSET(i, &mask) ? on : off;
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", i);
+		if (_host_read(path, HostCpus[i].governor, sizeof(HostCpus[i].governor)) <= 0)
+			snprintf(HostCpus[i].governor, sizeof(HostCpus[i].governor), "none");
+	}
+
+	if (_host_read("/sys/devices/system/cpu/isolated", buf, sizeof(buf)) > 0)
+		_host_parse_list(buf, &HostCpus[0].isolated, sizeof(HOST_CPU));
+	if (_host_read("/sys/devices/system/cpu/nohz_full", buf, sizeof(buf)) > 0)
+		_host_parse_list(buf, &HostCpus[0].nohz, sizeof(HOST_CPU));
+
+	for (i = 0; i < ncpus; ++i) {
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", i);
+		if (_host_read(path, buf, sizeof(buf)) <= 0)
+			continue;
+		memset(siblings, 0, sizeof(siblings));
+		_host_parse_list(buf, siblings, sizeof(FLAG));
+		for (k = 0; k < ncpus; ++k)
+			if (k != i && siblings[k] == on && HostCpus[k].isolated == off)
+				HostCpus[i].sibling_busy = on;
+	}
+
+	_host_irqs(irq0);
+	usleep(HOST_IRQ_US);
+	_host_irqs(irq1);
+
+	/* isolation first, then a quiet tick and few interrupts, cpu 0 is left
+	 * to the housekeeping when there is a choice */
+	for (i = 0; i < ncpus; ++i) {
+		c = &HostCpus[i];
+		c->irq_rate = (double)(irq1[i] - irq0[i]) * 1000000.0 / HOST_IRQ_US;
+		c->score = -c->irq_rate;
+		if (c->isolated == on)
+			c->score += 1000000.0;
+		if (c->nohz == on)
+			c->score += 100000.0;
+		if (c->sibling_busy == on)
+			c->score -= 10000.0;
+		if (i == 0)
+			c->score -= 1000.0;
+		if (c->allowed == off)
+			c->score -= 10000000.0;
+		HostOrder[i] = i;
+	}
+	qsort(HostOrder, ncpus, sizeof(int), _host_by_score);
+}
+/*****************************************************************************/
+int bench_quiet_cpu(int rank)
+{
+	_host_scan();
+	return HostOrder[rank % ncpus];
+}
+/*****************************************************************************/
+int bench_select_cpu(int cpu)
+{
+	if (cpu != BENCH_CPU_AUTO)
+		return cpu;
+	return bench_quiet_cpu(0);
+}
+/*****************************************************************************/
+/* holds the PM QoS request, the kernel drops it when the fd is closed */
+static int _host_hold_dma_latency(void)
+{
+	int32_t latency = 0;
+
+	if (DmaFd >= 0)
+		return 0;
+	DmaFd = open(HOST_DMA_LATENCY, O_RDWR);
+	if (DmaFd < 0)
+		return -errno;
+	if (write(DmaFd, &latency, sizeof(latency)) != sizeof(latency)) {
+		close(DmaFd);
+		DmaFd = -1;
+		return -errno;
+	}
+	return 0;
+}
+/*****************************************************************************/
+/* a "cpu,cpu,..." list of one field per cpu */
+static void _host_meta_cpus(char *key, char *buf, int size, int (*field)(HOST_CPU *c, char *out, int size))
+{
+	int i, len = 0;
+
+	for (i = 0; i < ncpus && len < size - 1; ++i) {
+		if (i > 0)
+			buf[len++] = ',';
+		len += field(&HostCpus[i], buf + len, size - len);
+	}
+	buf[len < size ? len : size - 1] = '\0';
+	bench_meta("%s: %s", key, buf);
+}
+static int _host_governor(HOST_CPU *c, char *out, int size)
+{
+	return snprintf(out, size, "%s", c->governor);
+}
+static int _host_irq_rate(HOST_CPU *c, char *out, int size)
+{
+	return snprintf(out, size, "%.0f", c->irq_rate);
+}
+/*****************************************************************************/
+int bench_host_init(void)
+{
+	char buf[HOST_LINE], buf2[HOST_LINE];
+	struct utsname uts;
+	char *preempt = "none";
+	long runtime, period;
+	int i, len, ret, rt = 0;
+
+	if (bProfiled == on)
+		return 0;
+	bProfiled = on;
+	_host_scan();
+
+	if (uname(&uts) == 0) {
+		if (strstr(uts.version, "PREEMPT_RT") != NULL)
+			preempt = "PREEMPT_RT";
+		else if (strstr(uts.version, "PREEMPT_DYNAMIC") != NULL)
+			preempt = "PREEMPT_DYNAMIC";
+		else if (strstr(uts.version, "PREEMPT") != NULL)
+			preempt = "PREEMPT";
+		bench_meta("host: %s %s", uts.nodename, uts.machine);
+		bench_meta("kernel: %s %s", uts.release, uts.version);
+	}
+	if (_host_read("/sys/kernel/realtime", buf, sizeof(buf)) > 0)
+		rt = atoi(buf);
+	bench_meta("preempt: %s%s", preempt, rt ? " (realtime)" : "");
+#ifdef _XENOMAI_TASKS_
+	bench_meta("rt_domain: xenomai");
+#else
+	bench_meta("rt_domain: posix");
+#endif
+	if (_host_read("/proc/cmdline", buf, sizeof(buf)) > 0)
+		bench_meta("cmdline: %s", buf);
+	bench_meta("cpus_online: %d", ncpus);
+	_host_read("/sys/devices/system/cpu/isolated", buf, sizeof(buf));
+	bench_meta("isolated: %s", buf[0] ? buf : "none");
+	_host_read("/sys/devices/system/cpu/nohz_full", buf, sizeof(buf));
+	bench_meta("nohz_full: %s", (buf[0] && strcmp(buf, "(null)") != 0) ? buf : "none");
+	_host_read("/sys/devices/system/cpu/smt/active", buf, sizeof(buf));
+	bench_meta("smt_active: %s", buf[0] ? buf : "unknown");
+	_host_meta_cpus("governors", buf, sizeof(buf), _host_governor);
+	_host_read("/proc/sys/kernel/sched_rt_runtime_us", buf, sizeof(buf));
+	_host_read("/proc/sys/kernel/sched_rt_period_us", buf2, sizeof(buf2));
+	runtime = atol(buf);
+	period = atol(buf2);
+	bench_meta("rt_throttling: %s/%s us", buf[0] ? buf : "?", buf2[0] ? buf2 : "?");
+	_host_read("/proc/sys/kernel/timer_migration", buf, sizeof(buf));
+	bench_meta("timer_migration: %s", buf[0] ? buf : "unknown");
+	_host_read("/sys/devices/system/clocksource/clocksource0/current_clocksource", buf, sizeof(buf));
+	bench_meta("clocksource: %s", buf[0] ? buf : "unknown");
+	_host_meta_cpus("irq_per_sec", buf, sizeof(buf), _host_irq_rate);
+	for (i = 0, len = 0; i < ncpus && i < 16; ++i)
+		len += snprintf(buf2 + len, sizeof(buf2) - len, "%s%d", i ? "," : "", HostOrder[i]);
+	bench_meta("quiet_cpus: %s", buf2);
+
+	ret = _host_hold_dma_latency();
+	if (ret == 0)
+		bench_meta("cpu_dma_latency: held at 0 us");
+	else
+		bench_meta("cpu_dma_latency: not held (%s)", strerror(-ret));
+
+	/* what would make the numbers of this run incomparable */
+	if (HostCpus[HostOrder[0]].isolated == off)
+		fprintf(stderr, "[HOST] no isolated cpu, the RT tasks share their cpu with everything else\n");
+	if (runtime >= 0 && runtime < period)
+		fprintf(stderr, "[HOST] RT throttling active (%ld of %ld us)\n", runtime, period);
+	if (ret != 0)
+		fprintf(stderr, "[HOST] cannot hold %s, deep C-states stay allowed\n", HOST_DMA_LATENCY);
+	for (i = 0; i < ncpus; ++i)
+		if (strcmp(HostCpus[i].governor, "none") != 0 && strcmp(HostCpus[i].governor, "performance") != 0) {
+			fprintf(stderr, "[HOST] cpu%d runs the %s governor\n", i, HostCpus[i].governor);
+			break;
+		}
+	return 0;
+}
+/*****************************************************************************/
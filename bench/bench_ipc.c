@@ -0,0 +1,467 @@
+/*
+ *  Inter-task round-trip latency (ping-pong) over several IPC mechanisms.
+ *
+ *  A periodic "ping" task stamps a message and sends it to a blocked, higher
+ *  priority "pong" task which answers immediately. Per mechanism we record
+ *    rtt  : ping send -> ping wakes up with the answer
+ *    owl  : ping send -> pong wakes up (one-way wakeup latency)
+ *    ret  : pong send -> ping wakes up (one-way wakeup latency, way back)
+ *  once with both tasks on the same cpu and once across two cpus.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+/*****************************************************************************/
+#define IPC_PRIO		(90) // pong runs one above
+#define IPC_PRD			(1000) // us
+#define IPC_ITERATIONS	(10000)
+#define IPC_WARMUP		(100)
+#define IPC_STOP		(0) // message that ends the pong task
+#define IPC_MAX_FAILS	(100) // failed calls in a row that end a task
+
+#define PING 0 // direction ping -> pong
+#define PONG 1 // direction pong -> ping
+
+typedef struct IPC_CHAN IPC_CHAN;
+
+typedef struct {
+	char *name;
+	int (*open)(IPC_CHAN *ch);
+	int (*send)(IPC_CHAN *ch, int dir, uint64_t msg);
+	int (*recv)(IPC_CHAN *ch, int dir, uint64_t *msg);
+	void (*close)(IPC_CHAN *ch);
+}IPC_MECH;
+
+struct IPC_CHAN {
+	IPC_MECH *mech;
+	uint64_t slot[2]; // payload for futex, eventfd and condvar
+	int seq[2]; // futex words / condvar predicates
+	int seen[2];
+	int fd[2][2]; // [dir][0: read end, 1: write end]
+	mqd_t mq[2];
+	char mq_name[2][64];
+	pthread_mutex_t mtx;
+	pthread_cond_t cond[2];
+};
+/*****************************************************************************/
+static int _futex_open(IPC_CHAN *ch);
+static int _futex_send(IPC_CHAN *ch, int dir, uint64_t msg);
+static int _futex_recv(IPC_CHAN *ch, int dir, uint64_t *msg);
+static void _futex_close(IPC_CHAN *ch);
+static int _eventfd_open(IPC_CHAN *ch);
+static int _eventfd_send(IPC_CHAN *ch, int dir, uint64_t msg);
+static int _eventfd_recv(IPC_CHAN *ch, int dir, uint64_t *msg);
+static int _pipe_open(IPC_CHAN *ch);
+static int _fd_send(IPC_CHAN *ch, int dir, uint64_t msg);
+static int _fd_recv(IPC_CHAN *ch, int dir, uint64_t *msg);
+static void _fd_close(IPC_CHAN *ch);
+static int _mq_open(IPC_CHAN *ch);
+static int _mq_send(IPC_CHAN *ch, int dir, uint64_t msg);
+static int _mq_recv(IPC_CHAN *ch, int dir, uint64_t *msg);
+static void _mq_close(IPC_CHAN *ch);
+static int _socket_open(IPC_CHAN *ch);
+static void _socket_close(IPC_CHAN *ch);
+static int _condvar_open(IPC_CHAN *ch);
+static int _condvar_send(IPC_CHAN *ch, int dir, uint64_t msg);
+static int _condvar_recv(IPC_CHAN *ch, int dir, uint64_t *msg);
+static void _condvar_close(IPC_CHAN *ch);
+
+static IPC_MECH IpcMechs[] = {
+	{"futex",	_futex_open,	_futex_send,	_futex_recv,	_futex_close},
+	{"eventfd",	_eventfd_open,	_eventfd_send,	_eventfd_recv,	_fd_close},
+	{"pipe",	_pipe_open,		_fd_send,		_fd_recv,		_fd_close},
+	{"mqueue",	_mq_open,		_mq_send,		_mq_recv,		_mq_close},
+	{"socket",	_socket_open,	_fd_send,		_fd_recv,		_socket_close},
+	{"condvar",	_condvar_open,	_condvar_send,	_condvar_recv,	_condvar_close},
+	{NULL, NULL, NULL, NULL, NULL}
+};
+/*****************************************************************************/
+static RT_TASK TskPing;
+static RT_TASK TskPong;
+static IPC_CHAN Chan;
+
+static RT_HIST HistRtt;
+static RT_HIST HistOwl;
+static RT_HIST HistRet;
+
+static int iterations = IPC_ITERATIONS;
+static volatile FLAG bMeasuring = off;
+static volatile int bPingDone = 0;
+static volatile int bPongDone = 0;
+static uint64_t IpcFailed = 0; // round trips with a failed send or receive, atomic
+/*****************************************************************************/
+static void IpcPingTask(void *arg)
+{
+	uint64_t t0, reply, now;
+	int i, fails = 0;
+
+	for (i = 0; i < iterations + IPC_WARMUP && bBenchQuit == off && fails < IPC_MAX_FAILS; ++i) {
+		wait_rt_period(&TskPing);
+		if (i == IPC_WARMUP)
+			bMeasuring = on;
+
+		/* no answer comes to a failed send, a failed receive has none */
+		t0 = rt_timer_read();
+		if (Chan.mech->send(&Chan, PING, t0) != 0 || Chan.mech->recv(&Chan, PONG, &reply) != 0) {
+			__atomic_add_fetch(&IpcFailed, 1, __ATOMIC_RELAXED);
+			++fails;
+			continue;
+		}
+		now = rt_timer_read();
+		fails = 0;
+
+		if (bMeasuring == on) {
+			add_rt_hist(&HistRtt, now - t0);
+			add_rt_hist(&HistRet, now - reply);
+		}
+	}
+	Chan.mech->send(&Chan, PING, IPC_STOP);
+	bench_signal_done(&bPingDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void IpcPongTask(void *arg)
+{
+	uint64_t msg, now;
+	int fails = 0;
+
+	while (fails < IPC_MAX_FAILS) {
+		if (Chan.mech->recv(&Chan, PING, &msg) != 0) {
+			__atomic_add_fetch(&IpcFailed, 1, __ATOMIC_RELAXED);
+			if (bBenchQuit == on)
+				break;
+			++fails;
+			continue;
+		}
+		now = rt_timer_read();
+		fails = 0;
+		if (msg == IPC_STOP)
+			break;
+		if (bMeasuring == on)
+			add_rt_hist(&HistOwl, now - msg);
+		if (Chan.mech->send(&Chan, PONG, rt_timer_read()) != 0)
+			__atomic_add_fetch(&IpcFailed, 1, __ATOMIC_RELAXED);
+	}
+	bench_signal_done(&bPongDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static int _ipc_run(IPC_MECH *mech, char *placement, int cpu_ping, int cpu_pong, int prio, int period)
+{
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[3] = {&HistRtt, &HistOwl, &HistRet};
+	FILE *fp;
+
+	memset(&Chan, 0, sizeof(Chan));
+	Chan.mech = mech;
+	if (mech->open(&Chan) != 0) {
+		fprintf(stderr, "[IPC] cannot open %s channel, skipped\n", mech->name);
+		return -1;
+	}
+
+	init_rt_hist(&HistRtt, "rtt");
+	init_rt_hist(&HistOwl, "owl");
+	init_rt_hist(&HistRet, "ret");
+	bMeasuring = off;
+	bPingDone = 0;
+	bPongDone = 0;
+	IpcFailed = 0;
+
+	if (create_rt_task(&TskPong, "ipc_pong", prio + 1) != 0 || create_rt_task(&TskPing, "ipc_ping", prio) != 0) {
+		mech->close(&Chan);
+		bBenchQuit = on;
+		return -1;
+	}
+	set_rt_task_affinity(&TskPong, cpu_pong);
+	set_rt_task_affinity(&TskPing, cpu_ping);
+	set_rt_task_period(&TskPing, (RTIME)period * NSEC_PER_USEC);
+	if (start_rt_task(1, &TskPong, &IpcPongTask) != 0) {
+		mech->close(&Chan);
+		bBenchQuit = on;
+		return -1;
+	}
+	if (start_rt_task(1, &TskPing, &IpcPingTask) != 0) {
+		/* the pong task waits for a message, the stop of the ping task ends it */
+		Chan.mech->send(&Chan, PING, IPC_STOP);
+		bBenchQuit = on;
+		if (bench_wait_done(&bPongDone) == 0)
+			mech->close(&Chan);
+		return -1;
+	}
+
+	/* a task still running keeps its channel */
+	if (bench_wait_done(&bPingDone) != 0 || bench_wait_done(&bPongDone) != 0)
+		return -1;
+	mech->close(&Chan);
+
+	snprintf(name, sizeof(name), "%s/%s", mech->name, placement);
+	printf("%s\n", name);
+	print_rt_hist(stdout, &HistRtt);
+	print_rt_hist(stdout, &HistOwl);
+	print_rt_hist(stdout, &HistRet);
+	if (IpcFailed > 0)
+		printf("[IPC] %lu failed round trips skipped\n", (unsigned long)IpcFailed);
+
+	snprintf(name, sizeof(name), "ipc_%s_%s_hist", mech->name, placement);
+	fp = bench_open_result(name, filename, sizeof(filename));
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, 3);
+		fclose(fp);
+		printf("Histogram datafile is generated at:%s\n", filename);
+	}
+	return 0;
+}
+/*****************************************************************************/
+static void _ipc_usage(void)
+{
+	int i;
+
+	printf("usage: ipc [-m mechanism] [-n iterations] [-p period_us] [-P prio] [-c cpu] [-C cross_cpu]\n");
+	printf("mechanisms:");
+	for (i = 0; IpcMechs[i].name != NULL; ++i)
+		printf(" %s", IpcMechs[i].name);
+	printf("\n");
+}
+/*****************************************************************************/
+int bench_ipc_main(int argc, char **argv)
+{
+	char *only = NULL;
+	int period = IPC_PRD;
+	int prio = IPC_PRIO;
+	int cpu = BENCH_CPU_AUTO, cross_cpu = -1;
+	int ncpu = bench_num_cpus();
+	int c, i;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "m:n:p:P:c:C:h")) != -1) {
+		switch (c) {
+			case 'm': only = optarg; break;
+			case 'n': iterations = atoi(optarg); break;
+			case 'p': period = atoi(optarg); break;
+			case 'P': prio = atoi(optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			case 'C': cross_cpu = atoi(optarg); break;
+			default: _ipc_usage(); return 1;
+		}
+	}
+	/* pong runs one above ping and must stay a valid fifo priority */
+	if (prio < 1 || prio > 98) {
+		fprintf(stderr, "[IPC] priority must be within 1..98\n");
+		return 1;
+	}
+	/* the cross-core partner is the next quietest cpu */
+	if (cross_cpu < 0)
+		cross_cpu = (cpu == BENCH_CPU_AUTO) ? bench_quiet_cpu(1) : (cpu + 1) % ncpu;
+	cpu = bench_select_cpu(cpu);
+
+	bench_init(cpu);
+	printf("IPC ping-pong: %d iterations every %d us, prio %d/%d\n", iterations, period, prio, prio + 1);
+	print_rt_hist_header(stdout);
+
+	for (i = 0; IpcMechs[i].name != NULL && bBenchQuit == off; ++i) {
+		if (only != NULL && strcmp(only, IpcMechs[i].name) != 0)
+			continue;
+		_ipc_run(&IpcMechs[i], "same", cpu, cpu, prio, period);
+		if (cross_cpu != cpu && bBenchQuit == off)
+			_ipc_run(&IpcMechs[i], "cross", cpu, cross_cpu, prio, period);
+	}
+	if (cross_cpu == cpu)
+		printf("[IPC] only one cpu online, cross-core runs skipped\n");
+	return 0;
+}
+/*****************************************************************************/
+/* futex: sequence word + payload slot */
+/*****************************************************************************/
+static int _futex_open(IPC_CHAN *ch)
+{
+	return 0;
+}
+static int _futex_send(IPC_CHAN *ch, int dir, uint64_t msg)
+{
+	ch->slot[dir] = msg;
+	__atomic_add_fetch(&ch->seq[dir], 1, __ATOMIC_RELEASE);
+	return syscall(SYS_futex, &ch->seq[dir], FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0) < 0 ? -errno : 0;
+}
+static int _futex_recv(IPC_CHAN *ch, int dir, uint64_t *msg)
+{
+	int cur;
+
+	while ((cur = __atomic_load_n(&ch->seq[dir], __ATOMIC_ACQUIRE)) == ch->seen[dir])
+		syscall(SYS_futex, &ch->seq[dir], FUTEX_WAIT_PRIVATE, cur, NULL, NULL, 0);
+	ch->seen[dir] = cur;
+	*msg = ch->slot[dir];
+	return 0;
+}
+static void _futex_close(IPC_CHAN *ch)
+{
+}
+/*****************************************************************************/
+/* eventfd: counter wakes the reader, payload goes through the slot */
+/*****************************************************************************/
+static int _eventfd_open(IPC_CHAN *ch)
+{
+	int dir;
+
+	for (dir = PING; dir <= PONG; ++dir) {
+		ch->fd[dir][0] = ch->fd[dir][1] = eventfd(0, 0);
+		if (ch->fd[dir][0] < 0) {
+			int err = -errno;
+
+			if (dir == PONG)
+				close(ch->fd[PING][0]);
+			return err;
+		}
+	}
+	return 0;
+}
+static int _eventfd_send(IPC_CHAN *ch, int dir, uint64_t msg)
+{
+	uint64_t one = 1;
+
+	__atomic_store_n(&ch->slot[dir], msg, __ATOMIC_RELEASE);
+	return write(ch->fd[dir][1], &one, sizeof(one)) == sizeof(one) ? 0 : -errno;
+}
+static int _eventfd_recv(IPC_CHAN *ch, int dir, uint64_t *msg)
+{
+	uint64_t cnt;
+
+	if (read(ch->fd[dir][0], &cnt, sizeof(cnt)) != sizeof(cnt))
+		return -errno;
+	*msg = __atomic_load_n(&ch->slot[dir], __ATOMIC_ACQUIRE);
+	return 0;
+}
+/*****************************************************************************/
+/* pipe: the timestamp itself is the payload */
+/*****************************************************************************/
+static int _pipe_open(IPC_CHAN *ch)
+{
+	int dir;
+
+	for (dir = PING; dir <= PONG; ++dir)
+		if (pipe(ch->fd[dir]) != 0)
+			return -errno;
+	return 0;
+}
+static int _fd_send(IPC_CHAN *ch, int dir, uint64_t msg)
+{
+	return write(ch->fd[dir][1], &msg, sizeof(msg)) == sizeof(msg) ? 0 : -errno;
+}
+static int _fd_recv(IPC_CHAN *ch, int dir, uint64_t *msg)
+{
+	return read(ch->fd[dir][0], msg, sizeof(*msg)) == sizeof(*msg) ? 0 : -errno;
+}
+static void _fd_close(IPC_CHAN *ch)
+{
+	int dir;
+
+	for (dir = PING; dir <= PONG; ++dir) {
+		close(ch->fd[dir][0]);
+		if (ch->fd[dir][1] != ch->fd[dir][0])
+			close(ch->fd[dir][1]);
+	}
+}
+/*****************************************************************************/
+/* POSIX message queue, one queue per direction */
+/*****************************************************************************/
+static int _mq_open(IPC_CHAN *ch)
+{
+	struct mq_attr attr = { .mq_maxmsg = 1, .mq_msgsize = sizeof(uint64_t) };
+	int dir;
+
+	for (dir = PING; dir <= PONG; ++dir) {
+		snprintf(ch->mq_name[dir], sizeof(ch->mq_name[dir]), "/rt_bench_ipc_%d_%d", getpid(), dir);
+		ch->mq[dir] = mq_open(ch->mq_name[dir], O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+		if (ch->mq[dir] == (mqd_t)-1)
+			return -errno;
+	}
+	return 0;
+}
+static int _mq_send(IPC_CHAN *ch, int dir, uint64_t msg)
+{
+	return mq_send(ch->mq[dir], (char *)&msg, sizeof(msg), 0) ? -errno : 0;
+}
+static int _mq_recv(IPC_CHAN *ch, int dir, uint64_t *msg)
+{
+	return mq_receive(ch->mq[dir], (char *)msg, sizeof(*msg), NULL) == sizeof(*msg) ? 0 : -errno;
+}
+static void _mq_close(IPC_CHAN *ch)
+{
+	int dir;
+
+	for (dir = PING; dir <= PONG; ++dir) {
+		mq_close(ch->mq[dir]);
+		mq_unlink(ch->mq_name[dir]);
+	}
+}
+/*****************************************************************************/
+/* unix datagram socket pair, each end is used in both directions */
+/*****************************************************************************/
+static int _socket_open(IPC_CHAN *ch)
+{
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) != 0)
+		return -errno;
+	ch->fd[PING][1] = sv[0];
+	ch->fd[PING][0] = sv[1];
+	ch->fd[PONG][1] = sv[1];
+	ch->fd[PONG][0] = sv[0];
+	return 0;
+}
+static void _socket_close(IPC_CHAN *ch)
+{
+	close(ch->fd[PING][0]);
+	close(ch->fd[PING][1]);
+}
+/*****************************************************************************/
+/* condition variable on a priority inheritance mutex */
+/*****************************************************************************/
+static int _condvar_open(IPC_CHAN *ch)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+	pthread_mutex_init(&ch->mtx, &attr);
+	pthread_mutexattr_destroy(&attr);
+	pthread_cond_init(&ch->cond[PING], NULL);
+	pthread_cond_init(&ch->cond[PONG], NULL);
+	return 0;
+}
+static int _condvar_send(IPC_CHAN *ch, int dir, uint64_t msg)
+{
+	pthread_mutex_lock(&ch->mtx);
+	ch->slot[dir] = msg;
+	ch->seq[dir]++;
+	pthread_cond_signal(&ch->cond[dir]);
+	pthread_mutex_unlock(&ch->mtx);
+	return 0;
+}
+static int _condvar_recv(IPC_CHAN *ch, int dir, uint64_t *msg)
+{
+	pthread_mutex_lock(&ch->mtx);
+	while (ch->seq[dir] == ch->seen[dir])
+		pthread_cond_wait(&ch->cond[dir], &ch->mtx);
+	ch->seen[dir] = ch->seq[dir];
+	*msg = ch->slot[dir];
+	pthread_mutex_unlock(&ch->mtx);
+	return 0;
+}
+static void _condvar_close(IPC_CHAN *ch)
+{
+	pthread_cond_destroy(&ch->cond[PING]);
+	pthread_cond_destroy(&ch->cond[PONG]);
+	pthread_mutex_destroy(&ch->mtx);
+}
+/*****************************************************************************/
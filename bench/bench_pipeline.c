@@ -0,0 +1,368 @@
+/*
+ *  Multi-stage task pipeline (sensor -> filter -> control -> actuator).
+ *
+ *  Stage 0 is periodic and samples, every other stage blocks on its input
+ *  channel, spins its execution time and forwards the payload. Channels are
+ *  either the lock-free RT_SPSC ring or the RT_QUEUE of rt_itc. Reported per
+ *  source rate:
+ *    hop_k    : stage k-1 send -> stage k wakes up with the payload
+ *    age      : sampling instant -> actuation (end-to-end data age)
+ *    reaction : previous sampling instant -> actuation, i.e. the worst case
+ *               delay of an input change that just missed a sample
+ *  The rate is increased until the chain saturates (drops, lost or late
+ *  messages).
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+/*****************************************************************************/
+#define PIPE_MAX_STAGES	(8)
+#define PIPE_STAGES		(4)
+#define PIPE_PRIO		(80) // stage k runs at PIPE_PRIO - k unless given
+#define PIPE_EXE		(20) // us per stage
+#define PIPE_DEPTH		(16)
+#define PIPE_DURATION	(2) // seconds per rate step
+#define PIPE_RATES		"1000,2000,5000,10000,20000,50000"
+#define PIPE_MAX_RATES	(16)
+#define PIPE_LATE_RATIO	(0.01) // late releases tolerated before saturation
+
+#define PIPE_STOP 1 // message flag that shuts the chain down
+
+typedef struct {
+	uint32_t seq;
+	uint32_t flags;
+	uint64_t t_sample;
+	uint64_t t_prev_sample;
+	uint64_t t_sent;
+	uint64_t data[4];
+}PIPE_MSG;
+
+typedef struct {
+	char name[16];
+	RT_TASK task;
+	int prio;
+	int cpu;
+	RT_QUEUE queue; // output channel of this stage
+	RT_SPSC ring;
+	RT_HIST hop;
+	uint64_t drops;
+	volatile int done;
+}PIPE_STAGE;
+/*****************************************************************************/
+static PIPE_STAGE Stages[PIPE_MAX_STAGES];
+static int nstages = PIPE_STAGES;
+static int exe_us = PIPE_EXE;
+static int depth = PIPE_DEPTH;
+static FLAG bUseQueue = off;
+
+static RT_HIST HistAge;
+static RT_HIST HistReact;
+static uint64_t iterations;
+static uint64_t period;
+static uint64_t offered;
+static uint64_t delivered;
+static uint64_t late;
+/*****************************************************************************/
+static int _pipe_send(int stage, PIPE_MSG *msg)
+{
+	if (bUseQueue == on)
+		return write_rt_queue(&Stages[stage].queue, msg, sizeof(PIPE_MSG));
+	return push_rt_spsc(&Stages[stage].ring, msg);
+}
+/*****************************************************************************/
+static void _pipe_recv(int stage, PIPE_MSG *msg)
+{
+	if (bUseQueue == on)
+		read_rt_queue(&Stages[stage].queue, msg, sizeof(PIPE_MSG));
+	else
+		pop_rt_spsc(&Stages[stage].ring, msg);
+}
+/*****************************************************************************/
+static void _pipe_forward_stop(int stage, PIPE_MSG *msg)
+{
+	msg->flags = PIPE_STOP;
+	while (_pipe_send(stage, msg) != 0)
+		usleep(100);
+}
+/*****************************************************************************/
+static void PipeSourceTask(void *arg)
+{
+	PIPE_STAGE *stage = &Stages[0];
+	PIPE_MSG msg;
+	uint64_t now, prev = 0;
+
+	memset(&msg, 0, sizeof(msg));
+	for (offered = 0; offered < iterations && bBenchQuit == off; ++offered) {
+		wait_rt_period(&stage->task);
+		now = rt_timer_read();
+		if (prev != 0 && now - prev > period + period / 2)
+			++late;
+
+		msg.seq = offered;
+		msg.t_prev_sample = prev;
+		msg.t_sample = now;
+		rt_timer_spin(exe_us * NSEC_PER_USEC);
+		msg.t_sent = rt_timer_read();
+		if (_pipe_send(0, &msg) != 0)
+			stage->drops++;
+		prev = now;
+	}
+	_pipe_forward_stop(0, &msg);
+	bench_signal_done(&stage->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void PipeStageTask(void *arg)
+{
+	int k = (int)(intptr_t)arg;
+	PIPE_STAGE *stage = &Stages[k];
+	PIPE_MSG msg;
+	uint64_t now;
+
+	while (1) {
+		_pipe_recv(k - 1, &msg);
+		now = rt_timer_read();
+		if (msg.flags == PIPE_STOP)
+			break;
+		add_rt_hist(&stage->hop, now - msg.t_sent);
+		rt_timer_spin(exe_us * NSEC_PER_USEC);
+		now = rt_timer_read();
+
+		if (k == nstages - 1) {
+			add_rt_hist(&HistAge, now - msg.t_sample);
+			if (msg.t_prev_sample != 0)
+				add_rt_hist(&HistReact, now - msg.t_prev_sample);
+			++delivered;
+		} else {
+			msg.t_sent = now;
+			if (_pipe_send(k, &msg) != 0)
+				stage->drops++;
+		}
+	}
+	if (k != nstages - 1)
+		_pipe_forward_stop(k, &msg);
+	bench_signal_done(&stage->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* the queues between the first n stages */
+static void _pipe_close(int n)
+{
+	int k;
+
+	for (k = 0; k < n && k < nstages - 1; ++k) {
+		if (bUseQueue == on)
+			delete_rt_queue(&Stages[k].queue);
+		else
+			delete_rt_spsc(&Stages[k].ring);
+	}
+}
+/*****************************************************************************/
+/* stage failed did not start, the ones after it wait for its stop */
+static int _pipe_abort(int failed)
+{
+	PIPE_MSG msg;
+	int k;
+
+	bBenchQuit = on;
+	memset(&msg, 0, sizeof(msg));
+	if (failed < nstages - 1)
+		_pipe_forward_stop(failed, &msg);
+	for (k = failed + 1; k < nstages; ++k)
+		if (bench_wait_done(&Stages[k].done) != 0)
+			return -1;
+	_pipe_close(nstages);
+	return -1;
+}
+/*****************************************************************************/
+static int _pipe_run(int rate, int duration, FILE *summary)
+{
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[PIPE_MAX_STAGES + 1];
+	uint64_t drops = 0;
+	FLAG saturated;
+	FILE *fp;
+	int k, ret = 0;
+
+	period = NSEC_PER_SEC / rate;
+	iterations = (uint64_t)rate * duration;
+	offered = delivered = late = 0;
+	init_rt_hist(&HistAge, "age");
+	init_rt_hist(&HistReact, "reaction");
+
+	for (k = 0; k < nstages; ++k) {
+		PIPE_STAGE *stage = &Stages[k];
+		init_rt_hist(&stage->hop, stage->name);
+		stage->drops = 0;
+		stage->done = 0;
+		if (k < nstages - 1) {
+			if (bUseQueue == on)
+				ret = create_rt_queue(&stage->queue, stage->name, sizeof(PIPE_MSG), depth);
+			else
+				ret = create_rt_spsc(&stage->ring, stage->name, sizeof(PIPE_MSG), depth);
+		}
+		if (ret != 0) {
+			fprintf(stderr, "[PIPE] %s: cannot create a queue of %d messages (%d)\n", stage->name, depth, ret);
+			_pipe_close(k);
+			bBenchQuit = on;
+			return -1;
+		}
+		if (create_rt_task(&stage->task, stage->name, stage->prio) != 0) {
+			_pipe_close(k + 1);
+			bBenchQuit = on;
+			return -1;
+		}
+		set_rt_task_affinity(&stage->task, stage->cpu);
+	}
+	set_rt_task_period(&Stages[0].task, period);
+
+	/* consumers first so nothing is sent into the void */
+	for (k = nstages - 1; k > 0; --k)
+		if (start_rt_task_arg(1, &Stages[k].task, &PipeStageTask, (void *)(intptr_t)k) != 0)
+			return _pipe_abort(k);
+	if (start_rt_task(1, &Stages[0].task, &PipeSourceTask) != 0)
+		return _pipe_abort(0);
+
+	/* a stage still running keeps its queues */
+	for (k = 0; k < nstages; ++k)
+		if (bench_wait_done(&Stages[k].done) != 0)
+			return -1;
+
+	for (k = 0; k < nstages; ++k)
+		drops += Stages[k].drops;
+	_pipe_close(nstages);
+	saturated = (drops > 0 || delivered < offered || late > offered * PIPE_LATE_RATIO) ? on : off;
+
+	printf("%d Hz: offered %lu delivered %lu drops %lu late %lu%s\n", rate,
+			(unsigned long)offered, (unsigned long)delivered, (unsigned long)drops,
+			(unsigned long)late, saturated == on ? " SATURATED" : "");
+	for (k = 1; k < nstages; ++k)
+		print_rt_hist(stdout, &Stages[k].hop);
+	print_rt_hist(stdout, &HistAge);
+	print_rt_hist(stdout, &HistReact);
+
+	fprintf(summary, "%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu", rate,
+			(unsigned long)offered, (unsigned long)delivered, (unsigned long)drops, (unsigned long)late,
+			(unsigned long)get_rt_hist_percentile(&HistAge, 50),
+			(unsigned long)get_rt_hist_percentile(&HistAge, 99),
+			(unsigned long)HistAge.max,
+			(unsigned long)get_rt_hist_percentile(&HistReact, 99),
+			(unsigned long)HistReact.max);
+	for (k = 1; k < nstages; ++k)
+		fprintf(summary, ",%lu", (unsigned long)get_rt_hist_percentile(&Stages[k].hop, 99));
+	fprintf(summary, "\n");
+
+	for (k = 1; k < nstages; ++k)
+		hists[k - 1] = &Stages[k].hop;
+	hists[nstages - 1] = &HistAge;
+	hists[nstages] = &HistReact;
+	snprintf(name, sizeof(name), "pipeline_%s_%dst_%dhz_hist", bUseQueue == on ? "queue" : "spsc", nstages, rate);
+	fp = bench_open_result(name, filename, sizeof(filename));
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, nstages + 1);
+		fclose(fp);
+	}
+	return saturated;
+}
+/*****************************************************************************/
+static int _pipe_parse_list(char *list, int *values, int max)
+{
+	char *tok;
+	int n = 0;
+
+	for (tok = strtok(list, ","); tok != NULL && n < max; tok = strtok(NULL, ","))
+		values[n++] = atoi(tok);
+	return n;
+}
+/*****************************************************************************/
+static void _pipe_usage(void)
+{
+	printf("usage: pipeline [-s stages] [-t spsc|queue] [-r rate_hz,...] [-d sec_per_rate]\n");
+	printf("                [-e exe_us] [-q depth] [-P prio,...] [-c cpu] [-a] [-k]\n");
+	printf("  -a spread stages over all online cpus, -k keep sweeping after saturation\n");
+}
+/*****************************************************************************/
+int bench_pipeline_main(int argc, char **argv)
+{
+	char rate_list[256] = PIPE_RATES;
+	char prio_list[256] = "";
+	char name[128];
+	char filename[256];
+	int rates[PIPE_MAX_RATES], nrates;
+	int prios[PIPE_MAX_STAGES], nprios;
+	int duration = PIPE_DURATION;
+	int cpu = BENCH_CPU_AUTO, spread = 0, keep = 0;
+	int ncpu = bench_num_cpus();
+	FILE *summary;
+	int c, k;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "s:t:r:d:e:q:P:c:akh")) != -1) {
+		switch (c) {
+			case 's': nstages = atoi(optarg); break;
+			case 't': bUseQueue = (strcmp(optarg, "queue") == 0) ? on : off; break;
+			case 'r': snprintf(rate_list, sizeof(rate_list), "%s", optarg); break;
+			case 'd': duration = atoi(optarg); break;
+			case 'e': exe_us = atoi(optarg); break;
+			case 'q': depth = atoi(optarg); break;
+			case 'P': snprintf(prio_list, sizeof(prio_list), "%s", optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			case 'a': spread = 1; break;
+			case 'k': keep = 1; break;
+			default: _pipe_usage(); return 1;
+		}
+	}
+	if (nstages < 2 || nstages > PIPE_MAX_STAGES) {
+		fprintf(stderr, "[PIPE] stages must be within 2..%d\n", PIPE_MAX_STAGES);
+		return 1;
+	}
+	if (depth < 1) {
+		fprintf(stderr, "[PIPE] the queue depth must be at least 1\n");
+		return 1;
+	}
+	nrates = _pipe_parse_list(rate_list, rates, PIPE_MAX_RATES);
+	for (k = 0; k < nrates; ++k)
+		if (rates[k] <= 0 || rates[k] > NSEC_PER_SEC)
+			break;
+	if (nrates == 0 || k < nrates) {
+		fprintf(stderr, "[PIPE] rates must be within 1..%d Hz\n", NSEC_PER_SEC);
+		_pipe_usage();
+		return 1;
+	}
+	nprios = _pipe_parse_list(prio_list, prios, PIPE_MAX_STAGES);
+	cpu = bench_select_cpu(cpu);
+
+	for (k = 0; k < nstages; ++k) {
+		snprintf(Stages[k].name, sizeof(Stages[k].name), "stage_%d", k);
+		Stages[k].prio = (k < nprios) ? prios[k] : PIPE_PRIO - k;
+		Stages[k].cpu = spread ? (cpu + k) % ncpu : cpu;
+	}
+
+	bench_init(cpu);
+	snprintf(name, sizeof(name), "pipeline_%s_%dst_summary", bUseQueue == on ? "queue" : "spsc", nstages);
+	summary = bench_open_result(name, filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# rate_hz,offered,delivered,drops,late,age_p50_ns,age_p99_ns,age_max_ns,react_p99_ns,react_max_ns");
+	for (k = 1; k < nstages; ++k)
+		fprintf(summary, ",hop_%d_p99_ns", k);
+	fprintf(summary, "\n");
+
+	printf("Pipeline: %d stages over %s, %d us per stage, depth %d\n", nstages,
+			bUseQueue == on ? "RT_QUEUE" : "RT_SPSC", exe_us, depth);
+	print_rt_hist_header(stdout);
+	for (k = 0; k < nrates && bBenchQuit == off; ++k) {
+		if (_pipe_run(rates[k], duration, summary) == on && !keep) {
+			printf("Pipeline saturates at %d Hz\n", rates[k]);
+			break;
+		}
+	}
+	fclose(summary);
+	printf("Pipeline summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
@@ -0,0 +1,474 @@
+/*
+ *  Sporadic (event-triggered) jobs on top of a periodic background load.
+ *
+ *  A generator task on another cpu plays the interrupt source: it stamps
+ *  events with fixed, Poisson or bursty inter-arrival times and pushes them
+ *  through an RT_SPSC ring. A job is released by its event but never earlier
+ *  than the minimum inter-arrival time after the previous release. The jobs
+ *  are served
+ *    direct     : by a handler task blocked on the ring at its own priority
+ *    polling    : by a periodic server, budget is lost once the ring is empty
+ *    deferrable : by a server that keeps its budget until the next refill
+ *  Per mode we record event -> start and event -> completion latency, and the
+ *  response time (from the nominal release) of the periodic background tasks.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+/*****************************************************************************/
+#define SPO_PRIO		(90) // handler / server, above the background
+#define SPO_GEN_PRIO	(99)
+#define SPO_EVENTS		(5000)
+#define SPO_INTERVAL	(2000) // us, mean inter-arrival
+#define SPO_BURST		(4) // events per burst
+#define SPO_BURST_GAP	(50) // us between the events of a burst
+#define SPO_EXE			(100) // us per sporadic job
+#define SPO_MIT			(0) // us, minimum inter-arrival of releases
+#define SPO_SRV_PRD		(1000) // us
+#define SPO_SRV_BUDGET	(300) // us
+#define SPO_DEPTH		(1024)
+#define SPO_START		(100 * NSEC_PER_MSEC) // epoch from the start of a run
+#define SPO_SEED		(2020)
+#define SPO_STOP		(0) // event that ends the handler / server
+#define SPO_FOREVER		(~(RTIME)0)
+
+typedef enum {
+	SPO_DIRECT = 0,
+	SPO_POLLING,
+	SPO_DEFERRABLE,
+	SPO_MODES
+}SPO_MODE;
+
+static char *SpoModeNames[SPO_MODES] = {"direct", "polling", "deferrable"};
+
+typedef enum {
+	SPO_FIXED = 0,
+	SPO_POISSON,
+	SPO_BURSTY,
+	SPO_ARRIVALS
+}SPO_ARRIVAL;
+
+static char *SpoArrivalNames[SPO_ARRIVALS] = {"fixed", "poisson", "bursty"};
+
+typedef struct {
+	char *name;
+	int prio;
+	RTIME period;
+	RTIME exe;
+	RT_TASK task;
+	RT_HIST resp;
+	volatile int done;
+}SPO_BG;
+
+typedef struct {
+	RT_SPSC ring;
+	RTIME last_release;
+	RTIME held; // event popped before its release
+	RTIME held_release;
+	uint64_t deferred; // releases pushed back by the minimum inter-arrival
+	uint64_t jobs;
+}SPO_SERVED;
+/*****************************************************************************/
+/* background load, the shape of the main test at a 1 ms scale */
+static SPO_BG SpoBg[] = {
+	{"spo_bg_1", 80, 1000 * NSEC_PER_USEC, 150 * NSEC_PER_USEC},
+	{"spo_bg_2", 70, 2000 * NSEC_PER_USEC, 400 * NSEC_PER_USEC},
+	{"spo_bg_3", 60, 5000 * NSEC_PER_USEC, 1000 * NSEC_PER_USEC},
+};
+#define SPO_NBG (int)(sizeof(SpoBg) / sizeof(SpoBg[0]))
+
+static RT_TASK TskGen, TskHandler;
+static SPO_SERVED Served;
+static RT_HIST HistLatency, HistResp;
+
+static SPO_ARRIVAL arrival = SPO_FIXED;
+static int events = SPO_EVENTS;
+static RTIME interval = SPO_INTERVAL * NSEC_PER_USEC;
+static int burst = SPO_BURST;
+static RTIME burst_gap = SPO_BURST_GAP * NSEC_PER_USEC;
+static RTIME exe = SPO_EXE * NSEC_PER_USEC;
+static RTIME mit = SPO_MIT * NSEC_PER_USEC;
+static RTIME srv_period = SPO_SRV_PRD * NSEC_PER_USEC;
+static RTIME srv_budget = SPO_SRV_BUDGET * NSEC_PER_USEC;
+static FLAG bBackground = on;
+
+static RTIME t_epoch;
+static uint64_t dropped;
+static uint32_t seed = SPO_SEED;
+static volatile int bGenDone, bHandlerDone, bStopBg;
+/*****************************************************************************/
+static double _spo_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return ((double)((seed >> 8) & 0xFFFFFF) + 1.0) / (double)0x1000001;
+}
+/*****************************************************************************/
+/* event source */
+/*****************************************************************************/
+static void SpoGenTask(void *arg)
+{
+	RTIME next = t_epoch, ev;
+	int i;
+
+	for (i = 0; i < events && bBenchQuit == off; ++i) {
+		sleep_rt_task_until(next);
+		ev = rt_timer_read();
+		if (push_rt_spsc(&Served.ring, &ev) != 0)
+			dropped++;
+
+		switch (arrival) {
+			case SPO_POISSON:
+				next += (RTIME)(-log(_spo_rand()) * interval);
+				break;
+			case SPO_BURSTY:
+				/* same mean rate, the events of a burst come burst_gap apart */
+				if ((i + 1) % burst != 0)
+					next += burst_gap;
+				else
+					next += interval * burst - burst_gap * (burst - 1);
+				break;
+			default:
+				next += interval;
+				break;
+		}
+	}
+	ev = SPO_STOP;
+	while (push_rt_spsc(&Served.ring, &ev) != 0)
+		sleep_rt_task_until(rt_timer_read() + burst_gap);
+	bench_signal_done(&bGenDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* sporadic jobs */
+/*****************************************************************************/
+static RTIME _spo_release(RTIME ev)
+{
+	RTIME release = ev;
+
+	if (Served.last_release != 0 && release < Served.last_release + mit) {
+		release = Served.last_release + mit;
+		Served.deferred++;
+	}
+	Served.last_release = release;
+	return release;
+}
+/*****************************************************************************/
+/* next released event, waiting at most until `until`, SPO_STOP at the end */
+static int _spo_next(RTIME *ev, RTIME until)
+{
+	int ret;
+
+	if (Served.held == 0) {
+		ret = (until == 0) ? trypop_rt_spsc(&Served.ring, &Served.held)
+				: timedpop_rt_spsc(&Served.ring, &Served.held, until);
+		if (ret != 0)
+			return -EAGAIN;
+		if (Served.held == SPO_STOP) {
+			*ev = SPO_STOP;
+			return 0;
+		}
+		Served.held_release = _spo_release(Served.held);
+	}
+
+	if (Served.held_release > rt_timer_read()) {
+		if (Served.held_release > until) {
+			if (until != 0)
+				sleep_rt_task_until(until);
+			return -EAGAIN;
+		}
+		sleep_rt_task_until(Served.held_release);
+	}
+	*ev = Served.held;
+	Served.held = 0;
+	return 0;
+}
+/*****************************************************************************/
+/* returns the execution time the job took from the budget */
+static RTIME _spo_run_job(RTIME ev)
+{
+	RTIME start, end;
+
+	start = rt_timer_read();
+	rt_timer_spin(exe);
+	end = rt_timer_read();
+	add_rt_hist(&HistLatency, start - ev);
+	add_rt_hist(&HistResp, end - ev);
+	Served.jobs++;
+	return end - start;
+}
+/*****************************************************************************/
+static void SpoDirectTask(void *arg)
+{
+	RTIME ev;
+
+	while (1) {
+		if (_spo_next(&ev, SPO_FOREVER) != 0)
+			continue;
+		if (ev == SPO_STOP)
+			break;
+		_spo_run_job(ev);
+	}
+	bench_signal_done(&bHandlerDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void SpoPollingTask(void *arg)
+{
+	RTIME ev, budget, used;
+	FLAG stop = off;
+
+	while (stop == off) {
+		wait_rt_period(&TskHandler);
+		/* serve while work is pending, an empty ring gives the budget up */
+		budget = srv_budget;
+		while (budget >= exe && _spo_next(&ev, 0) == 0) {
+			if (ev == SPO_STOP) {
+				stop = on;
+				break;
+			}
+			used = _spo_run_job(ev);
+			budget = (used < budget) ? budget - used : 0;
+		}
+	}
+	bench_signal_done(&bHandlerDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void SpoDeferrableTask(void *arg)
+{
+	RTIME ev = 0, budget = 0, used, now, refill = t_epoch;
+
+	while (1) {
+		now = rt_timer_read();
+		while (now >= refill) {
+			budget = srv_budget;
+			refill += srv_period;
+		}
+		if (budget < exe) {
+			sleep_rt_task_until(refill);
+			continue;
+		}
+		/* the budget is kept while idle, the server waits for the event */
+		if (_spo_next(&ev, refill) != 0)
+			continue;
+		if (ev == SPO_STOP)
+			break;
+		used = _spo_run_job(ev);
+		budget = (used < budget) ? budget - used : 0;
+	}
+	bench_signal_done(&bHandlerDone);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* periodic background */
+/*****************************************************************************/
+static void SpoBgTask(void *arg)
+{
+	SPO_BG *bg = arg;
+	RTIME release = t_epoch;
+
+	while (1) {
+		wait_rt_period(&bg->task);
+		if (bStopBg)
+			break;
+		rt_timer_spin(bg->exe);
+		add_rt_hist(&bg->resp, rt_timer_read() - release);
+		release += bg->period;
+	}
+	bench_signal_done(&bg->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+/* a task did not start: a started handler waits for the stop of the
+ * generator, the first nbg background tasks for bStopBg */
+static void _spo_abort(int nbg, FLAG handler)
+{
+	RTIME ev = SPO_STOP;
+	int i;
+
+	bBenchQuit = on;
+	if (handler == on) {
+		push_rt_spsc(&Served.ring, &ev);
+		if (bench_wait_done(&bHandlerDone) != 0)
+			return;
+	}
+	bStopBg = 1;
+	for (i = 0; i < nbg; ++i)
+		if (bench_wait_done(&SpoBg[i].done) != 0)
+			return;
+	delete_rt_spsc(&Served.ring);
+}
+/*****************************************************************************/
+static void _spo_run(SPO_MODE mode, int prio, int cpu, int gen_cpu, FILE *summary)
+{
+	void (*handler[SPO_MODES])(void *) = {SpoDirectTask, SpoPollingTask, SpoDeferrableTask};
+	RT_HIST *hists[2 + SPO_NBG] = {&HistLatency, &HistResp};
+	char name[128];
+	FILE *fp;
+	int i, nbg;
+
+	if (create_rt_spsc(&Served.ring, "spo_events", sizeof(RTIME), SPO_DEPTH) != 0) {
+		fprintf(stderr, "[SPO] cannot create the event ring\n");
+		return;
+	}
+	Served.last_release = 0;
+	Served.held = 0;
+	Served.deferred = 0;
+	Served.jobs = 0;
+	dropped = 0;
+	seed = SPO_SEED;
+	bGenDone = bHandlerDone = bStopBg = 0;
+	init_rt_hist(&HistLatency, "latency");
+	init_rt_hist(&HistResp, "response");
+
+	t_epoch = rt_timer_read() + SPO_START;
+	for (i = 0; i < SPO_NBG && bBackground == on; ++i) {
+		init_rt_hist(&SpoBg[i].resp, SpoBg[i].name);
+		SpoBg[i].done = 0;
+		if (create_rt_task(&SpoBg[i].task, SpoBg[i].name, SpoBg[i].prio) != 0) {
+			_spo_abort(i, off);
+			return;
+		}
+		set_rt_task_affinity(&SpoBg[i].task, cpu);
+		set_rt_task_release(&SpoBg[i].task, t_epoch, SpoBg[i].period);
+		if (start_rt_task_arg(1, &SpoBg[i].task, &SpoBgTask, &SpoBg[i]) != 0) {
+			_spo_abort(i, off);
+			return;
+		}
+	}
+	nbg = i;
+
+	if (create_rt_task(&TskHandler, "spo_handler", prio) != 0) {
+		_spo_abort(nbg, off);
+		return;
+	}
+	set_rt_task_affinity(&TskHandler, cpu);
+	if (mode == SPO_POLLING)
+		set_rt_task_release(&TskHandler, t_epoch, srv_period);
+	if (start_rt_task(1, &TskHandler, handler[mode]) != 0) {
+		_spo_abort(nbg, off);
+		return;
+	}
+
+	if (create_rt_task(&TskGen, "spo_gen", SPO_GEN_PRIO) != 0) {
+		_spo_abort(nbg, on);
+		return;
+	}
+	set_rt_task_affinity(&TskGen, gen_cpu);
+	if (start_rt_task(1, &TskGen, &SpoGenTask) != 0) {
+		_spo_abort(nbg, on);
+		return;
+	}
+
+	/* a task still running keeps the ring */
+	if (bench_wait_done(&bGenDone) != 0 || bench_wait_done(&bHandlerDone) != 0)
+		return;
+	bStopBg = 1;
+	for (i = 0; i < nbg; ++i)
+		if (bench_wait_done(&SpoBg[i].done) != 0)
+			return;
+	delete_rt_spsc(&Served.ring);
+
+	printf("%s server, %lu jobs, %lu deferred by the mit, %lu dropped\n", SpoModeNames[mode],
+			(unsigned long)Served.jobs, (unsigned long)Served.deferred, (unsigned long)dropped);
+	print_rt_hist(stdout, &HistLatency);
+	print_rt_hist(stdout, &HistResp);
+	for (i = 0; i < SPO_NBG && bBackground == on; ++i) {
+		print_rt_hist(stdout, &SpoBg[i].resp);
+		hists[2 + i] = &SpoBg[i].resp;
+	}
+
+	fprintf(summary, "%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu", SpoModeNames[mode],
+			SpoArrivalNames[arrival], (unsigned long)Served.jobs, (unsigned long)dropped,
+			(unsigned long)Served.deferred,
+			(unsigned long)get_rt_hist_percentile(&HistLatency, 50),
+			(unsigned long)get_rt_hist_percentile(&HistLatency, 99), (unsigned long)HistLatency.max,
+			(unsigned long)get_rt_hist_percentile(&HistResp, 50),
+			(unsigned long)get_rt_hist_percentile(&HistResp, 99), (unsigned long)HistResp.max);
+	for (i = 0; i < SPO_NBG; ++i)
+		fprintf(summary, ",%lu", bBackground == on ? (unsigned long)SpoBg[i].resp.max : 0UL);
+	fprintf(summary, "\n");
+
+	snprintf(name, sizeof(name), "sporadic_%s_%s_hist", SpoModeNames[mode], SpoArrivalNames[arrival]);
+	fp = bench_open_result(name, NULL, 0);
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, bBackground == on ? 2 + SPO_NBG : 2);
+		fclose(fp);
+	}
+}
+/*****************************************************************************/
+static void _spo_usage(void)
+{
+	printf("usage: sporadic [-s direct|polling|deferrable|all] [-a fixed|poisson|bursty]\n");
+	printf("                [-n events] [-i interval_us] [-B burst] [-g burst_gap_us]\n");
+	printf("                [-e exe_us] [-m mit_us] [-P server_period_us] [-C budget_us]\n");
+	printf("                [-p prio] [-c cpu] [-G generator_cpu] [-b (no background)]\n");
+}
+/*****************************************************************************/
+int bench_sporadic_main(int argc, char **argv)
+{
+	char *server = "all";
+	char filename[256];
+	int prio = SPO_PRIO, cpu = BENCH_CPU_AUTO, gen_cpu = -1;
+	int ncpu = bench_num_cpus();
+	FILE *summary;
+	int c, i;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "s:a:n:i:B:g:e:m:P:C:p:c:G:bh")) != -1) {
+		switch (c) {
+			case 's': server = optarg; break;
+			case 'a':
+				for (i = 0; i < SPO_ARRIVALS; ++i)
+					if (strcmp(optarg, SpoArrivalNames[i]) == 0)
+						arrival = i;
+				break;
+			case 'n': events = atoi(optarg); break;
+			case 'i': interval = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'B': burst = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			case 'g': burst_gap = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'e': exe = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'm': mit = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'P': srv_period = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'C': srv_budget = (RTIME)atoi(optarg) * NSEC_PER_USEC; break;
+			case 'p': prio = atoi(optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			case 'G': gen_cpu = atoi(optarg); break;
+			case 'b': bBackground = off; break;
+			default: _spo_usage(); return 1;
+		}
+	}
+	/* the interrupt source lives on another cpu when there is one */
+	if (gen_cpu < 0)
+		gen_cpu = (cpu == BENCH_CPU_AUTO) ? bench_quiet_cpu(1) : (cpu + 1) % ncpu;
+	cpu = bench_select_cpu(cpu);
+
+	bench_init(cpu);
+	bench_meta("sporadic_arrival: %s", SpoArrivalNames[arrival]);
+	summary = bench_open_result("sporadic_summary", filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# server,arrival,jobs,dropped,deferred,lat_p50_ns,lat_p99_ns,lat_max_ns,resp_p50_ns,resp_p99_ns,resp_max_ns");
+	for (i = 0; i < SPO_NBG; ++i)
+		fprintf(summary, ",%s_resp_max_ns", SpoBg[i].name);
+	fprintf(summary, "\n");
+
+	printf("Sporadic jobs: %d %s events every %lu us, %lu us each, mit %lu us, server %lu/%lu us\n",
+			events, SpoArrivalNames[arrival], (unsigned long)(interval / NSEC_PER_USEC),
+			(unsigned long)(exe / NSEC_PER_USEC), (unsigned long)(mit / NSEC_PER_USEC),
+			(unsigned long)(srv_budget / NSEC_PER_USEC), (unsigned long)(srv_period / NSEC_PER_USEC));
+	if (gen_cpu == cpu)
+		printf("[SPO] only one cpu online, the generator shares the cpu of the jobs\n");
+	print_rt_hist_header(stdout);
+	for (i = 0; i < SPO_MODES && bBenchQuit == off; ++i)
+		if (strcmp(server, "all") == 0 || strcmp(server, SpoModeNames[i]) == 0)
+			_spo_run(i, prio, cpu, gen_cpu, summary);
+	fclose(summary);
+	printf("Sporadic summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
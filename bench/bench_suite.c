@@ -0,0 +1,536 @@
+/*
+ *  Named, versioned periodic task sets run one after the other with a
+ *  consolidated report, so every kernel or configuration is characterized
+ *  the same way (`make bench`).
+ *
+ *  Every scenario is a fixed task set on one cpu sharing PI mutexes. A job
+ *  spends its execution time in thread cpu time, the first cs_us of it
+ *  inside the mutex, so preemption and blocking stretch the response.
+ *  A scenario may declare up to SUITE_MAX_RES named resources instead and
+ *  give a task a critical section program, e.g. "dev[200 bus[500]] 100":
+ *  a number spins that many us, name[...] holds the resource around its
+ *  contents, so sections nest. The rest of exe_us runs after the program
+ *  outside of any section. Lock orders that could deadlock are rejected.
+ *  A job that finds a resource held follows the owners that wait
+ *  themselves, the length of that chain is the depth priority inheritance
+ *  has to propagate; the report holds the time a job spent blocked, the
+ *  blockings of one job and the longest chain.
+ *  Releases lie on a common grid from one epoch plus the task phase, the
+ *  first SUITE_WARMUP jobs of every task are not recorded. Per task the
+ *  report holds the response time percentiles from the nominal release, the
+ *  start-to-start jitter and the deadline (= period) misses.
+ *  Bump the version of a scenario whenever its task set changes, results of
+ *  different versions are not comparable.
+ *  With -b the suite runs once per scheduling backend, back to back on the
+ *  same boot; deadline tasks reserve SUITE_BUDGET times their execution time.
+*/
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <bench.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+/*****************************************************************************/
+#define SUITE_MAX_TASKS	(8)
+#define SUITE_WARMUP	(2) // jobs
+#define SUITE_SLICE		(5 * NSEC_PER_USEC) // between two cpu time reads
+#define SUITE_BUDGET	(1.25) // deadline runtime per execution time
+#define SUITE_MAX_BACKENDS	(8)
+#define SUITE_MAX_RES	(8)
+#define SUITE_MAX_OPS	(32) // of a critical section program
+
+typedef struct {
+	char *name;
+	int prio;
+	int prd_us;
+	int exe_us;
+	int cs_us; // first part of the job inside the mutex
+	int phase_us; // after the epoch
+	char *cs; // critical section program, replaces cs_us
+}SUITE_TASK_DEF;
+
+typedef struct {
+	char *name;
+	int version;
+	int duration; // seconds
+	char *desc;
+	SUITE_TASK_DEF tasks[SUITE_MAX_TASKS]; // up to the first without name
+	char *resources[SUITE_MAX_RES]; // none: one, "lock"
+}SUITE_SCENARIO;
+
+typedef enum {
+	SUITE_SPIN = 0,
+	SUITE_LOCK,
+	SUITE_UNLOCK
+}SUITE_OP_KIND;
+
+typedef struct {
+	SUITE_OP_KIND kind;
+	int arg; // us or resource
+}SUITE_OP;
+
+typedef struct {
+	SUITE_TASK_DEF *def;
+	RT_TASK task;
+	SUITE_OP ops[SUITE_MAX_OPS];
+	int nops;
+	int cs_us; // inside any section
+	volatile int waiting; // resource, -1 none
+	RT_HIST resp;
+	RT_HIST jitter;
+	RT_HIST blocked; // per job
+	uint64_t jobs;
+	uint64_t misses;
+	int blockings_max; // of one job
+	int chain_max;
+	volatile int done;
+}SUITE_TASK;
+/*****************************************************************************/
+static SUITE_SCENARIO Scenarios[] = {
+	{"sched", 1, 10, "task set of the scheduling test, only the 100 ms task takes the mutex", {
+		{"task_1", 99, 100000, 3000, 3000, 0},
+		{"task_2", 80, 20000, 5000, 0, 0},
+	}},
+	{"preempt", 1, 10, "task set of the preemption test, every task takes the mutex", {
+		{"task_1", 99, 100000, 3000, 3000, 0},
+		{"task_2", 80, 20000, 5000, 5000, 0},
+		{"task_3", 50, 40000, 10000, 10000, 0},
+	}},
+	{"inversion", 1, 10, "low holds the mutex when high arrives, mid would run in between without PI", {
+		{"high", 90, 10000, 1000, 1000, 2000},
+		{"mid", 80, 10000, 4000, 0, 2100},
+		{"low", 70, 50000, 8000, 6000, 0},
+	}},
+	{"highrate", 1, 10, "10 kHz control loop over a 1 kHz background task", {
+		{"loop_10k", 95, 100, 20, 0, 0},
+		{"bg_1k", 80, 1000, 300, 0, 0},
+	}},
+	{"overload", 1, 10, "utilization 1.2, the lower priority task misses", {
+		{"task_a", 90, 10000, 6000, 0, 0},
+		{"task_b", 80, 20000, 12000, 0, 0},
+	}},
+	/* every 100 ms: log holds bus, dma takes dev and blocks on bus, ctl
+	 * blocks on dev, so PI has to raise dma and through it log */
+	{"nested", 1, 10, "driver locks nested dev->bus and dev->irq, a ctl->dma->log blocking chain", {
+		{"isr", 95, 2000, 100, 0, 0, "irq[50]"},
+		{"ctl", 90, 5000, 800, 0, 700, "dev[200 irq[50]]"},
+		{"mid", 70, 10000, 2000, 0, 6000},
+		{"dma", 60, 20000, 3000, 0, 200, "dev[400 bus[500]] irq[100]"},
+		{"log", 50, 50000, 4000, 0, 0, "bus[1500]"},
+	}, {"bus", "dev", "irq"}},
+};
+#define SUITE_NSCENARIOS (int)(sizeof(Scenarios) / sizeof(Scenarios[0]))
+/*****************************************************************************/
+static SUITE_TASK Tasks[SUITE_MAX_TASKS];
+static int ntasks;
+static RT_MUTEX SuiteLocks[SUITE_MAX_RES];
+static volatile int SuiteOwner[SUITE_MAX_RES]; // task, -1 free
+static int nres;
+static uint64_t t_epoch, t_end;
+static volatile FLAG bAbort = off; // a task of the scenario did not start
+static FLAG bSimulated = off; // spins are cpu time of the model already
+/*****************************************************************************/
+static uint64_t _suite_cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+/*****************************************************************************/
+/* busy for ns of our own cpu time, time spent preempted does not count */
+static void _suite_spin(uint64_t ns)
+{
+	uint64_t begin;
+
+	if (bSimulated == on) {
+		rt_timer_spin(ns);
+		return;
+	}
+	begin = _suite_cpu_time();
+	while (_suite_cpu_time() - begin < ns)
+		rt_timer_spin(SUITE_SLICE);
+}
+/*****************************************************************************/
+/* the owner of a held resource may wait for another one itself: the chain
+ * of such owners is read without locks, a snapshot when this task blocks.
+ * The mutex itself tells whether it is held, an owner may not have
+ * published itself yet, so such a chain still counts one. */
+static uint64_t _suite_lock(SUITE_TASK *t, int res, int *blockings, int *chain)
+{
+	int depth = 0, owner, r;
+	uint64_t begin, end;
+
+	if (try_acquire_rt_mutex(&SuiteLocks[res]) == 0) {
+		__atomic_store_n(&SuiteOwner[res], (int)(t - Tasks), __ATOMIC_RELEASE);
+		return 0;
+	}
+	for (r = res; r >= 0 && depth < ntasks; r = Tasks[owner].waiting) {
+		owner = __atomic_load_n(&SuiteOwner[r], __ATOMIC_ACQUIRE);
+		if (owner < 0)
+			break;
+		++depth;
+	}
+	if (depth == 0)
+		depth = 1;
+	t->waiting = res;
+	begin = rt_timer_read();
+	acquire_rt_mutex(&SuiteLocks[res]);
+	end = rt_timer_read();
+	t->waiting = -1;
+	__atomic_store_n(&SuiteOwner[res], (int)(t - Tasks), __ATOMIC_RELEASE);
+	if (depth > *chain)
+		*chain = depth;
+	++*blockings;
+	return end - begin;
+}
+/*****************************************************************************/
+static int _suite_resource(SUITE_SCENARIO *sc, const char *name, int len)
+{
+	int r;
+
+	for (r = 0; r < nres; ++r)
+		if ((int)strlen(sc->resources[r]) == len && strncmp(sc->resources[r], name, len) == 0)
+			return r;
+	return -1;
+}
+/*****************************************************************************/
+/* the operations of a job; order[a][b] is raised when b is taken inside a */
+static int _suite_program(SUITE_SCENARIO *sc, SUITE_TASK *t, FLAG order[][SUITE_MAX_RES])
+{
+	SUITE_TASK_DEF *d = t->def;
+	int held[SUITE_MAX_RES], nheld = 0, spun = 0, i, r, len;
+	const char *p = d->cs;
+	char *end;
+
+	t->nops = 0;
+	t->cs_us = 0;
+	if (p == NULL) {
+		/* the first cs_us of the job inside the first resource */
+		if (d->cs_us > 0) {
+			t->ops[t->nops++] = (SUITE_OP){SUITE_LOCK, 0};
+			t->ops[t->nops++] = (SUITE_OP){SUITE_SPIN, d->cs_us};
+			t->ops[t->nops++] = (SUITE_OP){SUITE_UNLOCK, 0};
+		}
+		t->cs_us = spun = d->cs_us;
+	}
+	while (p != NULL && *p != '\0') {
+		if (*p == ' ' || *p == ',') {
+			++p;
+			continue;
+		}
+		if (t->nops >= SUITE_MAX_OPS - 1) {
+			fprintf(stderr, "[SUITE] %s/%s: more than %d operations\n", sc->name, d->name, SUITE_MAX_OPS - 1);
+			return -EINVAL;
+		}
+		if (*p >= '0' && *p <= '9') {
+			t->ops[t->nops++] = (SUITE_OP){SUITE_SPIN, (int)strtol(p, &end, 10)};
+			spun += t->ops[t->nops - 1].arg;
+			if (nheld > 0)
+				t->cs_us += t->ops[t->nops - 1].arg;
+			p = end;
+		}
+		else if (*p == ']') {
+			if (nheld == 0) {
+				fprintf(stderr, "[SUITE] %s/%s: unbalanced ']' in \"%s\"\n", sc->name, d->name, d->cs);
+				return -EINVAL;
+			}
+			t->ops[t->nops++] = (SUITE_OP){SUITE_UNLOCK, held[--nheld]};
+			++p;
+		}
+		else {
+			len = strcspn(p, "[");
+			r = _suite_resource(sc, p, len);
+			if (r < 0 || p[len] != '[') {
+				fprintf(stderr, "[SUITE] %s/%s: unknown resource in \"%s\"\n", sc->name, d->name, d->cs);
+				return -EINVAL;
+			}
+			for (i = 0; i < nheld; ++i) {
+				if (held[i] == r) {
+					fprintf(stderr, "[SUITE] %s/%s: %s taken twice\n", sc->name, d->name, sc->resources[r]);
+					return -EINVAL;
+				}
+				order[held[i]][r] = on;
+			}
+			held[nheld++] = r;
+			t->ops[t->nops++] = (SUITE_OP){SUITE_LOCK, r};
+			p += len + 1;
+		}
+	}
+	if (nheld > 0 || spun > d->exe_us) {
+		fprintf(stderr, "[SUITE] %s/%s: %s\n", sc->name, d->name,
+				nheld > 0 ? "unbalanced '['" : "critical sections longer than exe_us");
+		return -EINVAL;
+	}
+	/* the rest of the job outside of any section */
+	if (d->exe_us > spun)
+		t->ops[t->nops++] = (SUITE_OP){SUITE_SPIN, d->exe_us - spun};
+	return 0;
+}
+/*****************************************************************************/
+/* every task's program, then a deadlock check: no resource may be taken
+ * inside another one that is itself taken inside it, directly or not */
+static int _suite_programs(SUITE_SCENARIO *sc)
+{
+	FLAG order[SUITE_MAX_RES][SUITE_MAX_RES];
+	int a, b, c;
+
+	for (nres = 0; nres < SUITE_MAX_RES && sc->resources[nres] != NULL; ++nres)
+		;
+	if (nres == 0) {
+		sc->resources[0] = "lock";
+		nres = 1;
+	}
+	memset(order, 0, sizeof(order));
+	for (a = 0; a < ntasks; ++a)
+		if (_suite_program(sc, &Tasks[a], order) != 0)
+			return -EINVAL;
+	/* transitive closure, at most SUITE_MAX_RES^3 */
+	for (c = 0; c < nres; ++c)
+		for (a = 0; a < nres; ++a)
+			for (b = 0; b < nres; ++b)
+				if (order[a][c] == on && order[c][b] == on)
+					order[a][b] = on;
+	for (a = 0; a < nres; ++a)
+		if (order[a][a] == on) {
+			fprintf(stderr, "[SUITE] %s: lock order cycle through %s\n", sc->name, sc->resources[a]);
+			return -EINVAL;
+		}
+	return 0;
+}
+/*****************************************************************************/
+static void SuiteTask(void *arg)
+{
+	SUITE_TASK *t = arg;
+	SUITE_TASK_DEF *d = t->def;
+	uint64_t period = (uint64_t)d->prd_us * NSEC_PER_USEC;
+	uint64_t release, start, end, last = 0, blocked;
+	uint64_t k;
+	int i, blockings, chain;
+
+	for (k = 0, release = t_epoch + (uint64_t)d->phase_us * NSEC_PER_USEC;
+			release < t_end && bBenchQuit == off && bAbort == off; ++k, release += period) {
+		sleep_rt_task_until(release);
+		start = rt_timer_read();
+		blocked = 0;
+		blockings = chain = 0;
+		for (i = 0; i < t->nops; ++i) {
+			switch (t->ops[i].kind) {
+				case SUITE_SPIN: _suite_spin((uint64_t)t->ops[i].arg * NSEC_PER_USEC); break;
+				case SUITE_LOCK: blocked += _suite_lock(t, t->ops[i].arg, &blockings, &chain); break;
+				case SUITE_UNLOCK:
+					__atomic_store_n(&SuiteOwner[t->ops[i].arg], -1, __ATOMIC_RELEASE);
+					release_rt_mutex(&SuiteLocks[t->ops[i].arg]);
+					break;
+			}
+		}
+		end = rt_timer_read();
+
+		if (k >= SUITE_WARMUP) {
+			add_rt_hist(&t->resp, end - release);
+			add_rt_hist(&t->blocked, blocked);
+			if (blockings > t->blockings_max)
+				t->blockings_max = blockings;
+			if (chain > t->chain_max)
+				t->chain_max = chain;
+			add_rt_hist(&t->jitter, start - last > period ? start - last - period : period - (start - last));
+			if (end - release > period)
+				t->misses++;
+			t->jobs++;
+		}
+		last = start;
+	}
+	bench_signal_done(&t->done);
+	delete_rt_task();
+}
+/*****************************************************************************/
+static void _suite_run(SUITE_SCENARIO *sc, int duration, int cpu, FILE *report)
+{
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[SUITE_MAX_TASKS];
+	FILE *fp;
+	int i, started, created, failed = 0;
+
+	for (ntasks = 0; ntasks < SUITE_MAX_TASKS && sc->tasks[ntasks].name != NULL; ++ntasks) {
+		Tasks[ntasks].def = &sc->tasks[ntasks];
+		init_rt_hist(&Tasks[ntasks].resp, sc->tasks[ntasks].name);
+		init_rt_hist(&Tasks[ntasks].jitter, "jitter");
+		init_rt_hist(&Tasks[ntasks].blocked, "blocked");
+		Tasks[ntasks].jobs = Tasks[ntasks].misses = 0;
+		Tasks[ntasks].blockings_max = Tasks[ntasks].chain_max = 0;
+		Tasks[ntasks].waiting = -1;
+		Tasks[ntasks].done = 0;
+		hists[ntasks] = &Tasks[ntasks].resp;
+	}
+	if (duration <= 0)
+		duration = sc->duration;
+	if (_suite_programs(sc) != 0)
+		return;
+	printf("%s v%d on %s, %d s: %s\n", sc->name, sc->version, get_rt_backend(), duration, sc->desc);
+
+	for (i = 0; i < nres; ++i) {
+		create_rt_mutex(&SuiteLocks[i], NULL);
+		SuiteOwner[i] = -1;
+	}
+	t_epoch = rt_timer_read() + NSEC_PER_SEC;
+	t_end = t_epoch + (uint64_t)duration * NSEC_PER_SEC;
+	/* a task the backend refuses (an overload under deadline) skips the
+	 * scenario, the started ones end before their first job. The whole set
+	 * exists before the first start, the sim clock holds until then. */
+	bAbort = off;
+	for (created = 0; created < ntasks; ++created) {
+		if (create_rt_task(&Tasks[created].task, Tasks[created].def->name, Tasks[created].def->prio) != 0)
+			break;
+		set_rt_task_affinity(&Tasks[created].task, cpu);
+		set_rt_task_budget(&Tasks[created].task, (RTIME)(Tasks[created].def->exe_us * SUITE_BUDGET) * NSEC_PER_USEC,
+				(RTIME)Tasks[created].def->prd_us * NSEC_PER_USEC);
+	}
+	for (started = 0; created == ntasks && started < ntasks; ++started)
+		if (start_rt_task_arg(1, &Tasks[started].task, &SuiteTask, &Tasks[started]) != 0)
+			break;
+	if (started < ntasks) {
+		bAbort = on;
+		failed = (created < ntasks) ? created : started;
+		for (i = (created < ntasks) ? 0 : started + 1; i < created; ++i)
+			discard_rt_task(&Tasks[i].task);
+	}
+	for (i = 0; i < started; ++i)
+		if (bench_wait_done(&Tasks[i].done) != 0)
+			return; // the mutexes are still in use
+	for (i = 0; i < nres; ++i)
+		delete_rt_mutex(&SuiteLocks[i]);
+	if (bAbort == on) {
+		printf("%s v%d: %s not started on %s, skipped\n", sc->name, sc->version,
+				Tasks[failed].def->name, get_rt_backend());
+		return;
+	}
+
+	for (i = 0; i < ntasks; ++i) {
+		SUITE_TASK *t = &Tasks[i];
+		print_rt_hist(stdout, &t->resp);
+		fprintf(report, "%s,%d,%s,%s,%d,%d,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%d,%d\n", sc->name,
+				sc->version, get_rt_backend(), t->def->name, t->def->prio, t->def->prd_us, t->def->exe_us, t->cs_us,
+				(unsigned long)t->jobs, (unsigned long)t->misses,
+				(unsigned long)get_rt_hist_percentile(&t->resp, 50),
+				(unsigned long)get_rt_hist_percentile(&t->resp, 99),
+				(unsigned long)get_rt_hist_percentile(&t->resp, 99.9),
+				(unsigned long)t->resp.max,
+				(unsigned long)get_rt_hist_percentile(&t->jitter, 99),
+				(unsigned long)t->jitter.max,
+				(unsigned long)get_rt_hist_percentile(&t->blocked, 99),
+				(unsigned long)t->blocked.max, t->blockings_max, t->chain_max);
+	}
+	fflush(report);
+
+	snprintf(name, sizeof(name), "suite_%s_v%d_%s_hist", sc->name, sc->version, get_rt_backend());
+	fp = bench_open_result(name, filename, sizeof(filename));
+	if (fp != NULL) {
+		write_rt_hist(fp, hists, ntasks);
+		fclose(fp);
+	}
+}
+/*****************************************************************************/
+static void _suite_usage(void)
+{
+	int i;
+
+	printf("usage: suite [-l] [-d sec_per_scenario] [-c cpu] [-b backend,...] [scenario ...]\n");
+	for (i = 0; i < SUITE_NSCENARIOS; ++i)
+		printf("  %-10s v%d %3d s  %s\n", Scenarios[i].name, Scenarios[i].version,
+				Scenarios[i].duration, Scenarios[i].desc);
+	printf("backends:\n");
+	print_rt_backends(stdout);
+}
+/*****************************************************************************/
+int bench_suite_main(int argc, char **argv)
+{
+	char filename[256];
+	FLAG selected[SUITE_NSCENARIOS], found;
+	char *backends[SUITE_MAX_BACKENDS], *list = NULL;
+	int duration = 0, cpu = BENCH_CPU_AUTO, nbackends = 0;
+	FILE *report;
+	int c, i, k;
+
+	optind = 1;
+	while ((c = getopt(argc, argv, "ld:c:b:h")) != -1) {
+		switch (c) {
+			case 'd': duration = atoi(optarg); break;
+			case 'c': cpu = atoi(optarg); break;
+			case 'b': list = optarg; break;
+			case 'l':
+			default: _suite_usage(); return (c == 'l') ? 0 : 1;
+		}
+	}
+	/* no names: the whole suite */
+	for (i = 0; i < SUITE_NSCENARIOS; ++i)
+		selected[i] = (optind >= argc) ? on : off;
+	for (k = optind; k < argc; ++k) {
+		found = off;
+		for (i = 0; i < SUITE_NSCENARIOS; ++i)
+			if (strcmp(argv[k], Scenarios[i].name) == 0)
+				selected[i] = found = on;
+		if (found == off) {
+			fprintf(stderr, "[SUITE] unknown scenario '%s'\n", argv[k]);
+			_suite_usage();
+			return 1;
+		}
+	}
+	/* default: the backend already selected */
+	backends[nbackends++] = get_rt_backend();
+	if (list != NULL)
+		for (nbackends = 0, list = strtok(list, ","); list != NULL && nbackends < SUITE_MAX_BACKENDS;
+				list = strtok(NULL, ","))
+			backends[nbackends++] = list;
+	for (k = 0; k < nbackends; ++k)
+		if (set_rt_backend(backends[k]) != 0) {
+			fprintf(stderr, "[SUITE] unknown backend '%s'\n", backends[k]);
+			_suite_usage();
+			return 1;
+		}
+	cpu = bench_select_cpu(cpu);
+
+	bench_init(cpu);
+	report = bench_open_result("suite_report", filename, sizeof(filename));
+	if (report == NULL)
+		return 1;
+	fprintf(report, "# scenario,version,backend,task,prio,period_us,exe_us,cs_us,jobs,misses,"
+			"resp_p50_ns,resp_p99_ns,resp_p999_ns,resp_max_ns,jitter_p99_ns,jitter_max_ns,"
+			"blocked_p99_ns,blocked_max_ns,blockings_max,chain_max\n");
+	print_rt_hist_header(stdout);
+
+	for (k = 0; k < nbackends && bBenchQuit == off; ++k) {
+		set_rt_backend(backends[k]);
+		bSimulated = is_rt_backend_simulated();
+		bench_meta("backend: %s", backends[k]);
+		for (i = 0; i < SUITE_NSCENARIOS && bBenchQuit == off; ++i)
+			if (selected[i] == on)
+				_suite_run(&Scenarios[i], duration, cpu, report);
+	}
+	fclose(report);
+
+	/* consolidated report, the same numbers as the report file */
+	report = fopen(filename, "r");
+	if (report != NULL) {
+		char line[512], scenario[64], backend[32], task[64];
+		unsigned long version, jobs, misses, p50, p99, p999, max, blocked;
+		int chain;
+
+		printf("\n%-16s %-9s %-10s %8s %7s %11s %11s %11s %11s %11s %5s\n", "scenario", "backend", "task", "jobs",
+				"misses", "p50 [us]", "p99 [us]", "p99.9 [us]", "max [us]", "blk [us]", "chain");
+		while (fgets(line, sizeof(line), report) != NULL) {
+			if (line[0] == '#')
+				continue;
+			if (sscanf(line, "%63[^,],%lu,%31[^,],%63[^,],%*d,%*d,%*d,%*d,%lu,%lu,%lu,%lu,%lu,%lu,%*u,%*u,%*u,%lu,%*d,%d",
+					scenario, &version, backend, task, &jobs, &misses, &p50, &p99, &p999, &max, &blocked, &chain) != 12)
+				continue;
+			snprintf(line, sizeof(line), "%s v%lu", scenario, version);
+			printf("%-16s %-9s %-10s %8lu %7lu %11.3f %11.3f %11.3f %11.3f %11.3f %5d\n", line, backend, task, jobs,
+					misses, p50 / 1000.0, p99 / 1000.0, p999 / 1000.0, max / 1000.0, blocked / 1000.0, chain);
+		}
+		fclose(report);
+	}
+	printf("Suite report datafile is generated at:%s\n", filename);
+	return 0;
+}
+/*****************************************************************************/
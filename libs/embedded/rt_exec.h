@@ -0,0 +1,54 @@
+#ifndef _RT_EXEC_H_
+#define _RT_EXEC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+/*****************************************************************************/
+/* RT_TASKS */
+/*****************************************************************************/
+#include "embdCOMMON.h"
+#include "rt_tasks.h"
+/*****************************************************************************/
+/* Execution time models of periodic jobs. A model is parsed from a spec in
+ * a caller unit (e.g. jiffies), next_rt_exec() draws the demand of the next
+ * job in ns without system calls:
+ *   fixed            the nominal execution time
+ *   uniform:lo,hi
+ *   normal:mean,sd
+ *   bimodal:lo,hi,p  normal modes at lo and hi (sd 5 % of each), hi with p
+ *   pareto:min,alpha heavy tail from min, smaller alpha = heavier
+ *   trace:file[:col] one demand per job, replayed in a loop; col (from 1)
+ *                    of a CSV, e.g. the demand column of a results file
+ * Draws are clamped to [0, cap], cap 0 = none. The generator is seeded per
+ * model, so a run can be repeated. */
+#define EXEC_MAX_TRACE	(1 << 22) // jobs
+#define EXEC_BIMODAL_SD	(0.05)
+
+typedef enum {
+	EXEC_FIXED = 0,
+	EXEC_UNIFORM,
+	EXEC_NORMAL,
+	EXEC_BIMODAL,
+	EXEC_PARETO,
+	EXEC_TRACE
+}RT_EXEC_KIND;
+
+typedef struct {
+	RT_EXEC_KIND kind;
+	double a, b, p; // parameters in ns, see above
+	RTIME cap;
+	RTIME *trace;
+	size_t ntrace;
+	size_t pos;
+	uint64_t state; // xorshift64*
+	char spec[128];
+}RT_EXEC;
+/*****************************************************************************/
+/* spec NULL or "" is fixed at nominal, values are scaled by unit ns */
+int parse_rt_exec(RT_EXEC *ex, const char *spec, RTIME nominal, double unit, RTIME cap, uint64_t seed);
+RTIME next_rt_exec(RT_EXEC *ex);
+FLAG is_rt_exec_fixed(RT_EXEC *ex);
+void delete_rt_exec(RT_EXEC *ex);
+#endif // _RT_EXEC_H_
@@ -0,0 +1,42 @@
+#ifndef _RT_HIST_H_
+#define _RT_HIST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+/*****************************************************************************/
+#include "embdCOMMON.h"
+/*****************************************************************************/
+/* Log-linear latency histogram (nanoseconds).
+ * Values below 2^(HIST_SUB_BITS+1) get one bucket each, above that every
+ * power of two is split in 2^HIST_SUB_BITS buckets (~3% resolution).
+ * Adding a sample is O(1) and never allocates, so it is safe inside RT loops. */
+#define HIST_SUB_BITS	(5)
+#define HIST_SUB_COUNT	(1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS	(40) // ~18 minutes, larger samples land in the last bucket
+#define HIST_BUCKETS	((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+typedef struct {
+	char *name;
+	uint64_t bins[HIST_BUCKETS];
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	double sum;
+	double sumsq;
+}RT_HIST;
+/*****************************************************************************/
+void init_rt_hist(RT_HIST *hist, char *name);
+void add_rt_hist(RT_HIST *hist, uint64_t value);
+void merge_rt_hist(RT_HIST *dst, RT_HIST *src);
+uint64_t get_rt_hist_percentile(RT_HIST *hist, double percent);
+double get_rt_hist_mean(RT_HIST *hist);
+double get_rt_hist_std(RT_HIST *hist);
+uint64_t get_rt_hist_bucket_low(int idx);
+uint64_t get_rt_hist_bucket_high(int idx);
+/*****************************************************************************/
+/* one line per histogram: count, min, average, percentiles, max in microseconds */
+void print_rt_hist_header(FILE *fp);
+void print_rt_hist(FILE *fp, RT_HIST *hist);
+/* bucket table with one column per histogram, only non-empty rows are written */
+void write_rt_hist(FILE *fp, RT_HIST *hists[], int count);
+#endif // _RT_HIST_H_
@@ -3,7 +3,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
+#include <sys/types.h>
 /*****************************************************************************/
 /* RT_TASKS */
 /*****************************************************************************/
@@ -13,15 +15,90 @@
 /* we focus on Mutex first */
 #ifdef _XENOMAI_TASKS_
 	#include <alchemy/mutex.h> // mutex
+	#include <alchemy/queue.h> // message queue
 #else
 	#include <rt_posix_mutex.h>
+	#include <rt_posix_queue.h>
 	#define RT_MUTEX PT_MUTEX
+	#define RT_QUEUE PT_QUEUE
 #endif
 /*****************************************************************************/
 /* Real-time ITCs - Mutex */
 /*****************************************************************************/
 int create_rt_mutex(RT_MUTEX *mutex, char *name);
+int create_rt_mutex_shared(RT_MUTEX *mutex, char *name);
 int delete_rt_mutex(RT_MUTEX *mutex);
 int acquire_rt_mutex(RT_MUTEX *mutex);
+int try_acquire_rt_mutex(RT_MUTEX *mutex); // never blocks, nonzero when held
 int release_rt_mutex(RT_MUTEX *mutex);
+/*****************************************************************************/
+/* Real-time ITCs - Message Queue */
+/*****************************************************************************/
+int create_rt_queue(RT_QUEUE *queue, char *name, size_t msgsize, int depth);
+int delete_rt_queue(RT_QUEUE *queue);
+int write_rt_queue(RT_QUEUE *queue, const void *buf, size_t size); // -ENOMEM when full
+ssize_t read_rt_queue(RT_QUEUE *queue, void *buf, size_t size); // blocking
+/*****************************************************************************/
+/* Lock-free ITCs - single producer / single consumer ring */
+/*****************************************************************************/
+/* Fixed-size slots, depth rounded up to a power of two. The writer never
+ * blocks, the reader may spin with trypop or sleep on a futex with pop. */
+typedef struct {
+	char *name;
+	char *buf;
+	size_t msgsize;
+	unsigned int mask;
+	unsigned int head __attribute__((aligned(64))); // written by producer
+	unsigned int waiting; // consumer sleeps on head
+	unsigned int tail __attribute__((aligned(64))); // written by consumer
+}RT_SPSC;
+
+int create_rt_spsc(RT_SPSC *ring, char *name, size_t msgsize, int depth);
+int delete_rt_spsc(RT_SPSC *ring);
+int push_rt_spsc(RT_SPSC *ring, const void *msg); // -ENOMEM when full
+int trypop_rt_spsc(RT_SPSC *ring, void *msg); // -EAGAIN when empty
+int pop_rt_spsc(RT_SPSC *ring, void *msg); // blocking
+int timedpop_rt_spsc(RT_SPSC *ring, void *msg, RTIME date); // -ETIMEDOUT at rt_timer_read() date
+/*****************************************************************************/
+/* Lock-free ITCs - latest-value exchange of a state of ITC_MIN_SIZE..ITC_MAX_SIZE */
+/*****************************************************************************/
+#define ITC_MIN_SIZE	(64)
+#define ITC_MAX_SIZE	(65536)
+#define SEQLOCK_RETRIES	(64) // a reader gives up after that many torn copies
+
+/* Single writer seqlock: the writer never waits, a reader copies and retries
+ * while a write overlapped its copy. A reader above the writer on the same
+ * cpu cannot let it finish, the retries are bounded for that case and the
+ * copy is unusable when they ran out. */
+typedef struct {
+	char *name;
+	char *buf;
+	size_t size;
+	unsigned int seq __attribute__((aligned(64))); // odd while a write is in progress
+}RT_SEQLOCK;
+
+int create_rt_seqlock(RT_SEQLOCK *sl, char *name, size_t size);
+int delete_rt_seqlock(RT_SEQLOCK *sl);
+void write_rt_seqlock(RT_SEQLOCK *sl, const void *data);
+int read_rt_seqlock(RT_SEQLOCK *sl, void *data); // retries, -EAGAIN when they ran out
+
+/* Single writer / single reader triple buffer: both sides are wait-free and
+ * work in place, the reader always gets the latest complete state. */
+typedef struct {
+	char *name;
+	char *buf; // three slots of stride bytes
+	size_t size;
+	size_t stride;
+	unsigned int back; // writer's slot
+	unsigned int front; // reader's slot
+	unsigned int middle __attribute__((aligned(64))); // latest slot, TRIPLE_FRESH when unread
+}RT_TRIPLE;
+
+int create_rt_triple(RT_TRIPLE *tb, char *name, size_t size);
+int delete_rt_triple(RT_TRIPLE *tb);
+void* get_rt_triple_back(RT_TRIPLE *tb); // fill it, then publish
+void publish_rt_triple(RT_TRIPLE *tb);
+void write_rt_triple(RT_TRIPLE *tb, const void *data); // copy and publish
+const void* get_rt_triple_front(RT_TRIPLE *tb, FLAG *fresh); // latest state, valid until the next call
+int read_rt_triple(RT_TRIPLE *tb, void *data); // 1 new state, 0 the same as before
 #endif // _RT_ITC_H_
\ No newline at end of file
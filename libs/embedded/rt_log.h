@@ -0,0 +1,64 @@
+#ifndef _RT_LOG_H_
+#define _RT_LOG_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+/*****************************************************************************/
+/* RT_TASKS */
+/*****************************************************************************/
+#include "embdCOMMON.h"
+#include "rt_tasks.h"
+#include "rt_itc.h"
+/*****************************************************************************/
+/* Non-blocking logging for RT tasks.
+ * rt_log() only copies the format pointer and the binary arguments into a
+ * lock-free ring of the calling thread, a SCHED_OTHER flusher thread
+ * formats and prints them in time order. The cost is bounded by the length
+ * of the format, a full ring drops the message and counts it. The flusher
+ * sleeps on a futex, the first message after its last drain wakes it.
+ * Formats must be literals and %s arguments must outlive the flush (task
+ * names, constant strings), at most LOG_MAX_ARGS arguments are kept.
+ * Before init_rt_log() and after stop_rt_log() rt_log() prints directly.
+ * Xenomai already has the same in rt_printf. */
+#define LOG_MAX_THREADS	(64)
+#define LOG_MAX_ARGS	(8) // a '*' width or precision takes one too
+#define LOG_DEPTH		(256) // messages per thread
+#define LOG_LINE		(1024)
+
+#ifdef _XENOMAI_TASKS_
+	#define init_rt_log(threads, depth) (0)
+	#define attach_rt_log(name) (0)
+	#define rt_log rt_printf
+	#define flush_rt_log() do {} while (0)
+	#define stop_rt_log() (0)
+#else
+typedef struct {
+	RTIME time;
+	const char *fmt;
+	int nargs;
+	uint64_t args[LOG_MAX_ARGS]; // integers, doubles and pointers as raw bits
+}RT_LOG_MSG;
+
+typedef struct {
+	RT_SPSC ring;
+	char name[16];
+	uint64_t dropped; // written by the owner thread only
+	uint64_t reported;
+	RT_LOG_MSG next; // flusher lookahead
+	FLAG pending;
+}RT_LOG_BUF;
+/*****************************************************************************/
+/* preallocates the rings of up to threads loggers and starts the flusher */
+int init_rt_log(int threads, int depth);
+/* claims a ring for the calling thread, otherwise done by its first rt_log() */
+int attach_rt_log(char *name);
+void rt_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+/* drains every ring now, from a non-RT thread */
+void flush_rt_log(void);
+/* drains, stops the flusher and frees the rings, once the loggers are gone */
+int stop_rt_log(void);
+#endif
+#endif // _RT_LOG_H_
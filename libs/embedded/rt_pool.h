@@ -0,0 +1,52 @@
+#ifndef _RT_POOL_H_
+#define _RT_POOL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+/*****************************************************************************/
+/* RT_TASKS */
+/*****************************************************************************/
+#include "embdCOMMON.h"
+#include "rt_tasks.h"
+/*****************************************************************************/
+/* Fork-join pool of pinned RT worker tasks.
+ * The task calling fork_rt_pool() is worker 0 and must run on first_cpu,
+ * workers 1..n-1 are pinned to the following cpus. Workers wait for a job
+ * either spinning (one cpu each, subject to RT throttling) or on a futex. */
+#define RT_POOL_MAX (64)
+
+typedef void (*RT_POOL_FUN)(int worker, int nworkers, void *arg);
+
+typedef struct RT_POOL RT_POOL;
+
+typedef struct {
+	RT_POOL *pool;
+	int idx;
+	RT_TASK task;
+	char name[16];
+}RT_POOL_WORKER;
+
+struct RT_POOL {
+	char *name;
+	int nworkers;
+	FLAG spin;
+	RT_POOL_WORKER workers[RT_POOL_MAX];
+	RT_POOL_FUN fun;
+	void *arg;
+	unsigned int gen __attribute__((aligned(64))); // bumped to fork
+	unsigned int pending __attribute__((aligned(64))); // helpers still working
+	int alive; // workers 1..alive started, joined by delete_rt_pool()
+	volatile FLAG quit;
+	/* timestamps of the last job */
+	RTIME t_fork;
+	RTIME t_join;
+	RTIME t_wake[RT_POOL_MAX];
+	RTIME t_done[RT_POOL_MAX];
+};
+/*****************************************************************************/
+int create_rt_pool(RT_POOL *pool, char *name, int nworkers, int prio, int first_cpu, FLAG spin);
+/* runs fun on every worker and returns when all of them are done */
+int fork_rt_pool(RT_POOL *pool, RT_POOL_FUN fun, void *arg);
+int delete_rt_pool(RT_POOL *pool);
+#endif // _RT_POOL_H_
@@ -4,14 +4,23 @@
 #include <embdCOMMON.h>
 #include <rt_posix_task.h>
 /*****************************************************************************/
-typedef struct {
+struct PT_MUTEX{
 	pthread_mutex_t lock;
 	char* name;
-}PT_MUTEX;
+	void* sim; // of the simulated backend, NULL otherwise
+};
 /*****************************************************************************/
 int pt_mutex_acquire(PT_MUTEX *mutex);
+int pt_mutex_try_acquire(PT_MUTEX *mutex); // -EBUSY when held
 int pt_mutex_create(PT_MUTEX *mutex, char* name);
+int pt_mutex_create_shared(PT_MUTEX *mutex, char* name);
 int pt_mutex_delete(PT_MUTEX *mutex);
 int pt_mutex_release(PT_MUTEX *mutex);
+/* backend side, see PtBackends */
+int pt_posix_mutex_init(PT_MUTEX *mutex, int pshared);
+int pt_posix_mutex_lock(PT_MUTEX *mutex);
+int pt_posix_mutex_trylock(PT_MUTEX *mutex);
+int pt_posix_mutex_unlock(PT_MUTEX *mutex);
+int pt_posix_mutex_destroy(PT_MUTEX *mutex);
 
 #endif // _RT_POSIX_MUTEX_H_
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef _RT_POSIX_QUEUE_H_
+#define _RT_POSIX_QUEUE_H_
+/*****************************************************************************/
+#include <embdCOMMON.h>
+#include <rt_posix_task.h>
+#include <sys/types.h>
+/*****************************************************************************/
+/* bounded message queue, fixed slot size, PI mutex + condvar */
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	char* buf;
+	size_t* len;
+	size_t msgsize;
+	int depth;
+	int head;
+	int count;
+	char* name;
+}PT_QUEUE;
+/*****************************************************************************/
+int pt_queue_create(PT_QUEUE *queue, char* name, size_t msgsize, int depth);
+int pt_queue_delete(PT_QUEUE *queue);
+/* returns -ENOMEM when the queue is full (same as rt_queue_write) */
+int pt_queue_write(PT_QUEUE *queue, const void *buf, size_t size);
+/* blocks until a message arrives, returns its size */
+ssize_t pt_queue_read(PT_QUEUE *queue, void *buf, size_t size);
+
+#endif // _RT_POSIX_QUEUE_H_
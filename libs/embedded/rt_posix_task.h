@@ -7,7 +7,9 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <errno.h>
+#include <time.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sys/mman.h>
 #include <sys/timerfd.h>
 /*****************************************************************************/
@@ -15,10 +17,12 @@
 /*****************************************************************************/
 #define START_DELAY_SECS 1 //1sec
 #define NANOSEC_PER_SEC 1000000000
-#define CLOCK_TO_USE CLOCK_MONOTONIC
+#define CLOCK_TO_USE PtClock // runtime selectable, see pt_timer_set_clock()
 #define TIMESPEC2NS(T) ((uint64_t) (T).tv_sec * NANOSEC_PER_SEC + (T).tv_nsec)
 #define TMR_NOW (-99)
 #define PREDEFINED_STKSIZE (32) //for 32 kb
+#define PT_DL_PERIOD (NANOSEC_PER_SEC / 100) // reservation of an aperiodic deadline task
+#define PT_DL_SHARE (20) // % of the period without pt_task_set_budget()
 
 /* error code */
 typedef enum{
@@ -32,12 +36,18 @@ typedef enum{
 	ETMRFD,
 	ESETPRD,
 	EPTHCREATE,
-	EPTHNAME
+	EPTHNAME,
+	ESETCPU,
+	EJOIN,
+	EBACKEND,
+	EENTER
 }ERROR_CODE;
 
 typedef int FDTIMER; //for fd timer
 typedef uint64_t PRTIME; //for timer probe
 typedef TASK_TYPE PT_MODE;
+
+extern clockid_t PtClock;
 /*****************************************************************************/
 typedef struct{
 	pthread_t thread;
@@ -51,8 +61,46 @@ typedef struct{
 	PRTIME period;
 	char* name;
 	pid_t pid;
+	int cpu;
+	PRTIME runtime; // deadline backend, 0 until pt_task_set_budget()
+	PRTIME dl_period;
 
 }PT_TASK;
+
+typedef struct PT_MUTEX PT_MUTEX; // rt_posix_mutex.h
+/*****************************************************************************/
+/* Scheduling backend of the tasks and mutexes. A backend sets the scheduling
+ * attributes before the start (create, set_cpus), the parameters the
+ * attributes cannot hold from inside the new thread (enter, a failure fails
+ * pt_task_start) and dispatch holds the started task until its scheduler
+ * runs it. The periods, sleeps, clock, spins and mutexes behind the pt_
+ * calls are the backend's too, the simulated one replaces them all
+ * (rt_sim.h). mutex_protocol is of the POSIX mutexes. */
+typedef struct{
+	char* name;
+	char* desc;
+	int policy;
+	int mutex_protocol;
+	int (*create)(PT_TASK* task, int prio);
+	int (*set_cpus)(PT_TASK* task, cpu_set_t *cpus);
+	int (*enter)(char* name, int prio, PRTIME runtime, PRTIME period); // NULL: nothing to do
+	void (*dispatch)(void); // NULL: runs at once
+	void (*discard)(PT_TASK* task); // created, not going to start; NULL: nothing to do
+	int (*set_periodic)(PT_TASK* task, PRTIME idate, PRTIME period);
+	void (*wait_period)(PT_TASK* task);
+	int (*sleep_until)(PRTIME date);
+	PRTIME (*read)(void);
+	void (*spin)(PRTIME ns);
+	int (*mutex_init)(PT_MUTEX* mutex, int pshared);
+	int (*mutex_lock)(PT_MUTEX* mutex);
+	int (*mutex_trylock)(PT_MUTEX* mutex); // -EBUSY when held
+	int (*mutex_unlock)(PT_MUTEX* mutex);
+	int (*mutex_destroy)(PT_MUTEX* mutex);
+	FLAG simulated;
+}PT_BACKEND;
+
+extern PT_BACKEND PtBackends[]; // up to the first without name
+extern PT_BACKEND *PtBackend;
 /*****************************************************************************/
 /* Creation of real-time periodic task using Xenomai Posix Skin 
  * MyPosixThread -> address of pthread descriptor
@@ -66,12 +114,31 @@ typedef struct{
  *****************************************************************************/ 
 int pt_task_create(PT_TASK* task,char* name, int stksize, int prio, PT_MODE mode);
 /*****************************************************************************/
+/* idate: TMR_NOW starts START_DELAY_SECS from now, otherwise the absolute
+ * date of the first release */
 int pt_task_set_periodic(PT_TASK* task,PRTIME idate, PRTIME period);
 /*****************************************************************************/
 int pt_task_start(PT_TASK* task,void (*entry)(void *arg) , void* arg);
+/* Releases a created task that is not going to be started */
+int pt_task_discard(PT_TASK* task);
+/*****************************************************************************/
+/* Pins a created (not yet started) task to a single cpu, default is cpu 0 */
+int pt_task_set_affinity(PT_TASK* task, int cpu);
+int pt_task_set_cpus(PT_TASK* task, cpu_set_t *cpus);
+/*****************************************************************************/
+/* Runtime per period of the deadline backend, ignored by the others. Without
+ * it a task reserves PT_DL_SHARE % of its period or of PT_DL_PERIOD. */
+int pt_task_set_budget(PT_TASK* task, PRTIME runtime, PRTIME period);
 /*****************************************************************************/
 void pt_task_wait_period(PT_TASK *task);
 /*****************************************************************************/
+/* Sleeps until an absolute date of pt_timer_read() in nanoseconds */
+int pt_task_sleep_until(PRTIME date);
+/*****************************************************************************/
+/* Created tasks are detached, a joinable one is waited for with pt_task_join */
+int pt_task_set_joinable(PT_TASK* task);
+int pt_task_join(PT_TASK* task);
+/*****************************************************************************/
 void pt_task_delete(void);
 /*****************************************************************************/
 /* Returns the current system time expressed in nanoseconds
@@ -80,6 +147,16 @@ PRTIME pt_timer_read(void);
 /*****************************************************************************/
 void pt_timer_spin(PRTIME spintime);
 PRTIME pt_timer_ns2ticks(PRTIME ticks);
+/*****************************************************************************/
+/* Selects the clock of pt_timer_read(), periods and sleeps (default
+ * CLOCK_MONOTONIC). The clock has to support absolute clock_nanosleep(),
+ * call it before any task is created. */
+int pt_timer_set_clock(clockid_t clock);
+clockid_t pt_timer_get_clock(void);
+/*****************************************************************************/
+/* Selects the backend of PtBackends by name (default "fifo"), call it
+ * before any task or mutex is created. */
+int pt_backend_set(char* name);
 
 #define TASK_DBG(mode,format, args...) printf("[%s Task] "format"\n", mode, ##args) 
 
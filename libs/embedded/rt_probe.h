@@ -0,0 +1,37 @@
+#ifndef _RT_PROBE_H_
+#define _RT_PROBE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+/*****************************************************************************/
+/* RT_TASKS */
+/*****************************************************************************/
+#include "embdCOMMON.h"
+#include "rt_tasks.h"
+/*****************************************************************************/
+/* Calibration of the rt_timer_read() probes, measured by an RT task pinned
+ * to the cpu under test. A response time bracketed by two probes contains
+ * one back-to-back probe delta (bias), which can be subtracted. */
+#define PROBE_SAMPLES	(100000)
+#define PROBE_PRIO		(99)
+
+typedef struct {
+	int cpu;
+	int samples;
+	double read_avg; // ns per rt_timer_read(), averaged over a tight loop
+	RTIME delta_min; // back-to-back probe delta distribution
+	RTIME delta_p50;
+	RTIME delta_p99;
+	RTIME delta_max;
+	RTIME resolution; // smallest non-zero back-to-back delta
+	uint64_t zero_deltas; // back-to-back reads returning the same time
+	RTIME bias; // what a bracket adds to every response time
+	volatile int done;
+}RT_PROBE_CAL;
+/*****************************************************************************/
+int calibrate_rt_probe(RT_PROBE_CAL *cal, int cpu, int samples);
+/* "# key: value" lines, returns the length written */
+int format_rt_probe_cal(char *buf, size_t size, RT_PROBE_CAL *cal);
+#endif // _RT_PROBE_H_
@@ -0,0 +1,118 @@
+#ifndef _RT_RECORDER_H_
+#define _RT_RECORDER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+/*****************************************************************************/
+/* RT_TASKS */
+/*****************************************************************************/
+#include "embdCOMMON.h"
+#include "rt_tasks.h"
+#include "rt_itc.h"
+#include "rt_hist.h"
+/*****************************************************************************/
+/* Flight recorder for long soak runs.
+ * Every sample of every task goes into one always-on event ring. A sample
+ * above the jitter/response limits or missing its deadline freezes the
+ * `pre` events before and the `post` events after it, a low priority writer
+ * thread stores that snapshot to its own file. Normal samples are only kept
+ * as per-task rolling windows (count, min/avg/percentiles/max) appended to
+ * a summary file, so memory and disk stay bounded for any duration. The
+ * writer sleeps until a window closes or a snapshot is complete. */
+#define REC_MAX_TASKS	(16)
+#define REC_DEPTH		(16384) // events in the ring
+#define REC_PRE			(1000)
+#define REC_POST		(1000)
+#define REC_WINDOW		(60) // seconds
+#define REC_MAX_CAPTURES (1000) // snapshot files per run
+
+typedef enum {
+	REC_NONE = 0,
+	REC_JITTER,
+	REC_RESPONSE,
+	REC_DEADLINE
+}REC_REASON;
+
+typedef struct {
+	uint64_t seq; // event number + 1, 0 marks a slot never written
+	RTIME time;
+	int16_t task;
+	int16_t reason; // REC_REASON when this sample triggered
+	int32_t prd;
+	int32_t resp;
+	int32_t jtr;
+}RT_EVENT;
+
+typedef struct {
+	int task;
+	RTIME t_start;
+	RTIME t_end;
+	uint64_t count;
+	uint64_t misses;
+	uint64_t triggers;
+	int32_t prd_min;
+	int32_t prd_max;
+	int32_t resp_min;
+	int32_t resp_p50;
+	int32_t resp_p99;
+	int32_t resp_max;
+	int32_t jtr_p99;
+	int32_t jtr_max;
+	double resp_avg;
+}RT_WINDOW_SUMMARY;
+
+typedef struct {
+	char *name;
+	RTIME t_start;
+	uint64_t count;
+	uint64_t misses;
+	uint64_t triggers;
+	int32_t prd_min;
+	int32_t prd_max;
+	RT_HIST resp;
+	RT_HIST jtr;
+	RT_SPSC closed; // RT_WINDOW_SUMMARY for the writer
+	uint64_t dropped;
+}RT_WINDOW;
+
+typedef struct {
+	RT_EVENT *ring;
+	unsigned int mask;
+	uint64_t head __attribute__((aligned(64)));
+	uint64_t trig __attribute__((aligned(64))); // triggering event + 1, 0 when idle
+	uint64_t triggers;
+	uint64_t suppressed;
+	uint64_t captures;
+	int pre;
+	int post;
+	int32_t jtr_limit; // 0 disables
+	int32_t resp_limit; // 0 disables
+	RTIME window;
+	RT_WINDOW windows[REC_MAX_TASKS];
+	int ntasks;
+	/* writer */
+	char prefix[200];
+	char *meta; // written on top of every file, may be NULL
+	FILE *summary;
+	RT_EVENT *snapshot;
+	pthread_t writer;
+	volatile FLAG quit;
+	unsigned int kick __attribute__((aligned(64))); // futex word the writer sleeps on
+	int idle; // set by the writer before it flushes and sleeps
+}RT_RECORDER;
+/*****************************************************************************/
+int create_rt_recorder(RT_RECORDER *rec, int depth, int pre, int post, RTIME window);
+int delete_rt_recorder(RT_RECORDER *rec);
+void set_rt_recorder_limits(RT_RECORDER *rec, int32_t jtr_limit, int32_t resp_limit);
+void set_rt_recorder_meta(RT_RECORDER *rec, char *meta);
+/* returns the task id to log with, call before the tasks start */
+int add_rt_recorder_task(RT_RECORDER *rec, char *name);
+/* RT side: bounded, lock-free, never blocks */
+void log_rt_recorder(RT_RECORDER *rec, int task, int32_t prd, int32_t resp, int32_t jtr, FLAG miss);
+/* writer thread, files are <prefix>_summary.dat and <prefix>_outlier_<n>.dat */
+int start_rt_recorder(RT_RECORDER *rec, char *prefix);
+int stop_rt_recorder(RT_RECORDER *rec);
+#endif // _RT_RECORDER_H_
@@ -0,0 +1,56 @@
+#ifndef _RT_SIM_H_
+#define _RT_SIM_H_
+/*****************************************************************************/
+#include <embdCOMMON.h>
+#include <rt_posix_task.h>
+#include <rt_posix_mutex.h>
+/*****************************************************************************/
+/* Discrete-event simulation behind the "sim" backend of rt_posix_task.
+ * The RT tasks stay threads running their own bodies, but only one of them
+ * holds the simulated cpu at a time and the clock is virtual: it moves by
+ * the time a task spins and jumps to the next release when every task
+ * sleeps and no created task is still to start. A run is then the same for
+ * a given task set on any host load as long as the whole set is created
+ * before the first start; discard_rt_task() the ones not started. The model is one cpu with preemptive fixed priorities (FIFO among
+ * equals) and priority inheritance mutexes, so a run of 100 s takes as long
+ * as its context switches. Bodies may use the clock, spins, periods, sleeps
+ * and mutexes, anything else that blocks (queues, futexes) stalls the
+ * simulated cpu. Overheads, all 0 by default:
+ *   ctx    : charged to a task each time it gets the cpu from another
+ *   wake   : from the requested wakeup to ready
+ *   jitter : uniform random 0..jitter on top of wake (seeded, repeatable)
+ *   read   : cost of one clock read in a task */
+#define SIM_MAX_HELD	(8) // mutexes a task holds at once
+
+typedef struct{
+	PRTIME ctx;
+	PRTIME wake;
+	PRTIME jitter;
+	PRTIME read;
+	unsigned int seed;
+}PT_SIM_OVERHEAD;
+
+typedef struct{
+	uint64_t switches;
+	uint64_t preemptions;
+	uint64_t blocked; // mutex acquisitions that waited
+	uint64_t boosts; // priority inheritance raises
+}PT_SIM_STATS;
+/*****************************************************************************/
+int pt_sim_set_overhead(PT_SIM_OVERHEAD *ovh);
+void pt_sim_get_stats(PT_SIM_STATS *stats);
+/* backend side, see PtBackends */
+int pt_sim_create(PT_TASK* task, int prio);
+int pt_sim_enter(char* name, int prio, PRTIME runtime, PRTIME period);
+void pt_sim_discard(PT_TASK* task);
+void pt_sim_dispatch(void);
+PRTIME pt_sim_read(void);
+void pt_sim_spin(PRTIME ns);
+int pt_sim_sleep_until(PRTIME date);
+int pt_sim_mutex_init(PT_MUTEX* mutex, int pshared); // -ENOTSUP for a shared one
+int pt_sim_mutex_destroy(PT_MUTEX* mutex);
+int pt_sim_mutex_lock(PT_MUTEX* mutex);
+int pt_sim_mutex_trylock(PT_MUTEX* mutex);
+int pt_sim_mutex_unlock(PT_MUTEX* mutex);
+
+#endif // _RT_SIM_H_
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
 /*****************************************************************************/
 /* RT_TASKS */
 /*****************************************************************************/
@@ -28,9 +29,33 @@
 /* Real-time Task */
 /*****************************************************************************/
 int create_rt_task(RT_TASK *task, char *name, int prio);
+/* the task returns from its function instead of delete_rt_task(), the
+ * creator collects it with join_rt_task() */
+int create_rt_task_joinable(RT_TASK *task, char *name, int prio);
+int join_rt_task(RT_TASK *task);
+/* a created task that is not going to be started */
+int discard_rt_task(RT_TASK *task);
 int set_rt_task_period(RT_TASK *task, RTIME period);
+/* periodic with the first release at an absolute rt_timer_read() date */
+int set_rt_task_release(RT_TASK *task, RTIME release, RTIME period);
+int set_rt_task_affinity(RT_TASK *task, int cpu);
+/* any cpu of the set, the kernel migrates the task between them */
+int set_rt_task_cpus(RT_TASK *task, cpu_set_t *cpus);
+/* runtime per period of the deadline backend, before the start */
+int set_rt_task_budget(RT_TASK *task, RTIME runtime, RTIME period);
 int start_rt_task(int enable, RT_TASK *task, void (*fun)(void *cookie));
+int start_rt_task_arg(int enable, RT_TASK *task, void (*fun)(void *cookie), void *arg);
 void wait_rt_period(RT_TASK *task);
+int sleep_rt_task_until(RTIME date);
 void delete_rt_task(void);
+/* clock of rt_timer_read() and the task timers, before any task is created */
+int set_rt_clock(clockid_t clock);
+/* scheduling backend of the tasks created afterwards: fifo (default), rr,
+ * deadline or other, Xenomai has alchemy only */
+int set_rt_backend(char *name);
+char* get_rt_backend(void);
+/* on for a backend with a virtual clock and cpu (sim) */
+FLAG is_rt_backend_simulated(void);
+void print_rt_backends(FILE *fp);
 void print_xeno_skin(void);
 #endif //_RT_TASK_H_
\ No newline at end of file
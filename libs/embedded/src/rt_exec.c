@@ -0,0 +1,162 @@
+/*****************************************************************************/
+#include <rt_exec.h>
+#include <string.h>
+#include <math.h>
+/*****************************************************************************/
+static uint64_t _exec_rand(RT_EXEC *ex)
+{
+	ex->state ^= ex->state >> 12;
+	ex->state ^= ex->state << 25;
+	ex->state ^= ex->state >> 27;
+	return ex->state * 0x2545F4914F6CDD1DULL;
+}
+/*****************************************************************************/
+/* (0, 1) */
+static double _exec_uniform(RT_EXEC *ex)
+{
+	return ((_exec_rand(ex) >> 11) + 0.5) / 9007199254740992.0;
+}
+/*****************************************************************************/
+static double _exec_normal(RT_EXEC *ex)
+{
+	return sqrt(-2.0 * log(_exec_uniform(ex))) * cos(2.0 * M_PI * _exec_uniform(ex));
+}
+/*****************************************************************************/
+static int _exec_load_trace(RT_EXEC *ex, char *arg, double unit)
+{
+	char line[512], *col, *p;
+	RTIME *grown;
+	size_t size = 1024;
+	int field = 1, i;
+	FILE *fp;
+
+	col = strrchr(arg, ':');
+	if (col != NULL) {
+		*col = '\0';
+		field = atoi(col + 1);
+		if (field < 1)
+			return -EINVAL;
+	}
+	fp = fopen(arg, "r");
+	if (fp == NULL) {
+		perror(arg);
+		return -ENOENT;
+	}
+	ex->trace = malloc(size * sizeof(RTIME));
+	ex->ntrace = 0;
+	while (ex->trace != NULL && ex->ntrace < EXEC_MAX_TRACE && fgets(line, sizeof(line), fp) != NULL) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		for (p = line, i = 1; i < field && p != NULL; ++i) {
+			p = strchr(p, ',');
+			if (p != NULL)
+				++p;
+		}
+		if (p == NULL)
+			continue;
+		if (ex->ntrace == size) {
+			grown = realloc(ex->trace, 2 * size * sizeof(RTIME));
+			if (grown == NULL) {
+				free(ex->trace);
+				ex->trace = NULL;
+				break;
+			}
+			ex->trace = grown;
+			size *= 2;
+		}
+		ex->trace[ex->ntrace++] = (RTIME)(strtod(p, NULL) * unit);
+	}
+	fclose(fp);
+	if (ex->trace == NULL || ex->ntrace == 0) {
+		fprintf(stderr, "[EXEC] no demands in %s\n", arg);
+		free(ex->trace);
+		ex->trace = NULL;
+		return -EINVAL;
+	}
+	return 0;
+}
+/*****************************************************************************/
+int parse_rt_exec(RT_EXEC *ex, const char *spec, RTIME nominal, double unit, RTIME cap, uint64_t seed)
+{
+	char buf[sizeof(ex->spec)], *arg;
+	double v[3] = {0, 0, 0};
+	int n = 0;
+
+	memset(ex, 0, sizeof(RT_EXEC));
+	ex->kind = EXEC_FIXED;
+	ex->a = nominal;
+	ex->cap = cap;
+	ex->state = seed ? seed : 1;
+	if (spec == NULL || spec[0] == '\0' || strcmp(spec, "fixed") == 0) {
+		snprintf(ex->spec, sizeof(ex->spec), "fixed");
+		return 0;
+	}
+	snprintf(ex->spec, sizeof(ex->spec), "%s", spec);
+	snprintf(buf, sizeof(buf), "%s", spec);
+	arg = strchr(buf, ':');
+	if (arg == NULL)
+		return -EINVAL;
+	*arg++ = '\0';
+
+	if (strcmp(buf, "trace") == 0) {
+		ex->kind = EXEC_TRACE;
+		return _exec_load_trace(ex, arg, unit);
+	}
+	n = sscanf(arg, "%lf,%lf,%lf", &v[0], &v[1], &v[2]);
+	ex->a = v[0] * unit;
+	ex->b = v[1] * unit;
+	if (strcmp(buf, "uniform") == 0 && n == 2 && v[1] >= v[0])
+		ex->kind = EXEC_UNIFORM;
+	else if (strcmp(buf, "normal") == 0 && n == 2)
+		ex->kind = EXEC_NORMAL;
+	else if (strcmp(buf, "bimodal") == 0 && n == 3 && v[2] >= 0 && v[2] <= 1) {
+		ex->kind = EXEC_BIMODAL;
+		ex->p = v[2];
+	}
+	else if (strcmp(buf, "pareto") == 0 && n == 2 && v[1] > 0) {
+		ex->kind = EXEC_PARETO;
+		ex->b = v[1]; // alpha, no unit
+	}
+	else
+		return -EINVAL;
+	return 0;
+}
+/*****************************************************************************/
+RTIME next_rt_exec(RT_EXEC *ex)
+{
+	double d;
+
+	switch (ex->kind) {
+		case EXEC_UNIFORM: d = ex->a + (ex->b - ex->a) * _exec_uniform(ex); break;
+		case EXEC_NORMAL: d = ex->a + ex->b * _exec_normal(ex); break;
+		case EXEC_BIMODAL:
+			d = (_exec_uniform(ex) < ex->p) ? ex->b : ex->a;
+			d += d * EXEC_BIMODAL_SD * _exec_normal(ex);
+			break;
+		case EXEC_PARETO: d = ex->a / pow(_exec_uniform(ex), 1.0 / ex->b); break;
+		case EXEC_TRACE:
+			d = ex->trace[ex->pos++];
+			if (ex->pos == ex->ntrace)
+				ex->pos = 0;
+			break;
+		default: d = ex->a; break;
+	}
+	if (d < 0)
+		d = 0;
+	if (ex->cap > 0 && d > ex->cap)
+		d = ex->cap;
+	return (RTIME)d;
+}
+/*****************************************************************************/
+FLAG is_rt_exec_fixed(RT_EXEC *ex)
+{
+	return (ex->kind == EXEC_FIXED) ? on : off;
+}
+/*****************************************************************************/
+void delete_rt_exec(RT_EXEC *ex)
+{
+	free(ex->trace);
+	ex->trace = NULL;
+	ex->ntrace = 0;
+}
+/*****************************************************************************/
@@ -0,0 +1,176 @@
+/*****************************************************************************/
+#include <rt_hist.h>
+#include <string.h>
+#include <math.h>
+/*****************************************************************************/
+static int _hist_index(uint64_t value);
+/*****************************************************************************/
+void init_rt_hist(RT_HIST *hist, char *name)
+{
+	memset(hist, 0, sizeof(RT_HIST));
+	hist->name = name;
+	hist->min = UINT64_MAX;
+}
+/*****************************************************************************/
+void add_rt_hist(RT_HIST *hist, uint64_t value)
+{
+	hist->bins[_hist_index(value)]++;
+	hist->count++;
+	hist->sum += (double)value;
+	hist->sumsq += (double)value * (double)value;
+	if (value < hist->min)
+		hist->min = value;
+	if (value > hist->max)
+		hist->max = value;
+}
+/*****************************************************************************/
+void merge_rt_hist(RT_HIST *dst, RT_HIST *src)
+{
+	int i;
+
+	if (src->count == 0)
+		return;
+	for (i = 0; i < HIST_BUCKETS; ++i)
+		dst->bins[i] += src->bins[i];
+	dst->count += src->count;
+	dst->sum += src->sum;
+	dst->sumsq += src->sumsq;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+/*****************************************************************************/
+uint64_t get_rt_hist_percentile(RT_HIST *hist, double percent)
+{
+	uint64_t target, cum = 0;
+	uint64_t high;
+	int i;
+
+	if (hist->count == 0)
+		return 0;
+	if (percent <= 0)
+		return hist->min;
+
+	target = (uint64_t)ceil(percent / 100.0 * (double)hist->count);
+	if (target > hist->count)
+		target = hist->count;
+
+	for (i = 0; i < HIST_BUCKETS; ++i) {
+		cum += hist->bins[i];
+		if (cum >= target) {
+			/* report the upper edge of the bucket, never beyond the real max */
+			high = get_rt_hist_bucket_high(i);
+			return (high > hist->max) ? hist->max : high;
+		}
+	}
+	return hist->max;
+}
+/*****************************************************************************/
+double get_rt_hist_mean(RT_HIST *hist)
+{
+	if (hist->count == 0)
+		return 0;
+	return hist->sum / (double)hist->count;
+}
+/*****************************************************************************/
+double get_rt_hist_std(RT_HIST *hist)
+{
+	double mean, var;
+
+	if (hist->count == 0)
+		return 0;
+	mean = get_rt_hist_mean(hist);
+	var = hist->sumsq / (double)hist->count - mean * mean;
+	return (var > 0) ? sqrt(var) : 0;
+}
+/*****************************************************************************/
+uint64_t get_rt_hist_bucket_low(int idx)
+{
+	int exp;
+	uint64_t mant;
+
+	if (idx < 2 * HIST_SUB_COUNT)
+		return idx;
+	exp = idx / HIST_SUB_COUNT - 1;
+	mant = (idx % HIST_SUB_COUNT) + HIST_SUB_COUNT;
+	return mant << exp;
+}
+/*****************************************************************************/
+uint64_t get_rt_hist_bucket_high(int idx)
+{
+	int exp;
+	uint64_t mant;
+
+	if (idx < 2 * HIST_SUB_COUNT)
+		return idx;
+	if (idx == HIST_BUCKETS - 1)
+		return UINT64_MAX;
+	exp = idx / HIST_SUB_COUNT - 1;
+	mant = (idx % HIST_SUB_COUNT) + HIST_SUB_COUNT;
+	return ((mant + 1) << exp) - 1;
+}
+/*****************************************************************************/
+void print_rt_hist_header(FILE *fp)
+{
+	fprintf(fp, "%-24s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+			"[us]", "count", "min", "avg", "p50", "p99", "p99.9", "p99.99", "max");
+}
+/*****************************************************************************/
+void print_rt_hist(FILE *fp, RT_HIST *hist)
+{
+	if (hist->count == 0) {
+		fprintf(fp, "%-24s %10d %10s\n", hist->name, 0, "-");
+		return;
+	}
+	fprintf(fp, "%-24s %10lu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+			hist->name,
+			(unsigned long)hist->count,
+			(double)hist->min / NSEC_PER_USEC,
+			get_rt_hist_mean(hist) / NSEC_PER_USEC,
+			(double)get_rt_hist_percentile(hist, 50) / NSEC_PER_USEC,
+			(double)get_rt_hist_percentile(hist, 99) / NSEC_PER_USEC,
+			(double)get_rt_hist_percentile(hist, 99.9) / NSEC_PER_USEC,
+			(double)get_rt_hist_percentile(hist, 99.99) / NSEC_PER_USEC,
+			(double)hist->max / NSEC_PER_USEC);
+}
+/*****************************************************************************/
+void write_rt_hist(FILE *fp, RT_HIST *hists[], int count)
+{
+	int i, k, used;
+
+	fprintf(fp, "# bucket_low_ns,bucket_high_ns");
+	for (k = 0; k < count; ++k)
+		fprintf(fp, ",%s", hists[k]->name);
+	fprintf(fp, "\n");
+
+	for (i = 0; i < HIST_BUCKETS; ++i) {
+		used = 0;
+		for (k = 0; k < count; ++k)
+			used |= (hists[k]->bins[i] != 0);
+		if (!used)
+			continue;
+
+		fprintf(fp, "%lu,%lu", (unsigned long)get_rt_hist_bucket_low(i),
+				(unsigned long)get_rt_hist_bucket_high(i));
+		for (k = 0; k < count; ++k)
+			fprintf(fp, ",%lu", (unsigned long)hists[k]->bins[i]);
+		fprintf(fp, "\n");
+	}
+}
+/*****************************************************************************/
+static int _hist_index(uint64_t value)
+{
+	int msb, exp;
+
+	if (value < 2 * HIST_SUB_COUNT)
+		return (int)value;
+
+	msb = 63 - __builtin_clzll(value);
+	if (msb >= HIST_MAX_BITS)
+		return HIST_BUCKETS - 1;
+
+	exp = msb - HIST_SUB_BITS;
+	return exp * HIST_SUB_COUNT + (int)(value >> exp);
+}
+/*****************************************************************************/
@@ -1,7 +1,15 @@
 /*****************************************************************************/
 #include <rt_itc.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+/*****************************************************************************/
+#define TRIPLE_FRESH	(4u)
+#define TRIPLE_SLOT		(3u)
 /*****************************************************************************/
 #define MUTEX_MODE TM_INFINITE
+#define QUEUE_MODE TM_INFINITE
 /*****************************************************************************/
 int create_rt_mutex(RT_MUTEX *mutex, char *name)
 {
@@ -12,6 +20,16 @@ int create_rt_mutex(RT_MUTEX *mutex, char *name)
 #endif
 }
 /*****************************************************************************/
+/* for tasks of different processes, in shared memory */
+int create_rt_mutex_shared(RT_MUTEX *mutex, char *name)
+{
+#ifdef _XENOMAI_TASKS_
+	return -ENOTSUP; // alchemy objects are shared through the registry instead
+#else
+	return pt_mutex_create_shared(mutex, name);
+#endif
+}
+/*****************************************************************************/
 int delete_rt_mutex(RT_MUTEX *mutex)
 {
 #ifdef _XENOMAI_TASKS_
@@ -30,6 +48,15 @@ int acquire_rt_mutex(RT_MUTEX *mutex)
 #endif
 }
 /*****************************************************************************/
+int try_acquire_rt_mutex(RT_MUTEX *mutex)
+{
+#ifdef _XENOMAI_TASKS_
+	return rt_mutex_acquire(mutex, TM_NONBLOCK);
+#else
+	return pt_mutex_try_acquire(mutex);
+#endif
+}
+/*****************************************************************************/
 int release_rt_mutex(RT_MUTEX *mutex)
 {
 #ifdef _XENOMAI_TASKS_
@@ -39,3 +66,241 @@ int release_rt_mutex(RT_MUTEX *mutex)
 #endif
 }
 /*****************************************************************************/
+int create_rt_queue(RT_QUEUE *queue, char *name, size_t msgsize, int depth)
+{
+#ifdef _XENOMAI_TASKS_
+	/* pool holds depth messages plus the allocator overhead */
+	return rt_queue_create(queue, name, 2 * msgsize * depth, depth, Q_FIFO);
+#else
+	return pt_queue_create(queue, name, msgsize, depth);
+#endif
+}
+/*****************************************************************************/
+int delete_rt_queue(RT_QUEUE *queue)
+{
+#ifdef _XENOMAI_TASKS_
+	return rt_queue_delete(queue);
+#else
+	return pt_queue_delete(queue);
+#endif
+}
+/*****************************************************************************/
+int write_rt_queue(RT_QUEUE *queue, const void *buf, size_t size)
+{
+#ifdef _XENOMAI_TASKS_
+	int ret = rt_queue_write(queue, buf, size, Q_NORMAL);
+	return (ret < 0) ? ret : 0;
+#else
+	return pt_queue_write(queue, buf, size);
+#endif
+}
+/*****************************************************************************/
+ssize_t read_rt_queue(RT_QUEUE *queue, void *buf, size_t size)
+{
+#ifdef _XENOMAI_TASKS_
+	return rt_queue_read(queue, buf, size, QUEUE_MODE);
+#else
+	return pt_queue_read(queue, buf, size);
+#endif
+}
+/*****************************************************************************/
+int create_rt_spsc(RT_SPSC *ring, char *name, size_t msgsize, int depth)
+{
+	unsigned int size = 1;
+
+	while (size < (unsigned int)depth)
+		size <<= 1;
+
+	memset(ring, 0, sizeof(RT_SPSC));
+	ring->buf = calloc(size, msgsize);
+	if (ring->buf == NULL)
+		return -ENOMEM;
+	ring->name = name;
+	ring->msgsize = msgsize;
+	ring->mask = size - 1;
+	return 0;
+}
+/*****************************************************************************/
+int delete_rt_spsc(RT_SPSC *ring)
+{
+	free(ring->buf);
+	ring->buf = NULL;
+	return 0;
+}
+/*****************************************************************************/
+int push_rt_spsc(RT_SPSC *ring, const void *msg)
+{
+	unsigned int head = ring->head;
+
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask)
+		return -ENOMEM;
+
+	memcpy(ring->buf + (head & ring->mask) * ring->msgsize, msg, ring->msgsize);
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+
+	/* only pay for the syscall when the consumer is asleep */
+	if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST))
+		syscall(SYS_futex, &ring->head, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	return 0;
+}
+/*****************************************************************************/
+int trypop_rt_spsc(RT_SPSC *ring, void *msg)
+{
+	unsigned int tail = ring->tail;
+
+	if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+		return -EAGAIN;
+
+	memcpy(msg, ring->buf + (tail & ring->mask) * ring->msgsize, ring->msgsize);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+/*****************************************************************************/
+int pop_rt_spsc(RT_SPSC *ring, void *msg)
+{
+	unsigned int tail;
+
+	while (trypop_rt_spsc(ring, msg) != 0) {
+		tail = ring->tail;
+		__atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail)
+			syscall(SYS_futex, &ring->head, FUTEX_WAIT_PRIVATE, tail, NULL, NULL, 0);
+		__atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+	}
+	return 0;
+}
+/*****************************************************************************/
+int timedpop_rt_spsc(RT_SPSC *ring, void *msg, RTIME date)
+{
+	struct timespec timeout;
+	unsigned int tail;
+	RTIME now;
+
+	while (trypop_rt_spsc(ring, msg) != 0) {
+		now = rt_timer_read();
+		if (now >= date)
+			return -ETIMEDOUT;
+		/* relative, FUTEX_WAIT does not know the clock of rt_timer_read() */
+		timeout.tv_sec = (date - now) / NSEC_PER_SEC;
+		timeout.tv_nsec = (date - now) % NSEC_PER_SEC;
+		tail = ring->tail;
+		__atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail)
+			syscall(SYS_futex, &ring->head, FUTEX_WAIT_PRIVATE, tail, &timeout, NULL, 0);
+		__atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+	}
+	return 0;
+}
+/*****************************************************************************/
+int create_rt_seqlock(RT_SEQLOCK *sl, char *name, size_t size)
+{
+	if (size < ITC_MIN_SIZE || size > ITC_MAX_SIZE)
+		return -EINVAL;
+	memset(sl, 0, sizeof(RT_SEQLOCK));
+	sl->buf = calloc(1, size);
+	if (sl->buf == NULL)
+		return -ENOMEM;
+	sl->name = name;
+	sl->size = size;
+	return 0;
+}
+/*****************************************************************************/
+int delete_rt_seqlock(RT_SEQLOCK *sl)
+{
+	free(sl->buf);
+	sl->buf = NULL;
+	return 0;
+}
+/*****************************************************************************/
+void write_rt_seqlock(RT_SEQLOCK *sl, const void *data)
+{
+	unsigned int seq = sl->seq;
+
+	__atomic_store_n(&sl->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(sl->buf, data, sl->size);
+	__atomic_store_n(&sl->seq, seq + 2, __ATOMIC_RELEASE);
+}
+/*****************************************************************************/
+int read_rt_seqlock(RT_SEQLOCK *sl, void *data)
+{
+	unsigned int seq;
+	int retries;
+
+	for (retries = 0; retries <= SEQLOCK_RETRIES; ++retries) {
+		seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			cpu_relax();
+			continue;
+		}
+		memcpy(data, sl->buf, sl->size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&sl->seq, __ATOMIC_RELAXED) == seq)
+			return retries;
+	}
+	return -EAGAIN;
+}
+/*****************************************************************************/
+int create_rt_triple(RT_TRIPLE *tb, char *name, size_t size)
+{
+	if (size < ITC_MIN_SIZE || size > ITC_MAX_SIZE)
+		return -EINVAL;
+	memset(tb, 0, sizeof(RT_TRIPLE));
+	tb->stride = (size + 63) & ~(size_t)63; // no slot shares a cache line
+	tb->buf = calloc(TRIPLE_SLOT, tb->stride);
+	if (tb->buf == NULL)
+		return -ENOMEM;
+	tb->name = name;
+	tb->size = size;
+	tb->back = 0;
+	tb->middle = 1;
+	tb->front = 2;
+	return 0;
+}
+/*****************************************************************************/
+int delete_rt_triple(RT_TRIPLE *tb)
+{
+	free(tb->buf);
+	tb->buf = NULL;
+	return 0;
+}
+/*****************************************************************************/
+void* get_rt_triple_back(RT_TRIPLE *tb)
+{
+	return tb->buf + tb->back * tb->stride;
+}
+/*****************************************************************************/
+void publish_rt_triple(RT_TRIPLE *tb)
+{
+	unsigned int old = __atomic_exchange_n(&tb->middle, tb->back | TRIPLE_FRESH, __ATOMIC_ACQ_REL);
+
+	tb->back = old & ~TRIPLE_FRESH;
+}
+/*****************************************************************************/
+void write_rt_triple(RT_TRIPLE *tb, const void *data)
+{
+	memcpy(get_rt_triple_back(tb), data, tb->size);
+	publish_rt_triple(tb);
+}
+/*****************************************************************************/
+const void* get_rt_triple_front(RT_TRIPLE *tb, FLAG *fresh)
+{
+	unsigned int old;
+
+	*fresh = off;
+	if (__atomic_load_n(&tb->middle, __ATOMIC_ACQUIRE) & TRIPLE_FRESH) {
+		old = __atomic_exchange_n(&tb->middle, tb->front, __ATOMIC_ACQ_REL);
+		tb->front = old & ~TRIPLE_FRESH;
+		*fresh = on;
+	}
+	return tb->buf + tb->front * tb->stride;
+}
+/*****************************************************************************/
+int read_rt_triple(RT_TRIPLE *tb, void *data)
+{
+	FLAG fresh;
+
+	memcpy(data, get_rt_triple_front(tb, &fresh), tb->size);
+	return fresh == on ? 1 : 0;
+}
+/*****************************************************************************/
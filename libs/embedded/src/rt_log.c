@@ -0,0 +1,391 @@
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <rt_log.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+/*****************************************************************************/
+typedef enum {
+	LOG_NONE = 0, // literal text up to the end
+	LOG_INT,
+	LOG_LONG,
+	LOG_LLONG,
+	LOG_SIZE,
+	LOG_INTMAX,
+	LOG_PTRDIFF,
+	LOG_DOUBLE,
+	LOG_LDOUBLE, // kept and printed as double
+	LOG_PTR // %s and %p
+}LOG_ARG;
+
+typedef struct {
+	const char *start; // '%'
+	const char *end; // after the conversion character
+	LOG_ARG type;
+	int stars;
+}LOG_SPEC;
+
+static RT_LOG_BUF *LogBufs = NULL;
+static int LogThreads = 0;
+static int LogAttached = 0;
+static unsigned int LogGen = 0; // bumped by init/stop, stale thread slots re-attach
+static uint64_t LogLost = 0; // messages of threads without a slot
+static uint64_t LogLostReported = 0;
+static pthread_mutex_t LogDrainLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t LogFlusher;
+static volatile FLAG bLogQuit = off;
+static unsigned int LogKick = 0; // futex word the flusher sleeps on
+static int LogIdle = 0; // set by the flusher before it drains and sleeps
+
+static __thread RT_LOG_BUF *LogSelf = NULL;
+static __thread unsigned int LogSelfGen = 0;
+
+static void *_rt_log_flusher(void *arg);
+static void _rt_log_kick(FLAG force);
+/*****************************************************************************/
+/* next conversion of fmt, LOG_NONE at the end of the string */
+static const char *_rt_log_spec(const char *p, LOG_SPEC *spec)
+{
+	int len = 0; // 1 h/hh, 2 l, 3 ll, 4 z, 5 j, 6 t, 7 L
+
+	spec->type = LOG_NONE;
+	spec->stars = 0;
+	for (;;) {
+		p = strchr(p, '%');
+		if (p == NULL)
+			return NULL;
+		if (p[1] != '%')
+			break;
+		p += 2;
+	}
+	spec->start = p++;
+	while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+		p++;
+	for (; *p != '\0' && ((*p >= '0' && *p <= '9') || *p == '.' || *p == '*'); ++p)
+		if (*p == '*')
+			spec->stars++;
+	for (; *p != '\0' && strchr("hlzjtLq", *p) != NULL; ++p) {
+		switch (*p) {
+			case 'h': len = 1; break;
+			case 'l': len = (len == 2) ? 3 : 2; break;
+			case 'q': len = 3; break;
+			case 'z': len = 4; break;
+			case 'j': len = 5; break;
+			case 't': len = 6; break;
+			case 'L': len = 7; break;
+		}
+	}
+	if (*p == '\0') {
+		spec->end = p;
+		return NULL;
+	}
+	switch (*p) {
+		case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+			spec->type = (LOG_ARG[]){LOG_INT, LOG_INT, LOG_LONG, LOG_LLONG,
+					LOG_SIZE, LOG_INTMAX, LOG_PTRDIFF, LOG_LLONG}[len];
+			break;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			spec->type = (len == 7) ? LOG_LDOUBLE : LOG_DOUBLE;
+			break;
+		case 's': case 'p':
+			spec->type = LOG_PTR;
+			break;
+		default: // %n and unknown conversions take no argument here
+			spec->type = LOG_NONE;
+			break;
+	}
+	spec->end = p + 1;
+	return spec->end;
+}
+/*****************************************************************************/
+static uint64_t _rt_log_double(double d)
+{
+	uint64_t raw;
+
+	memcpy(&raw, &d, sizeof(raw));
+	return raw;
+}
+/*****************************************************************************/
+static double _rt_log_to_double(uint64_t raw)
+{
+	double d;
+
+	memcpy(&d, &raw, sizeof(d));
+	return d;
+}
+/*****************************************************************************/
+int attach_rt_log(char *name)
+{
+	unsigned int gen = __atomic_load_n(&LogGen, __ATOMIC_ACQUIRE);
+	int slot;
+
+	LogSelf = NULL;
+	LogSelfGen = gen;
+	if (LogBufs == NULL)
+		return -ENODEV;
+	slot = __atomic_fetch_add(&LogAttached, 1, __ATOMIC_ACQ_REL);
+	if (slot >= LogThreads)
+		return -ENOMEM;
+	if (name != NULL)
+		snprintf(LogBufs[slot].name, sizeof(LogBufs[slot].name), "%s", name);
+	else
+		pthread_getname_np(pthread_self(), LogBufs[slot].name, sizeof(LogBufs[slot].name));
+	LogSelf = &LogBufs[slot];
+	return 0;
+}
+/*****************************************************************************/
+void rt_log(const char *fmt, ...)
+{
+	RT_LOG_MSG msg;
+	LOG_SPEC spec;
+	const char *p = fmt;
+	va_list ap;
+	int k;
+
+	if (LogBufs == NULL) {
+		va_start(ap, fmt);
+		vprintf(fmt, ap);
+		va_end(ap);
+		return;
+	}
+	if (LogSelfGen != __atomic_load_n(&LogGen, __ATOMIC_ACQUIRE))
+		attach_rt_log(NULL);
+	if (LogSelf == NULL) {
+		__atomic_fetch_add(&LogLost, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	msg.time = rt_timer_read();
+	msg.fmt = fmt;
+	msg.nargs = 0;
+	va_start(ap, fmt);
+	while (p != NULL && (p = _rt_log_spec(p, &spec)) != NULL && spec.type != LOG_NONE) {
+		if (msg.nargs + spec.stars + 1 > LOG_MAX_ARGS)
+			break;
+		for (k = 0; k < spec.stars; ++k)
+			msg.args[msg.nargs++] = (uint64_t)(int64_t)va_arg(ap, int);
+		switch (spec.type) {
+			case LOG_INT: msg.args[msg.nargs] = (uint64_t)(int64_t)va_arg(ap, int); break;
+			case LOG_LONG: msg.args[msg.nargs] = (uint64_t)va_arg(ap, long); break;
+			case LOG_LLONG: msg.args[msg.nargs] = (uint64_t)va_arg(ap, long long); break;
+			case LOG_SIZE: msg.args[msg.nargs] = (uint64_t)va_arg(ap, size_t); break;
+			case LOG_INTMAX: msg.args[msg.nargs] = (uint64_t)va_arg(ap, intmax_t); break;
+			case LOG_PTRDIFF: msg.args[msg.nargs] = (uint64_t)va_arg(ap, ptrdiff_t); break;
+			case LOG_DOUBLE: msg.args[msg.nargs] = _rt_log_double(va_arg(ap, double)); break;
+			case LOG_LDOUBLE: msg.args[msg.nargs] = _rt_log_double((double)va_arg(ap, long double)); break;
+			case LOG_PTR: msg.args[msg.nargs] = (uint64_t)(uintptr_t)va_arg(ap, void *); break;
+			default: break;
+		}
+		msg.nargs++;
+	}
+	va_end(ap);
+
+	if (push_rt_spsc(&LogSelf->ring, &msg) != 0)
+		LogSelf->dropped++;
+	_rt_log_kick(off);
+}
+/*****************************************************************************/
+/* text between conversions, "%%" unescaped */
+static int _rt_log_literal(char *line, int len, int size, const char *from, const char *to)
+{
+	for (; from < to && *from != '\0' && len < size - 1; ++from) {
+		if (from[0] == '%' && from[1] == '%')
+			++from;
+		line[len++] = *from;
+	}
+	line[len] = '\0';
+	return len;
+}
+/*****************************************************************************/
+/* formats one message, conversions past the captured arguments stay literal */
+static void _rt_log_format(RT_LOG_MSG *msg, char *line, int size)
+{
+	char spec_buf[64];
+	const char *p = msg->fmt, *lit = msg->fmt, *s;
+	LOG_SPEC spec;
+	int len = 0, n = 0, k, w, r;
+
+#define LOG_PUT(...) do { \
+		r = snprintf(line + len, size - len, __VA_ARGS__); \
+		if (r > 0) len = (len + r < size) ? len + r : size - 1; \
+	} while (0)
+
+	line[0] = '\0';
+	while (p != NULL && (p = _rt_log_spec(p, &spec)) != NULL && spec.type != LOG_NONE) {
+		if (n + spec.stars + 1 > msg->nargs)
+			break;
+		len = _rt_log_literal(line, len, size, lit, spec.start);
+		/* the '*' become the captured numbers, 'L' goes as the value is a double */
+		for (s = spec.start, w = 0; s < spec.end && w < (int)sizeof(spec_buf) - 24; ++s) {
+			if (*s == '*')
+				w += snprintf(spec_buf + w, sizeof(spec_buf) - w, "%d", (int)msg->args[n++]);
+			else if (*s != 'L')
+				spec_buf[w++] = *s;
+		}
+		spec_buf[w] = '\0';
+		k = n++;
+		switch (spec.type) {
+			case LOG_INT: LOG_PUT(spec_buf, (int)msg->args[k]); break;
+			case LOG_LONG: LOG_PUT(spec_buf, (long)msg->args[k]); break;
+			case LOG_LLONG: LOG_PUT(spec_buf, (long long)msg->args[k]); break;
+			case LOG_SIZE: LOG_PUT(spec_buf, (size_t)msg->args[k]); break;
+			case LOG_INTMAX: LOG_PUT(spec_buf, (intmax_t)msg->args[k]); break;
+			case LOG_PTRDIFF: LOG_PUT(spec_buf, (ptrdiff_t)msg->args[k]); break;
+			case LOG_DOUBLE:
+			case LOG_LDOUBLE: LOG_PUT(spec_buf, _rt_log_to_double(msg->args[k])); break;
+			case LOG_PTR: LOG_PUT(spec_buf, (void *)(uintptr_t)msg->args[k]); break;
+			default: break;
+		}
+		lit = spec.end;
+	}
+	_rt_log_literal(line, len, size, lit, lit + strlen(lit));
+#undef LOG_PUT
+}
+/*****************************************************************************/
+/* merges the rings in time order until all of them are empty */
+static void _rt_log_drain(void)
+{
+	char line[LOG_LINE];
+	RT_LOG_BUF *b, *first;
+	uint64_t lost, dropped;
+	int i, n;
+
+	pthread_mutex_lock(&LogDrainLock);
+	n = LogAttached < LogThreads ? LogAttached : LogThreads;
+	for (;;) {
+		first = NULL;
+		for (i = 0; i < n; ++i) {
+			b = &LogBufs[i];
+			if (b->pending == off && trypop_rt_spsc(&b->ring, &b->next) == 0)
+				b->pending = on;
+			if (b->pending == on && (first == NULL || b->next.time < first->next.time))
+				first = b;
+		}
+		if (first == NULL)
+			break;
+		_rt_log_format(&first->next, line, sizeof(line));
+		fputs(line, stdout);
+		first->pending = off;
+	}
+	for (i = 0; i < n; ++i) {
+		b = &LogBufs[i];
+		dropped = __atomic_load_n(&b->dropped, __ATOMIC_RELAXED);
+		if (dropped != b->reported) {
+			fprintf(stderr, "[rt_log] %lu messages of '%s' dropped\n",
+					(unsigned long)(dropped - b->reported), b->name);
+			b->reported = dropped;
+		}
+	}
+	lost = __atomic_load_n(&LogLost, __ATOMIC_RELAXED);
+	if (lost != LogLostReported) {
+		fprintf(stderr, "[rt_log] %lu messages of threads without a ring dropped\n",
+				(unsigned long)(lost - LogLostReported));
+		LogLostReported = lost;
+	}
+	fflush(stdout);
+	pthread_mutex_unlock(&LogDrainLock);
+}
+/*****************************************************************************/
+int init_rt_log(int threads, int depth)
+{
+	struct sched_param param = {0};
+	pthread_attr_t attr;
+	int i, ret;
+
+	if (LogBufs != NULL)
+		return -EBUSY;
+	if (threads < 1 || threads > LOG_MAX_THREADS)
+		threads = LOG_MAX_THREADS;
+	LogBufs = calloc(threads, sizeof(RT_LOG_BUF));
+	if (LogBufs == NULL)
+		return -ENOMEM;
+	for (i = 0; i < threads; ++i) {
+		ret = create_rt_spsc(&LogBufs[i].ring, "rt_log", sizeof(RT_LOG_MSG), depth > 0 ? depth : LOG_DEPTH);
+		if (ret != 0) {
+			while (--i >= 0)
+				delete_rt_spsc(&LogBufs[i].ring);
+			free(LogBufs);
+			LogBufs = NULL;
+			return ret;
+		}
+	}
+	LogThreads = threads;
+	LogAttached = 0;
+
+	/* the flusher never competes with the RT tasks */
+	bLogQuit = off;
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+	pthread_attr_setschedparam(&attr, &param);
+	ret = pthread_create(&LogFlusher, &attr, &_rt_log_flusher, NULL);
+	pthread_attr_destroy(&attr);
+	__atomic_add_fetch(&LogGen, 1, __ATOMIC_RELEASE);
+	if (ret != 0) {
+		bLogQuit = on; // no flusher to join
+		stop_rt_log();
+		return -ret;
+	}
+	return 0;
+}
+/*****************************************************************************/
+void flush_rt_log(void)
+{
+	if (LogBufs != NULL)
+		_rt_log_drain();
+}
+/*****************************************************************************/
+int stop_rt_log(void)
+{
+	RT_LOG_BUF *bufs = LogBufs;
+	int i;
+
+	if (bufs == NULL)
+		return 0;
+	if (bLogQuit == off) {
+		bLogQuit = on;
+		_rt_log_kick(on);
+		pthread_join(LogFlusher, NULL);
+	}
+	_rt_log_drain();
+
+	/* loggers still around see the new generation and print directly */
+	LogBufs = NULL;
+	__atomic_add_fetch(&LogGen, 1, __ATOMIC_RELEASE);
+	for (i = 0; i < LogThreads; ++i)
+		delete_rt_spsc(&bufs[i].ring);
+	free(bufs);
+	LogThreads = 0;
+	return 0;
+}
+/*****************************************************************************/
+/* only the first message after the flusher went idle pays the wake syscall */
+static void _rt_log_kick(FLAG force)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (force == off && (__atomic_load_n(&LogIdle, __ATOMIC_RELAXED) == 0 ||
+			__atomic_exchange_n(&LogIdle, 0, __ATOMIC_ACQ_REL) == 0))
+		return;
+	__atomic_add_fetch(&LogKick, 1, __ATOMIC_SEQ_CST);
+	syscall(SYS_futex, &LogKick, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+/*****************************************************************************/
+static void *_rt_log_flusher(void *arg)
+{
+	unsigned int kick;
+
+	pthread_setname_np(pthread_self(), "rt_log");
+	while (bLogQuit == off) {
+		/* idle is raised before the drain, a message it misses kicks the wait */
+		kick = __atomic_load_n(&LogKick, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&LogIdle, 1, __ATOMIC_SEQ_CST);
+		_rt_log_drain();
+		if (bLogQuit == off)
+			syscall(SYS_futex, &LogKick, FUTEX_WAIT_PRIVATE, kick, NULL, NULL, 0);
+	}
+	return NULL;
+}
+/*****************************************************************************/
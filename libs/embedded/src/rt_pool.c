@@ -0,0 +1,128 @@
+/*****************************************************************************/
+#include <rt_pool.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+/*****************************************************************************/
+static void _rt_pool_worker(void *cookie);
+static unsigned int _rt_pool_wait(unsigned int *word, unsigned int old, FLAG spin);
+static void _rt_pool_wake(unsigned int *word, int count, FLAG spin);
+/*****************************************************************************/
+int create_rt_pool(RT_POOL *pool, char *name, int nworkers, int prio, int first_cpu, FLAG spin)
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	RT_POOL_WORKER *w;
+	int i, ret;
+
+	if (nworkers < 1 || nworkers > RT_POOL_MAX)
+		return -EINVAL;
+	/* a spinning helper on the caller's cpu would never let it run */
+	if (spin == on && nworkers > ncpu)
+		return -EINVAL;
+
+	memset(pool, 0, sizeof(RT_POOL));
+	pool->name = name;
+	pool->nworkers = nworkers;
+	pool->spin = spin;
+
+	for (i = 1; i < nworkers; ++i) {
+		w = &pool->workers[i];
+		w->pool = pool;
+		w->idx = i;
+		snprintf(w->name, sizeof(w->name), "%.10s_w%d", name, i);
+		ret = create_rt_task_joinable(&w->task, w->name, prio);
+		if (ret == 0) {
+			ret = set_rt_task_affinity(&w->task, (first_cpu + i) % ncpu);
+			if (ret == 0)
+				ret = start_rt_task_arg(1, &w->task, &_rt_pool_worker, w);
+			else
+				discard_rt_task(&w->task);
+		}
+		if (ret != 0) {
+			delete_rt_pool(pool);
+			return ret;
+		}
+		pool->alive++;
+	}
+	return 0;
+}
+/*****************************************************************************/
+int fork_rt_pool(RT_POOL *pool, RT_POOL_FUN fun, void *arg)
+{
+	unsigned int left;
+
+	pool->fun = fun;
+	pool->arg = arg;
+	__atomic_store_n(&pool->pending, pool->nworkers - 1, __ATOMIC_RELAXED);
+
+	pool->t_fork = rt_timer_read();
+	__atomic_add_fetch(&pool->gen, 1, __ATOMIC_RELEASE);
+	_rt_pool_wake(&pool->gen, INT_MAX, pool->spin);
+
+	/* the caller takes share 0 */
+	pool->t_wake[0] = pool->t_fork;
+	fun(0, pool->nworkers, arg);
+	pool->t_done[0] = rt_timer_read();
+
+	while ((left = __atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE)) != 0)
+		_rt_pool_wait(&pool->pending, left, pool->spin);
+	pool->t_join = rt_timer_read();
+	return 0;
+}
+/*****************************************************************************/
+int delete_rt_pool(RT_POOL *pool)
+{
+	int i;
+
+	pool->quit = on;
+	__atomic_add_fetch(&pool->gen, 1, __ATOMIC_RELEASE);
+	_rt_pool_wake(&pool->gen, INT_MAX, pool->spin);
+
+	for (i = 1; i <= pool->alive; ++i)
+		join_rt_task(&pool->workers[i].task);
+	pool->alive = 0;
+	return 0;
+}
+/*****************************************************************************/
+static void _rt_pool_worker(void *cookie)
+{
+	RT_POOL_WORKER *w = cookie;
+	RT_POOL *pool = w->pool;
+	unsigned int seen = 0;
+
+	while (1) {
+		seen = _rt_pool_wait(&pool->gen, seen, pool->spin);
+		pool->t_wake[w->idx] = rt_timer_read();
+		if (pool->quit == on)
+			break;
+
+		pool->fun(w->idx, pool->nworkers, pool->arg);
+		pool->t_done[w->idx] = rt_timer_read();
+		if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL) == 0)
+			_rt_pool_wake(&pool->pending, 1, pool->spin);
+	}
+	/* joinable: return instead of delete_rt_task() */
+}
+/*****************************************************************************/
+/* waits until *word differs from old and returns the new value */
+static unsigned int _rt_pool_wait(unsigned int *word, unsigned int old, FLAG spin)
+{
+	unsigned int cur;
+
+	while ((cur = __atomic_load_n(word, __ATOMIC_ACQUIRE)) == old) {
+		if (spin == on)
+			cpu_relax();
+		else
+			syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, old, NULL, NULL, 0);
+	}
+	return cur;
+}
+/*****************************************************************************/
+static void _rt_pool_wake(unsigned int *word, int count, FLAG spin)
+{
+	if (spin == off)
+		syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+/*****************************************************************************/
@@ -6,16 +6,43 @@
 /*****************************************************************************/
 int pt_mutex_acquire(PT_MUTEX *mutex)
 {
-	 return pthread_mutex_lock(&mutex->lock);
-
+	return PtBackend->mutex_lock(mutex);
+}
+/*****************************************************************************/
+int pt_mutex_try_acquire(PT_MUTEX *mutex)
+{
+	return PtBackend->mutex_trylock(mutex);
 }
 /*****************************************************************************/
 int pt_mutex_create(PT_MUTEX *mutex, char* name)
+{
+	mutex->name = name;
+	mutex->sim = NULL;
+	return PtBackend->mutex_init(mutex, PTHREAD_PROCESS_PRIVATE);
+}
+/*****************************************************************************/
+/* mutex must be in a MAP_SHARED mapping, the sim backend has none */
+int pt_mutex_create_shared(PT_MUTEX *mutex, char* name)
+{
+	mutex->name = name;
+	mutex->sim = NULL;
+	return PtBackend->mutex_init(mutex, PTHREAD_PROCESS_SHARED);
+}
+/*****************************************************************************/
+int pt_mutex_delete(PT_MUTEX *mutex)
+{
+	return PtBackend->mutex_destroy(mutex);
+}
+/*****************************************************************************/
+int pt_mutex_release(PT_MUTEX *mutex)
+{
+	return PtBackend->mutex_unlock(mutex);
+}
+/*****************************************************************************/
+int pt_posix_mutex_init(PT_MUTEX *mutex, int pshared)
 {
 	pthread_mutexattr_t mtx_attr;
 	int ret = 0;
-	
-	mutex->name = name;
 
 	ret = pthread_mutexattr_init(&mtx_attr);
 	if (ret != 0)
@@ -24,13 +51,22 @@ int pt_mutex_create(PT_MUTEX *mutex, char* name)
 		return ret;
 	}
 
-	ret = pthread_mutexattr_setprotocol(&mtx_attr,PTHREAD_PRIO_INHERIT);
+	/* priority inheritance unless the backend is the plain baseline */
+	ret = pthread_mutexattr_setprotocol(&mtx_attr,PtBackend->mutex_protocol);
 	if (ret != 0)
 	{
 		fprintf(stderr,"cannot set mutex prioirity inheritance\n");
 		return ret;
 	}
 
+	/* the mutex lives in memory mapped by every process that takes it */
+	ret = pthread_mutexattr_setpshared(&mtx_attr,pshared);
+	if (ret != 0)
+	{
+		fprintf(stderr,"cannot set mutex process-shared\n");
+		return ret;
+	}
+
 	ret = pthread_mutex_init(&mutex->lock,&mtx_attr);
 	if (ret != 0)
 	{
@@ -46,16 +82,23 @@ int pt_mutex_create(PT_MUTEX *mutex, char* name)
 	}
 	return 0;
 }
+int pt_posix_mutex_lock(PT_MUTEX *mutex)
+{
+	return pthread_mutex_lock(&mutex->lock);
+}
 /*****************************************************************************/
-int pt_mutex_delete(PT_MUTEX *mutex)
+int pt_posix_mutex_trylock(PT_MUTEX *mutex)
 {
-	return pthread_mutex_destroy(&mutex->lock);
-
+	return -pthread_mutex_trylock(&mutex->lock);
 }
 /*****************************************************************************/
-int pt_mutex_release(PT_MUTEX *mutex)
+int pt_posix_mutex_unlock(PT_MUTEX *mutex)
 {
 	return pthread_mutex_unlock(&mutex->lock);
-
 }
-/*****************************************************************************/
\ No newline at end of file
+/*****************************************************************************/
+int pt_posix_mutex_destroy(PT_MUTEX *mutex)
+{
+	return pthread_mutex_destroy(&mutex->lock);
+}
+/*****************************************************************************/
@@ -0,0 +1,105 @@
+#include <rt_posix_queue.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*****************************************************************************/
+int pt_queue_create(PT_QUEUE *queue, char* name, size_t msgsize, int depth)
+{
+	pthread_mutexattr_t mtx_attr;
+	int ret = 0;
+
+	memset(queue, 0, sizeof(PT_QUEUE));
+	queue->name = name;
+	queue->msgsize = msgsize;
+	queue->depth = depth;
+
+	/* allocate up front, reads and writes never touch the heap */
+	queue->buf = calloc(depth, msgsize);
+	queue->len = calloc(depth, sizeof(size_t));
+	if (queue->buf == NULL || queue->len == NULL)
+	{
+		fprintf(stderr,"cannot allocate queue %s\n", name);
+		free(queue->buf);
+		free(queue->len);
+		return -ENOMEM;
+	}
+
+	ret = pthread_mutexattr_init(&mtx_attr);
+	if (ret != 0)
+	{
+		fprintf(stderr,"cannot init queue mutex attribute\n");
+		return ret;
+	}
+
+	ret = pthread_mutexattr_setprotocol(&mtx_attr,PTHREAD_PRIO_INHERIT);
+	if (ret != 0)
+	{
+		fprintf(stderr,"cannot set queue mutex prioirity inheritance\n");
+		return ret;
+	}
+
+	ret = pthread_mutex_init(&queue->lock,&mtx_attr);
+	pthread_mutexattr_destroy(&mtx_attr);
+	if (ret != 0)
+	{
+		fprintf(stderr,"cannot init queue mutex\n");
+		return ret;
+	}
+
+	ret = pthread_cond_init(&queue->cond, NULL);
+	if (ret != 0)
+	{
+		fprintf(stderr,"cannot init queue condition\n");
+		return ret;
+	}
+	return 0;
+}
+/*****************************************************************************/
+int pt_queue_delete(PT_QUEUE *queue)
+{
+	pthread_cond_destroy(&queue->cond);
+	free(queue->buf);
+	free(queue->len);
+	return pthread_mutex_destroy(&queue->lock);
+}
+/*****************************************************************************/
+int pt_queue_write(PT_QUEUE *queue, const void *buf, size_t size)
+{
+	int slot;
+
+	if (size > queue->msgsize)
+		return -EINVAL;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count == queue->depth)
+	{
+		pthread_mutex_unlock(&queue->lock);
+		return -ENOMEM;
+	}
+	slot = (queue->head + queue->count) % queue->depth;
+	memcpy(queue->buf + slot * queue->msgsize, buf, size);
+	queue->len[slot] = size;
+	queue->count++;
+	pthread_cond_signal(&queue->cond);
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+/*****************************************************************************/
+ssize_t pt_queue_read(PT_QUEUE *queue, void *buf, size_t size)
+{
+	size_t len;
+
+	pthread_mutex_lock(&queue->lock);
+	while (queue->count == 0)
+		pthread_cond_wait(&queue->cond, &queue->lock);
+
+	len = queue->len[queue->head];
+	if (len > size)
+		len = size;
+	memcpy(buf, queue->buf + queue->head * queue->msgsize, len);
+	queue->head = (queue->head + 1) % queue->depth;
+	queue->count--;
+	pthread_mutex_unlock(&queue->lock);
+	return len;
+}
+/*****************************************************************************/
@@ -9,6 +9,83 @@
 */
 /****************************************************************************/
 #include <rt_posix_task.h>
+#include <rt_posix_mutex.h>
+#include <rt_sim.h>
+#include <string.h>
+#include <semaphore.h>
+#include <sys/syscall.h>
+/****************************************************************************/
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+/* struct sched_attr of sched_setattr(2), glibc has no wrapper */
+typedef struct{
+	uint32_t size;
+	uint32_t policy;
+	uint64_t flags;
+	int32_t nice;
+	uint32_t priority;
+	uint64_t runtime;
+	uint64_t deadline;
+	uint64_t period;
+}PT_SCHED_ATTR;
+
+/* start of a task inside the new thread, on the stack of pt_task_start()
+ * until started is posted */
+typedef struct{
+	void (*entry)(void *arg);
+	void* arg;
+	char* name;
+	char* s_mode;
+	PT_BACKEND* backend; // NULL: not an RT task
+	int prio;
+	PRTIME runtime;
+	PRTIME period;
+	sem_t started;
+	int err;
+}PT_ENTRY;
+/****************************************************************************/
+static int _pt_create_fifo(PT_TASK* task, int prio);
+static int _pt_create_rr(PT_TASK* task, int prio);
+static int _pt_create_other(PT_TASK* task, int prio);
+static int _pt_set_cpus(PT_TASK* task, cpu_set_t *cpus);
+static int _pt_dl_set_cpus(PT_TASK* task, cpu_set_t *cpus);
+static int _pt_dl_enter(char* name, int prio, PRTIME runtime, PRTIME period);
+static int _pt_set_periodic(PT_TASK* task, PRTIME idate, PRTIME period);
+static void _pt_wait_period(PT_TASK *task);
+static int _pt_sleep_until(PRTIME date);
+static PRTIME _pt_read(void);
+static void _pt_spin(PRTIME spintime);
+static void _pt_sim_wait_period(PT_TASK *task);
+/****************************************************************************/
+clockid_t PtClock = CLOCK_MONOTONIC;
+
+/* the clock, periods and mutexes of the kernel backends */
+#define PT_POSIX_OPS \
+	.set_periodic = _pt_set_periodic, .wait_period = _pt_wait_period, \
+	.sleep_until = _pt_sleep_until, .read = _pt_read, .spin = _pt_spin, \
+	.mutex_init = pt_posix_mutex_init, .mutex_lock = pt_posix_mutex_lock, \
+	.mutex_trylock = pt_posix_mutex_trylock, .mutex_unlock = pt_posix_mutex_unlock, .mutex_destroy = pt_posix_mutex_destroy
+
+PT_BACKEND PtBackends[] = {
+	{"fifo", "SCHED_FIFO fixed priorities, PI mutexes", SCHED_FIFO, PTHREAD_PRIO_INHERIT,
+		_pt_create_fifo, _pt_set_cpus, NULL, NULL, PT_POSIX_OPS, .simulated = off},
+	{"rr", "SCHED_RR fixed priorities with time slices, PI mutexes", SCHED_RR, PTHREAD_PRIO_INHERIT,
+		_pt_create_rr, _pt_set_cpus, NULL, NULL, PT_POSIX_OPS, .simulated = off},
+	{"deadline", "SCHED_DEADLINE reservations (EDF), priorities ignored, PI mutexes", SCHED_DEADLINE, PTHREAD_PRIO_INHERIT,
+		_pt_create_other, _pt_dl_set_cpus, _pt_dl_enter, NULL, PT_POSIX_OPS, .simulated = off},
+	{"other", "SCHED_OTHER baseline, priorities ignored, plain mutexes", SCHED_OTHER, PTHREAD_PRIO_NONE,
+		_pt_create_other, _pt_set_cpus, NULL, NULL, PT_POSIX_OPS, .simulated = off},
+	{"sim", "simulated cpu and virtual clock, fixed priorities, PI mutexes (rt_sim.h)", SCHED_FIFO, PTHREAD_PRIO_INHERIT,
+		pt_sim_create, _pt_set_cpus, pt_sim_enter, pt_sim_dispatch, .discard = pt_sim_discard,
+		.set_periodic = _pt_set_periodic, .wait_period = _pt_sim_wait_period,
+		.sleep_until = pt_sim_sleep_until, .read = pt_sim_read, .spin = pt_sim_spin,
+		.mutex_init = pt_sim_mutex_init, .mutex_lock = pt_sim_mutex_lock, .mutex_trylock = pt_sim_mutex_trylock,
+		.mutex_unlock = pt_sim_mutex_unlock, .mutex_destroy = pt_sim_mutex_destroy, .simulated = on},
+	{NULL}
+};
+PT_BACKEND *PtBackend = &PtBackends[0];
 /****************************************************************************/
 struct timespec NS2TIMESPEC(uint64_t nanosecs);
 char* _mode_name(PT_MODE mode);
@@ -18,7 +95,10 @@ int pt_task_create(PT_TASK* task, char* name, int stksize, int prio, PT_MODE mod
 	task->name = name;
 	task->mode = mode;
 	task->s_mode = _mode_name(task->mode);
-	cpu_set_t cpus;
+	task->period = 0;
+	task->prio = 0;
+	task->runtime = 0;
+	task->dl_period = 0;
 
 	int err = pthread_attr_init(&task->thread_attributes);
 	if (err)
@@ -27,16 +107,6 @@ int pt_task_create(PT_TASK* task, char* name, int stksize, int prio, PT_MODE mod
 		return -EATTR;
 	}
 
-	if(mode == RT)
-	{
-		err = pthread_attr_setinheritsched(&task->thread_attributes, PTHREAD_EXPLICIT_SCHED);
-		if (err)
-		{
-			TASK_DBG(task->s_mode,"set explicit sched failed for %s with err=%d\n", task->name, err);
-			return -EINHRTSCHD;
-		}
-	}
-
 	err = pthread_attr_setdetachstate(&task->thread_attributes, PTHREAD_CREATE_DETACHED /*PTHREAD_CREATE_JOINABLE*/);
 	if (err)
 	{
@@ -46,28 +116,16 @@ int pt_task_create(PT_TASK* task, char* name, int stksize, int prio, PT_MODE mod
 	
 	if(mode == RT)
 	{
-		err = pthread_attr_setschedpolicy(&task->thread_attributes, SCHED_FIFO);
+		err = PtBackend->create(task, prio);
 		if (err)
-		{
-			TASK_DBG(task->s_mode,"set scheduling policy failed for thread '%s' with err=%d\n", task->name, err);
-			return -ESCHEDPOL;
-		}
-		struct sched_param paramA = { .sched_priority = prio};
-		err = pthread_attr_setschedparam(&task->thread_attributes, &paramA);
-		if (err)
-		{
-			TASK_DBG(task->s_mode,"set priority failed for thread '%s' with err=%d\n", task->name, err);
-			return -ESETPRIO;
-		}
+			return err;
 		task->prio = prio;
 
-		CPU_ZERO(&cpus);
-		CPU_SET(0, &cpus);
-		err = pthread_attr_setaffinity_np(&task->thread_attributes, sizeof(cpu_set_t), &cpus);
+		err = pt_task_set_affinity(task, 0);
 		if (err)
 		{
-			TASK_DBG(task->s_mode,"set cpu affinity failed for thread '%s' with err=%d\n", task->name, err);
-			return -ESETPRIO;
+			pt_task_discard(task);
+			return err;
 		}
 	}
 
@@ -80,6 +138,7 @@ int pt_task_create(PT_TASK* task, char* name, int stksize, int prio, PT_MODE mod
 	if (err)
 	{
 		TASK_DBG(task->s_mode,"set stack size failed for thread '%s' with err=%d\n", task->name, err);
+		pt_task_discard(task);
 		return -ESETSTKSZ;
 	}
 
@@ -88,21 +147,21 @@ int pt_task_create(PT_TASK* task, char* name, int stksize, int prio, PT_MODE mod
 }
 /*****************************************************************************/
 int pt_task_set_periodic(PT_TASK* task,PRTIME idate, PRTIME period)
+{
+	return PtBackend->set_periodic(task, idate, period);
+}
+/*****************************************************************************/
+static int _pt_set_periodic(PT_TASK* task, PRTIME idate, PRTIME period)
 {
 	
 	/* calc start time of the periodic thread */
 	struct timespec start_time;
 	if (idate == TMR_NOW){
-		if (clock_gettime(CLOCK_TO_USE, &start_time))
-		{
-			TASK_DBG(task->s_mode,"Failed to call clock_gettime\n" );
-			return -ECLKGETTM;
-		}
+		/* Start one second later from now. */
+		start_time = NS2TIMESPEC(pt_timer_read());
+		start_time.tv_sec += START_DELAY_SECS;
 	} else
-		start_time = NS2TIMESPEC(idate);
-
-	/* Start one second later from now. */
-	start_time.tv_sec += START_DELAY_SECS;
+		start_time = NS2TIMESPEC(idate); // absolute first release
 	
 	task->deadline = start_time;
 	task->period = period;
@@ -110,24 +169,117 @@ int pt_task_set_periodic(PT_TASK* task,PRTIME idate, PRTIME period)
 	return 0;
 }
 /*****************************************************************************/
+int pt_task_set_affinity(PT_TASK* task, int cpu)
+{
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	return pt_task_set_cpus(task, &cpus);
+}
+/*****************************************************************************/
+int pt_task_set_cpus(PT_TASK* task, cpu_set_t *cpus)
+{
+	if (task->mode == RT)
+		return PtBackend->set_cpus(task, cpus);
+	return _pt_set_cpus(task, cpus);
+}
+/*****************************************************************************/
+int pt_task_set_budget(PT_TASK* task, PRTIME runtime, PRTIME period)
+{
+	task->runtime = runtime;
+	task->dl_period = period;
+	return 0;
+}
+/*****************************************************************************/
+static int _pt_set_cpus(PT_TASK* task, cpu_set_t *cpus)
+{
+	int cpu, err;
+
+	err = pthread_attr_setaffinity_np(&task->thread_attributes, sizeof(cpu_set_t), cpus);
+	if (err)
+	{
+		TASK_DBG(task->s_mode,"set cpu affinity failed for thread '%s' with err=%d\n", task->name, err);
+		return -ESETCPU;
+	}
+	/* the single cpu of a pinned task, -1 when the kernel may migrate it */
+	task->cpu = -1;
+	if (CPU_COUNT(cpus) == 1)
+		for (cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+			if (CPU_ISSET(cpu, cpus))
+				task->cpu = cpu;
+	return 0;
+}
+/*****************************************************************************/
+/* the name and the backend's part inside the new thread, then the task
+ * body. A detached thread may be gone before its creator could name it. */
+static void* _pt_task_entry(void *cookie)
+{
+	PT_ENTRY *start = cookie;
+	void (*entry)(void *arg) = start->entry;
+	void* arg = start->arg;
+	PT_BACKEND* backend = start->backend;
+	char name[16]; // limit of the kernel, with the terminator
+	int err = 0;
+
+	snprintf(name, sizeof(name), "%s", start->name);
+	if (pthread_setname_np(pthread_self(), name) != 0)
+		TASK_DBG(start->s_mode,"set name failed for thread '%s'\n", start->name);
+	if (backend != NULL && backend->enter != NULL)
+	{
+		err = backend->enter(start->name, start->prio, start->runtime, start->period);
+		if (err)
+			TASK_DBG(backend->name,"'%s' not admitted with err=%d", start->name, -err);
+	}
+	/* start is gone once posted */
+	start->err = err;
+	sem_post(&start->started);
+	if (err)
+		return NULL;
+	if (backend != NULL && backend->dispatch != NULL)
+		backend->dispatch();
+	entry(arg);
+	return NULL;
+}
+/*****************************************************************************/
 int pt_task_start(PT_TASK* task,void (*entry)(void *arg), void * arg)
 {
-	int err;
+	PT_ENTRY start;
+	int err, detach;
 
-	err = pthread_create(&task->thread, &task->thread_attributes, (void *) entry, arg);
+	start.entry = entry;
+	start.arg = arg;
+	start.name = task->name;
+	start.s_mode = task->s_mode;
+	start.backend = (task->mode == RT) ? PtBackend : NULL;
+	start.prio = task->prio;
+	start.runtime = task->runtime;
+	start.period = task->dl_period ? task->dl_period : task->period;
+	start.err = 0;
+	if (sem_init(&start.started, 0, 0) != 0)
+		return -EPTHCREATE;
+	err = pthread_create(&task->thread, &task->thread_attributes, _pt_task_entry, &start);
 	if (err)
 	{
+		sem_destroy(&start.started);
+		pt_task_discard(task);
 		TASK_DBG(task->s_mode,"Failed to create thread '%s' with err=%d !!!!!\n", task->name, err);
 		return -EPTHCREATE;
 	}
 	else
 	{
+		/* the backend refused the thread, it ends without the body */
+		while (sem_wait(&start.started) != 0 && errno == EINTR)
+			;
+		sem_destroy(&start.started);
+		pthread_attr_getdetachstate(&task->thread_attributes, &detach);
 		pthread_attr_destroy(&task->thread_attributes);
-		err = pthread_setname_np(task->thread, task->name);
-		if (err)
+		if (start.err)
 		{
-			TASK_DBG(task->s_mode,"set name failed for thread '%s', err=%d\n", task->name, err);
-			return -EPTHNAME;
+			if (detach == PTHREAD_CREATE_JOINABLE)
+				pthread_join(task->thread, NULL);
+			TASK_DBG(task->s_mode,"'%s' not started by the %s backend, err=%d\n", task->name, PtBackend->name, -start.err);
+			return -EENTER;
 		}
 		TASK_DBG(task->s_mode,"Created thread '%s' period=%lu ns ok.\n", task->name, task->period);
 	}
@@ -136,16 +288,14 @@ int pt_task_start(PT_TASK* task,void (*entry)(void *arg), void * arg)
 /*****************************************************************************/
 void pt_task_wait_period(PT_TASK *task)
 {
-	int err = 0;
+	PtBackend->wait_period(task);
+}
+/*****************************************************************************/
+/* the release after the one slept until, an overrun when it is past */
+static void _pt_next_period(PT_TASK *task)
+{
 	struct timespec now;
-	
 
-	err =clock_nanosleep(CLOCK_TO_USE,TIMER_ABSTIME,&task->deadline,NULL);
-	if ( err>0 )
-	{
-		TASK_DBG(task->name,"Timer wait period failed with errno=%d\n", errno);
-	}
-	
 	task->deadline.tv_nsec += task->period;
 	task->deadline.tv_sec += task->deadline.tv_nsec / NANOSEC_PER_SEC;
 	task->deadline.tv_nsec %= NANOSEC_PER_SEC;
@@ -159,7 +309,47 @@ void pt_task_wait_period(PT_TASK *task)
 
 }
 /*****************************************************************************/
-PRTIME pt_timer_read(void){
+static void _pt_wait_period(PT_TASK *task)
+{
+	int err = 0;
+
+	err =clock_nanosleep(CLOCK_TO_USE,TIMER_ABSTIME,&task->deadline,NULL);
+	if ( err>0 )
+	{
+		TASK_DBG(task->name,"Timer wait period failed with errno=%d\n", errno);
+	}
+	_pt_next_period(task);
+}
+/*****************************************************************************/
+static void _pt_sim_wait_period(PT_TASK *task)
+{
+	pt_sim_sleep_until(TIMESPEC2NS(task->deadline));
+	_pt_next_period(task);
+}
+/*****************************************************************************/
+int pt_task_sleep_until(PRTIME date)
+{
+	return PtBackend->sleep_until(date);
+}
+/*****************************************************************************/
+static int _pt_sleep_until(PRTIME date)
+{
+	struct timespec wakeup = NS2TIMESPEC(date);
+	int err;
+
+	do {
+		err = clock_nanosleep(CLOCK_TO_USE, TIMER_ABSTIME, &wakeup, NULL);
+	} while (err == EINTR);
+	return -err;
+}
+/*****************************************************************************/
+PRTIME pt_timer_read(void)
+{
+	return PtBackend->read();
+}
+/*****************************************************************************/
+static PRTIME _pt_read(void)
+{
 	struct timespec probe;
 	PRTIME ret;
 	if (clock_gettime(CLOCK_TO_USE,&probe))
@@ -174,6 +364,11 @@ PRTIME pt_timer_read(void){
 }
 /*****************************************************************************/
 void pt_timer_spin(PRTIME spintime)
+{
+	PtBackend->spin(spintime);
+}
+/*****************************************************************************/
+static void _pt_spin(PRTIME spintime)
 {
 	PRTIME end;
 	end = pt_timer_read() + spintime;
@@ -181,6 +376,28 @@ void pt_timer_spin(PRTIME spintime)
 		cpu_relax();
 }
 /*****************************************************************************/
+int pt_timer_set_clock(clockid_t clock)
+{
+	struct timespec probe = {0, 0};
+	int err;
+
+	if (clock_gettime(clock, &probe))
+		return -ECLKGETTM;
+	/* a date in the past returns at once if the clock can be slept on */
+	probe.tv_sec = 0;
+	err = clock_nanosleep(clock, TIMER_ABSTIME, &probe, NULL);
+	if (err)
+		return -err;
+
+	PtClock = clock;
+	return 0;
+}
+/*****************************************************************************/
+clockid_t pt_timer_get_clock(void)
+{
+	return PtClock;
+}
+/*****************************************************************************/
 struct timespec NS2TIMESPEC(uint64_t nanosecs)
 {
 	struct timespec ret; 
@@ -192,6 +409,39 @@ struct timespec NS2TIMESPEC(uint64_t nanosecs)
 PRTIME pt_timer_ns2ticks(PRTIME ticks)
 {
 
+}
+/*****************************************************************************/
+int pt_task_discard(PT_TASK* task)
+{
+	if (task->mode == RT && PtBackend->discard != NULL)
+		PtBackend->discard(task);
+	return pthread_attr_destroy(&task->thread_attributes);
+}
+/*****************************************************************************/
+int pt_task_set_joinable(PT_TASK* task)
+{
+	int err;
+
+	err = pthread_attr_setdetachstate(&task->thread_attributes, PTHREAD_CREATE_JOINABLE);
+	if (err)
+	{
+		TASK_DBG(task->s_mode,"set detach state failed for thread %s with err=%d\n", task->name, err);
+		return -EDTCHSTAT;
+	}
+	return 0;
+}
+/*****************************************************************************/
+int pt_task_join(PT_TASK* task)
+{
+	int err;
+
+	err = pthread_join(task->thread, NULL);
+	if (err)
+	{
+		TASK_DBG(task->s_mode,"join failed for thread '%s' with err=%d\n", task->name, err);
+		return -EJOIN;
+	}
+	return 0;
 }
 /*****************************************************************************/
 void pt_task_delete(void)
@@ -215,3 +465,92 @@ char* _mode_name(PT_MODE mode)
 	}
 }
 /*****************************************************************************/
+/*****************************************************************************/
+int pt_backend_set(char* name)
+{
+	int i;
+
+	for (i = 0; PtBackends[i].name != NULL; ++i)
+		if (strcmp(PtBackends[i].name, name) == 0)
+		{
+			PtBackend = &PtBackends[i];
+			return 0;
+		}
+	return -EBACKEND;
+}
+/*****************************************************************************/
+static int _pt_set_policy(PT_TASK* task, int policy, int prio)
+{
+	struct sched_param param = { .sched_priority = prio};
+	int err;
+
+	err = pthread_attr_setinheritsched(&task->thread_attributes, PTHREAD_EXPLICIT_SCHED);
+	if (err)
+	{
+		TASK_DBG(task->s_mode,"set explicit sched failed for %s with err=%d\n", task->name, err);
+		return -EINHRTSCHD;
+	}
+	err = pthread_attr_setschedpolicy(&task->thread_attributes, policy);
+	if (err)
+	{
+		TASK_DBG(task->s_mode,"set scheduling policy failed for thread '%s' with err=%d\n", task->name, err);
+		return -ESCHEDPOL;
+	}
+	err = pthread_attr_setschedparam(&task->thread_attributes, &param);
+	if (err)
+	{
+		TASK_DBG(task->s_mode,"set priority failed for thread '%s' with err=%d\n", task->name, err);
+		return -ESETPRIO;
+	}
+	return 0;
+}
+/*****************************************************************************/
+static int _pt_create_fifo(PT_TASK* task, int prio)
+{
+	return _pt_set_policy(task, SCHED_FIFO, prio);
+}
+/*****************************************************************************/
+static int _pt_create_rr(PT_TASK* task, int prio)
+{
+	return _pt_set_policy(task, SCHED_RR, prio);
+}
+/*****************************************************************************/
+/* deadline tasks start like this too and switch in _pt_dl_enter() */
+static int _pt_create_other(PT_TASK* task, int prio)
+{
+	return _pt_set_policy(task, SCHED_OTHER, 0);
+}
+/*****************************************************************************/
+/* the affinity of a deadline task has to span its root domain, so every
+ * online cpu and the kernel places it */
+static int _pt_dl_set_cpus(PT_TASK* task, cpu_set_t *cpus)
+{
+	cpu_set_t all;
+	long cpu, ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	CPU_ZERO(&all);
+	for (cpu = 0; cpu < ncpu && cpu < CPU_SETSIZE; ++cpu)
+		CPU_SET(cpu, &all);
+	return _pt_set_cpus(task, &all);
+}
+/*****************************************************************************/
+static int _pt_dl_enter(char* name, int prio, PRTIME runtime, PRTIME period)
+{
+	PT_SCHED_ATTR attr;
+
+	if (period == 0)
+		period = PT_DL_PERIOD;
+	if (runtime == 0 || runtime > period)
+		runtime = period * PT_DL_SHARE / 100;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.policy = SCHED_DEADLINE;
+	attr.runtime = runtime;
+	attr.deadline = period;
+	attr.period = period;
+	if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0)
+		return -errno;
+	return 0;
+}
+/*****************************************************************************/
@@ -0,0 +1,91 @@
+/*****************************************************************************/
+#include <rt_probe.h>
+#include <rt_hist.h>
+#include <string.h>
+#include <unistd.h>
+/*****************************************************************************/
+#define PROBE_LOOP (1000) // reads per averaging loop
+#define PROBE_POLL_US (1000)
+
+static RT_HIST ProbeHist;
+static void _rt_probe_task(void *arg);
+/*****************************************************************************/
+int calibrate_rt_probe(RT_PROBE_CAL *cal, int cpu, int samples)
+{
+	RT_TASK task;
+	int ret;
+
+	memset(cal, 0, sizeof(RT_PROBE_CAL));
+	cal->cpu = cpu;
+	cal->samples = samples;
+
+	ret = create_rt_task(&task, "probe_cal", PROBE_PRIO);
+	if (ret == 0)
+		ret = set_rt_task_affinity(&task, cpu);
+	if (ret == 0)
+		ret = start_rt_task_arg(1, &task, &_rt_probe_task, cal);
+	if (ret != 0)
+		return ret;
+
+	while (!cal->done)
+		usleep(PROBE_POLL_US);
+	return 0;
+}
+/*****************************************************************************/
+int format_rt_probe_cal(char *buf, size_t size, RT_PROBE_CAL *cal)
+{
+	return snprintf(buf, size,
+			"# probe_cpu: %d\n"
+			"# probe_samples: %d\n"
+			"# probe_read_avg_ns: %.1f\n"
+			"# probe_delta_ns: min %lu p50 %lu p99 %lu max %lu\n"
+			"# probe_resolution_ns: %lu (%lu zero deltas)\n"
+			"# probe_bias_ns: %lu\n",
+			cal->cpu, cal->samples, cal->read_avg,
+			(unsigned long)cal->delta_min, (unsigned long)cal->delta_p50,
+			(unsigned long)cal->delta_p99, (unsigned long)cal->delta_max,
+			(unsigned long)cal->resolution, (unsigned long)cal->zero_deltas,
+			(unsigned long)cal->bias);
+}
+/*****************************************************************************/
+static void _rt_probe_task(void *arg)
+{
+	RT_PROBE_CAL *cal = arg;
+	RTIME t0, t1;
+	int i, k;
+
+	init_rt_hist(&ProbeHist, "probe");
+	cal->resolution = UINT64_MAX;
+
+	/* warm up caches and the vDSO page */
+	for (i = 0; i < PROBE_LOOP; ++i)
+		rt_timer_read();
+
+	for (i = 0; i < cal->samples; ++i) {
+		t0 = rt_timer_read();
+		t1 = rt_timer_read();
+		add_rt_hist(&ProbeHist, t1 - t0);
+		if (t1 == t0)
+			cal->zero_deltas++;
+		else if (t1 - t0 < cal->resolution)
+			cal->resolution = t1 - t0;
+	}
+
+	t0 = rt_timer_read();
+	for (k = 0; k < PROBE_LOOP; ++k)
+		rt_timer_read();
+	t1 = rt_timer_read();
+	cal->read_avg = (double)(t1 - t0) / (PROBE_LOOP + 1);
+
+	cal->delta_min = ProbeHist.min;
+	cal->delta_p50 = get_rt_hist_percentile(&ProbeHist, 50);
+	cal->delta_p99 = get_rt_hist_percentile(&ProbeHist, 99);
+	cal->delta_max = ProbeHist.max;
+	if (cal->resolution == UINT64_MAX)
+		cal->resolution = 0;
+	cal->bias = cal->delta_p50;
+
+	cal->done = 1;
+	delete_rt_task();
+}
+/*****************************************************************************/
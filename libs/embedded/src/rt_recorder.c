@@ -0,0 +1,353 @@
+/*****************************************************************************/
+#include <rt_recorder.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+/*****************************************************************************/
+#define REC_CLOSED_DEPTH (16) // closed windows waiting for the writer
+
+static char *RecReasonNames[] = {"none", "jitter", "response", "deadline"};
+
+static void _rt_window_reset(RT_WINDOW *win, RTIME now);
+static void _rt_window_summary(RT_WINDOW *win, int task, RTIME t_end, RT_WINDOW_SUMMARY *sum);
+static void _rt_window_add(RT_RECORDER *rec, int task, RTIME now, int32_t prd, int32_t resp, int32_t jtr, FLAG miss, FLAG trig);
+static void _rt_recorder_trigger(RT_RECORDER *rec, uint64_t seq);
+static void _rt_recorder_flush(RT_RECORDER *rec, FLAG final);
+static void _rt_recorder_capture(RT_RECORDER *rec, uint64_t trig, uint64_t end);
+static void _rt_recorder_write_summary(RT_RECORDER *rec, RT_WINDOW_SUMMARY *sum);
+static void *_rt_recorder_writer(void *arg);
+static void _rt_recorder_kick(RT_RECORDER *rec, FLAG force);
+/*****************************************************************************/
+int create_rt_recorder(RT_RECORDER *rec, int depth, int pre, int post, RTIME window)
+{
+	unsigned int size = 1;
+
+	/* the ring has to outlive the writer's reaction time comfortably */
+	if (depth < 2 * (pre + post + REC_MAX_TASKS))
+		depth = 2 * (pre + post + REC_MAX_TASKS);
+	while (size < (unsigned int)depth)
+		size <<= 1;
+
+	memset(rec, 0, sizeof(RT_RECORDER));
+	rec->ring = calloc(size, sizeof(RT_EVENT));
+	rec->snapshot = calloc(pre + post + 1, sizeof(RT_EVENT));
+	if (rec->ring == NULL || rec->snapshot == NULL) {
+		free(rec->ring);
+		free(rec->snapshot);
+		return -ENOMEM;
+	}
+	rec->mask = size - 1;
+	rec->pre = pre;
+	rec->post = post;
+	rec->window = window;
+	return 0;
+}
+/*****************************************************************************/
+int delete_rt_recorder(RT_RECORDER *rec)
+{
+	int i;
+
+	for (i = 0; i < rec->ntasks; ++i)
+		delete_rt_spsc(&rec->windows[i].closed);
+	free(rec->ring);
+	free(rec->snapshot);
+	rec->ring = NULL;
+	rec->snapshot = NULL;
+	return 0;
+}
+/*****************************************************************************/
+void set_rt_recorder_limits(RT_RECORDER *rec, int32_t jtr_limit, int32_t resp_limit)
+{
+	rec->jtr_limit = jtr_limit;
+	rec->resp_limit = resp_limit;
+}
+/*****************************************************************************/
+void set_rt_recorder_meta(RT_RECORDER *rec, char *meta)
+{
+	rec->meta = meta;
+}
+/*****************************************************************************/
+int add_rt_recorder_task(RT_RECORDER *rec, char *name)
+{
+	RT_WINDOW *win;
+	int ret;
+
+	if (rec->ntasks == REC_MAX_TASKS)
+		return -ENOSPC;
+
+	win = &rec->windows[rec->ntasks];
+	ret = create_rt_spsc(&win->closed, name, sizeof(RT_WINDOW_SUMMARY), REC_CLOSED_DEPTH);
+	if (ret != 0)
+		return ret;
+	win->name = name;
+	_rt_window_reset(win, 0);
+	return rec->ntasks++;
+}
+/*****************************************************************************/
+void log_rt_recorder(RT_RECORDER *rec, int task, int32_t prd, int32_t resp, int32_t jtr, FLAG miss)
+{
+	RTIME now = rt_timer_read();
+	uint64_t seq = __atomic_fetch_add(&rec->head, 1, __ATOMIC_RELAXED);
+	RT_EVENT *ev = &rec->ring[seq & rec->mask];
+	REC_REASON reason = REC_NONE;
+	uint64_t trig;
+
+	if (miss == on)
+		reason = REC_DEADLINE;
+	else if (rec->resp_limit > 0 && resp > rec->resp_limit)
+		reason = REC_RESPONSE;
+	else if (rec->jtr_limit > 0 && jtr > rec->jtr_limit)
+		reason = REC_JITTER;
+
+	/* seqlock style slot update, the writer drops slots it sees changing */
+	__atomic_store_n(&ev->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	ev->time = now;
+	ev->task = task;
+	ev->reason = reason;
+	ev->prd = prd;
+	ev->resp = resp;
+	ev->jtr = jtr;
+	__atomic_store_n(&ev->seq, seq + 1, __ATOMIC_RELEASE);
+
+	if (reason != REC_NONE)
+		_rt_recorder_trigger(rec, seq);
+	_rt_window_add(rec, task, now, prd, resp, jtr, miss, reason != REC_NONE ? on : off);
+
+	/* the snapshot is due once its post events are in, see _rt_recorder_flush() */
+	trig = __atomic_load_n(&rec->trig, __ATOMIC_RELAXED);
+	if (trig != 0 && seq + 1 >= trig + rec->post + REC_MAX_TASKS)
+		_rt_recorder_kick(rec, off);
+}
+/*****************************************************************************/
+int start_rt_recorder(RT_RECORDER *rec, char *prefix)
+{
+	char filename[256];
+	int ret;
+
+	snprintf(rec->prefix, sizeof(rec->prefix), "%s", prefix);
+	snprintf(filename, sizeof(filename), "%s_summary.dat", rec->prefix);
+	rec->summary = fopen(filename, "w");
+	if (rec->summary == NULL) {
+		perror(filename);
+		return -errno;
+	}
+	if (rec->meta != NULL)
+		fputs(rec->meta, rec->summary);
+	fprintf(rec->summary, "# task,t_start_ns,t_end_ns,count,misses,triggers,prd_min_ns,prd_max_ns,"
+			"resp_min_ns,resp_avg_ns,resp_p50_ns,resp_p99_ns,resp_max_ns,jtr_p99_ns,jtr_max_ns\n");
+
+	rec->quit = off;
+	ret = pthread_create(&rec->writer, NULL, &_rt_recorder_writer, rec);
+	if (ret != 0) {
+		fclose(rec->summary);
+		return -ret;
+	}
+	return 0;
+}
+/*****************************************************************************/
+int stop_rt_recorder(RT_RECORDER *rec)
+{
+	RT_WINDOW_SUMMARY sum;
+	RTIME now = rt_timer_read();
+	int i;
+
+	rec->quit = on;
+	_rt_recorder_kick(rec, on);
+	pthread_join(rec->writer, NULL);
+
+	/* tasks are gone, their open windows can be read directly */
+	_rt_recorder_flush(rec, on);
+	for (i = 0; i < rec->ntasks; ++i) {
+		if (rec->windows[i].count == 0)
+			continue;
+		_rt_window_summary(&rec->windows[i], i, now, &sum);
+		_rt_recorder_write_summary(rec, &sum);
+	}
+	fclose(rec->summary);
+
+	printf("Flight recorder: %lu triggers, %lu snapshots, %lu suppressed\n",
+			(unsigned long)rec->triggers, (unsigned long)rec->captures, (unsigned long)rec->suppressed);
+	printf("Soak summary datafile is generated at:%s_summary.dat\n", rec->prefix);
+	return 0;
+}
+/*****************************************************************************/
+static void _rt_window_reset(RT_WINDOW *win, RTIME now)
+{
+	win->t_start = now;
+	win->count = 0;
+	win->misses = 0;
+	win->triggers = 0;
+	win->prd_min = INT32_MAX;
+	win->prd_max = 0;
+	init_rt_hist(&win->resp, "resp");
+	init_rt_hist(&win->jtr, "jtr");
+}
+/*****************************************************************************/
+static void _rt_window_summary(RT_WINDOW *win, int task, RTIME t_end, RT_WINDOW_SUMMARY *sum)
+{
+	sum->task = task;
+	sum->t_start = win->t_start;
+	sum->t_end = t_end;
+	sum->count = win->count;
+	sum->misses = win->misses;
+	sum->triggers = win->triggers;
+	sum->prd_min = win->prd_min;
+	sum->prd_max = win->prd_max;
+	sum->resp_min = win->resp.min;
+	sum->resp_avg = get_rt_hist_mean(&win->resp);
+	sum->resp_p50 = get_rt_hist_percentile(&win->resp, 50);
+	sum->resp_p99 = get_rt_hist_percentile(&win->resp, 99);
+	sum->resp_max = win->resp.max;
+	sum->jtr_p99 = get_rt_hist_percentile(&win->jtr, 99);
+	sum->jtr_max = win->jtr.max;
+}
+/*****************************************************************************/
+static void _rt_window_add(RT_RECORDER *rec, int task, RTIME now, int32_t prd, int32_t resp, int32_t jtr, FLAG miss, FLAG trig)
+{
+	RT_WINDOW *win = &rec->windows[task];
+	RT_WINDOW_SUMMARY sum;
+
+	if (win->t_start == 0) {
+		win->t_start = now;
+	} else if (now - win->t_start >= rec->window) {
+		_rt_window_summary(win, task, now, &sum);
+		if (push_rt_spsc(&win->closed, &sum) != 0)
+			win->dropped++;
+		else
+			_rt_recorder_kick(rec, off);
+		_rt_window_reset(win, now);
+	}
+
+	win->count++;
+	if (miss == on)
+		win->misses++;
+	if (trig == on)
+		win->triggers++;
+	if (prd < win->prd_min)
+		win->prd_min = prd;
+	if (prd > win->prd_max)
+		win->prd_max = prd;
+	add_rt_hist(&win->resp, resp);
+	add_rt_hist(&win->jtr, jtr);
+}
+/*****************************************************************************/
+static void _rt_recorder_trigger(RT_RECORDER *rec, uint64_t seq)
+{
+	uint64_t idle = 0;
+
+	__atomic_add_fetch(&rec->triggers, 1, __ATOMIC_RELAXED);
+	/* one snapshot at a time, later triggers show up inside its window */
+	if (rec->captures >= REC_MAX_CAPTURES ||
+			!__atomic_compare_exchange_n(&rec->trig, &idle, seq + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		__atomic_add_fetch(&rec->suppressed, 1, __ATOMIC_RELAXED);
+}
+/*****************************************************************************/
+/* only the first event after the writer went idle pays the wake syscall */
+static void _rt_recorder_kick(RT_RECORDER *rec, FLAG force)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (force == off && (__atomic_load_n(&rec->idle, __ATOMIC_RELAXED) == 0 ||
+			__atomic_exchange_n(&rec->idle, 0, __ATOMIC_ACQ_REL) == 0))
+		return;
+	__atomic_add_fetch(&rec->kick, 1, __ATOMIC_SEQ_CST);
+	syscall(SYS_futex, &rec->kick, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+/*****************************************************************************/
+/* sleeps until a window closes, a snapshot is due or the recorder stops */
+static void *_rt_recorder_writer(void *arg)
+{
+	RT_RECORDER *rec = arg;
+	unsigned int kick;
+
+	while (rec->quit == off) {
+		kick = __atomic_load_n(&rec->kick, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&rec->idle, 1, __ATOMIC_SEQ_CST);
+		_rt_recorder_flush(rec, off);
+		if (rec->quit == off)
+			syscall(SYS_futex, &rec->kick, FUTEX_WAIT_PRIVATE, kick, NULL, NULL, 0);
+	}
+	return NULL;
+}
+/*****************************************************************************/
+static void _rt_recorder_flush(RT_RECORDER *rec, FLAG final)
+{
+	RT_WINDOW_SUMMARY sum;
+	uint64_t trig, end, head;
+	int i;
+
+	for (i = 0; i < rec->ntasks; ++i)
+		while (trypop_rt_spsc(&rec->windows[i].closed, &sum) == 0)
+			_rt_recorder_write_summary(rec, &sum);
+
+	trig = __atomic_load_n(&rec->trig, __ATOMIC_ACQUIRE);
+	if (trig != 0) {
+		end = trig + rec->post; // one past the last post-trigger event
+		head = __atomic_load_n(&rec->head, __ATOMIC_ACQUIRE);
+		/* give producers that already reserved a slot time to fill it */
+		if (head >= end + REC_MAX_TASKS || final == on) {
+			_rt_recorder_capture(rec, trig - 1, end < head ? end : head);
+			__atomic_store_n(&rec->trig, 0, __ATOMIC_RELEASE);
+		}
+	}
+	fflush(rec->summary);
+}
+/*****************************************************************************/
+static void _rt_recorder_capture(RT_RECORDER *rec, uint64_t trig, uint64_t end)
+{
+	char filename[256];
+	RT_EVENT *ev, *trig_ev = NULL;
+	uint64_t s, from, seq;
+	int n = 0, lost = 0, i;
+	FILE *fp;
+
+	from = (trig >= (uint64_t)rec->pre) ? trig - rec->pre : 0;
+	for (s = from; s < end; ++s) {
+		ev = &rec->ring[s & rec->mask];
+		seq = __atomic_load_n(&ev->seq, __ATOMIC_ACQUIRE);
+		rec->snapshot[n] = *ev;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (seq != s + 1 || __atomic_load_n(&ev->seq, __ATOMIC_RELAXED) != seq) {
+			++lost;
+			continue;
+		}
+		if (s == trig)
+			trig_ev = &rec->snapshot[n];
+		++n;
+	}
+
+	rec->captures++;
+	snprintf(filename, sizeof(filename), "%s_outlier_%lu.dat", rec->prefix, (unsigned long)rec->captures);
+	fp = fopen(filename, "w");
+	if (fp == NULL) {
+		perror(filename);
+		return;
+	}
+	if (rec->meta != NULL)
+		fputs(rec->meta, fp);
+	if (trig_ev != NULL)
+		fprintf(fp, "# trigger: task %s, %s, event %lu, %d events lost\n",
+				rec->windows[trig_ev->task].name, RecReasonNames[trig_ev->reason], (unsigned long)trig, lost);
+	fprintf(fp, "# event,offset_ns,task,prd_ns,resp_ns,jtr_ns,trigger\n");
+	for (i = 0; i < n; ++i) {
+		ev = &rec->snapshot[i];
+		fprintf(fp, "%lu,%ld,%s,%d,%d,%d,%s\n", (unsigned long)(ev->seq - 1),
+				trig_ev != NULL ? (long)(ev->time - trig_ev->time) : 0L,
+				rec->windows[ev->task].name, ev->prd, ev->resp, ev->jtr,
+				RecReasonNames[ev->reason]);
+	}
+	fclose(fp);
+	printf("Outlier snapshot is generated at:%s\n", filename);
+}
+/*****************************************************************************/
+static void _rt_recorder_write_summary(RT_RECORDER *rec, RT_WINDOW_SUMMARY *sum)
+{
+	fprintf(rec->summary, "%s,%lu,%lu,%lu,%lu,%lu,%d,%d,%d,%.0f,%d,%d,%d,%d,%d\n",
+			rec->windows[sum->task].name,
+			(unsigned long)sum->t_start, (unsigned long)sum->t_end,
+			(unsigned long)sum->count, (unsigned long)sum->misses, (unsigned long)sum->triggers,
+			sum->prd_min, sum->prd_max, sum->resp_min, sum->resp_avg,
+			sum->resp_p50, sum->resp_p99, sum->resp_max, sum->jtr_p99, sum->jtr_max);
+}
+/*****************************************************************************/
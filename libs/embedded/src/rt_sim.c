@@ -0,0 +1,471 @@
+#include <rt_sim.h>
+#include <string.h>
+/*****************************************************************************/
+#define SIM_NEVER (~(PRTIME)0)
+
+typedef enum{
+	SIM_READY = 0,
+	SIM_RUN,
+	SIM_SLEEP,
+	SIM_BLOCKED,
+	SIM_DONE
+}SIM_STATE;
+
+typedef struct SIM_MUTEX SIM_MUTEX;
+
+typedef struct SIM_TCB{
+	char* name;
+	int prio;
+	int eff; // prio raised by the waiters of the held mutexes
+	SIM_STATE state;
+	uint64_t seq; // FIFO order among equal priorities
+	PRTIME wake;
+	PRTIME debt; // overhead to spin before the body continues
+	SIM_MUTEX* blocked_on;
+	SIM_MUTEX* held[SIM_MAX_HELD];
+	int nheld;
+	pthread_cond_t cond;
+	struct SIM_TCB* next;
+}SIM_TCB;
+
+struct SIM_MUTEX{
+	SIM_TCB* owner;
+};
+/*****************************************************************************/
+static pthread_mutex_t SimLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t SimIdle = PTHREAD_COND_INITIALIZER; // a created task started or was discarded
+static pthread_cond_t SimTime = PTHREAD_COND_INITIALIZER; // the clock moved
+static pthread_key_t SimKey;
+static pthread_once_t SimOnce = PTHREAD_ONCE_INIT;
+static __thread SIM_TCB* SimSelf = NULL;
+
+static SIM_TCB* SimTasks = NULL;
+static SIM_TCB* SimRunning = NULL;
+static SIM_TCB* SimLast = NULL;
+static FLAG SimIdling = off;
+static PRTIME SimNow = 0;
+static uint64_t SimSeq = 0;
+static int SimPending = 0; // created, not in the model yet: the clock holds
+static PT_SIM_OVERHEAD SimOvh = {0, 0, 0, 0, 1};
+static PT_SIM_STATS SimStats;
+/*****************************************************************************/
+static void _sim_schedule(void);
+/*****************************************************************************/
+/* the virtual clock starts at the real one */
+static void _sim_start_clock(void)
+{
+	struct timespec now;
+
+	if (SimNow == 0) {
+		clock_gettime(CLOCK_TO_USE, &now);
+		SimNow = TIMESPEC2NS(now);
+	}
+}
+/*****************************************************************************/
+static SIM_TCB* _sim_pick(void)
+{
+	SIM_TCB *t, *best = NULL;
+
+	for (t = SimTasks; t != NULL; t = t->next)
+		if (t->state == SIM_READY &&
+				(best == NULL || t->eff > best->eff || (t->eff == best->eff && t->seq < best->seq)))
+			best = t;
+	return best;
+}
+/*****************************************************************************/
+static PRTIME _sim_next_wake(void)
+{
+	PRTIME next = SIM_NEVER;
+	SIM_TCB *t;
+
+	for (t = SimTasks; t != NULL; t = t->next)
+		if (t->state == SIM_SLEEP && t->wake < next)
+			next = t->wake;
+	return next;
+}
+/*****************************************************************************/
+static void _sim_wake_due(void)
+{
+	SIM_TCB *t;
+
+	for (t = SimTasks; t != NULL; t = t->next)
+		if (t->state == SIM_SLEEP && t->wake <= SimNow) {
+			t->state = SIM_READY;
+			t->seq = ++SimSeq;
+		}
+	pthread_cond_broadcast(&SimTime);
+}
+/*****************************************************************************/
+/* gives the cpu up until the scheduler hands it back */
+static void _sim_yield(SIM_TCB *self)
+{
+	PRTIME debt;
+
+	_sim_schedule();
+	while (SimRunning != self)
+		pthread_cond_wait(&self->cond, &SimLock);
+
+	while (self->debt > 0) {
+		debt = self->debt;
+		self->debt = 0;
+		pthread_mutex_unlock(&SimLock);
+		pt_sim_spin(debt);
+		pthread_mutex_lock(&SimLock);
+	}
+}
+/*****************************************************************************/
+/* the highest ready task gets the cpu, when there is none the clock jumps
+ * to the next wakeup. Called with SimLock by the task giving the cpu up. */
+static void _sim_schedule(void)
+{
+	PRTIME next;
+	SIM_TCB *t;
+
+	for (;;) {
+		t = _sim_pick();
+		if (t != NULL) {
+			if (t != SimLast) {
+				t->debt += SimOvh.ctx;
+				SimStats.switches++;
+			}
+			SimLast = SimRunning = t;
+			t->state = SIM_RUN;
+			pthread_cond_signal(&t->cond);
+			return;
+		}
+
+		SimRunning = NULL;
+		next = _sim_next_wake();
+		if (next == SIM_NEVER)
+			return;
+
+		/* tasks of the same set are still being started, however long the host takes */
+		if (SimPending > 0) {
+			SimIdling = on;
+			pthread_cond_wait(&SimIdle, &SimLock);
+			SimIdling = off;
+			continue;
+		}
+		if (next > SimNow)
+			SimNow = next;
+		_sim_wake_due();
+	}
+}
+/*****************************************************************************/
+static void _sim_preempt_check(SIM_TCB *self)
+{
+	SIM_TCB *t = _sim_pick();
+
+	if (t != NULL && t->eff > self->eff) {
+		SimStats.preemptions++;
+		self->state = SIM_READY;
+		_sim_yield(self);
+	}
+}
+/*****************************************************************************/
+/* base priority or the highest waiter on a held mutex */
+static int _sim_eff(SIM_TCB *self)
+{
+	SIM_TCB *t;
+	int i, eff = self->prio;
+
+	for (i = 0; i < self->nheld; ++i)
+		for (t = SimTasks; t != NULL; t = t->next)
+			if (t->state == SIM_BLOCKED && t->blocked_on == self->held[i] && t->eff > eff)
+				eff = t->eff;
+	return eff;
+}
+/*****************************************************************************/
+/* along the chain of owners blocked on further mutexes */
+static void _sim_boost(SIM_TCB *owner)
+{
+	int eff;
+
+	while (owner != NULL) {
+		eff = _sim_eff(owner);
+		if (eff == owner->eff)
+			break;
+		if (eff > owner->eff)
+			SimStats.boosts++;
+		owner->eff = eff;
+		owner = (owner->blocked_on != NULL) ? owner->blocked_on->owner : NULL;
+	}
+}
+/*****************************************************************************/
+/* at the exit of a simulated thread, return or pthread_exit */
+static void _sim_exit(void *arg)
+{
+	SIM_TCB *self = arg, **pt;
+
+	pthread_mutex_lock(&SimLock);
+	self->state = SIM_DONE;
+	for (pt = &SimTasks; *pt != NULL; pt = &(*pt)->next)
+		if (*pt == self) {
+			*pt = self->next;
+			break;
+		}
+	if (SimLast == self)
+		SimLast = NULL;
+	if (SimRunning == self)
+		_sim_schedule();
+	pthread_mutex_unlock(&SimLock);
+	pthread_cond_destroy(&self->cond);
+	free(self);
+}
+/*****************************************************************************/
+static void _sim_key(void)
+{
+	pthread_key_create(&SimKey, _sim_exit);
+}
+/*****************************************************************************/
+int pt_sim_set_overhead(PT_SIM_OVERHEAD *ovh)
+{
+	pthread_mutex_lock(&SimLock);
+	SimOvh = *ovh;
+	pthread_mutex_unlock(&SimLock);
+	return 0;
+}
+/*****************************************************************************/
+void pt_sim_get_stats(PT_SIM_STATS *stats)
+{
+	pthread_mutex_lock(&SimLock);
+	*stats = SimStats;
+	pthread_mutex_unlock(&SimLock);
+}
+/*****************************************************************************/
+/* the thread itself runs as SCHED_OTHER, the model does the priorities */
+int pt_sim_create(PT_TASK* task, int prio)
+{
+	struct sched_param param = { .sched_priority = 0};
+	int err;
+
+	err = pthread_attr_setinheritsched(&task->thread_attributes, PTHREAD_EXPLICIT_SCHED);
+	if (err == 0)
+		err = pthread_attr_setschedpolicy(&task->thread_attributes, SCHED_OTHER);
+	if (err == 0)
+		err = pthread_attr_setschedparam(&task->thread_attributes, &param);
+	if (err)
+	{
+		TASK_DBG(task->s_mode,"set sched attributes failed for thread '%s' with err=%d\n", task->name, err);
+		return -ESCHEDPOL;
+	}
+
+	pthread_mutex_lock(&SimLock);
+	_sim_start_clock();
+	SimPending++;
+	pthread_mutex_unlock(&SimLock);
+	return 0;
+}
+/*****************************************************************************/
+static void _sim_unpend(void)
+{
+	if (SimPending > 0)
+		SimPending--;
+	if (SimIdling == on)
+		pthread_cond_signal(&SimIdle);
+}
+/*****************************************************************************/
+void pt_sim_discard(PT_TASK* task)
+{
+	pthread_mutex_lock(&SimLock);
+	_sim_unpend();
+	pthread_mutex_unlock(&SimLock);
+}
+/*****************************************************************************/
+/* the new thread joins the model and waits for the cpu */
+int pt_sim_enter(char* name, int prio, PRTIME runtime, PRTIME period)
+{
+	SIM_TCB *self;
+
+	pthread_once(&SimOnce, _sim_key);
+	self = calloc(1, sizeof(SIM_TCB));
+	if (self == NULL) {
+		pt_sim_discard(NULL);
+		return -ENOMEM;
+	}
+	self->name = name;
+	self->prio = self->eff = prio;
+	pthread_cond_init(&self->cond, NULL);
+	pthread_setspecific(SimKey, self);
+	SimSelf = self;
+
+	pthread_mutex_lock(&SimLock);
+	self->state = SIM_READY;
+	self->seq = ++SimSeq;
+	self->next = SimTasks;
+	SimTasks = self;
+
+	/* a running task notices the newcomer at its next clock step, an idle
+	 * scheduler once it is woken */
+	_sim_unpend();
+	if (SimIdling == off && SimRunning == NULL)
+		_sim_schedule();
+	pthread_mutex_unlock(&SimLock);
+	return 0;
+}
+/*****************************************************************************/
+void pt_sim_dispatch(void)
+{
+	SIM_TCB *self = SimSelf;
+
+	pthread_mutex_lock(&SimLock);
+	while (SimRunning != self)
+		pthread_cond_wait(&self->cond, &SimLock);
+	pthread_mutex_unlock(&SimLock);
+}
+/*****************************************************************************/
+PRTIME pt_sim_read(void)
+{
+	PRTIME now;
+
+	if (SimSelf != NULL && SimOvh.read > 0)
+		pt_sim_spin(SimOvh.read);
+	pthread_mutex_lock(&SimLock);
+	_sim_start_clock();
+	now = SimNow;
+	pthread_mutex_unlock(&SimLock);
+	return now;
+}
+/*****************************************************************************/
+/* ns of cpu, up to every wakeup on the way that may preempt */
+void pt_sim_spin(PRTIME ns)
+{
+	SIM_TCB *self = SimSelf;
+	PRTIME next;
+
+	if (self == NULL)
+		return; // only tasks own the simulated cpu
+	pthread_mutex_lock(&SimLock);
+	while (ns > 0) {
+		next = _sim_next_wake();
+		if (next == SIM_NEVER || next >= SimNow + ns) {
+			SimNow += ns;
+			ns = 0;
+		} else {
+			if (next > SimNow) {
+				ns -= next - SimNow;
+				SimNow = next;
+			}
+		}
+		_sim_wake_due();
+		_sim_preempt_check(self);
+	}
+	pthread_mutex_unlock(&SimLock);
+}
+/*****************************************************************************/
+int pt_sim_sleep_until(PRTIME date)
+{
+	SIM_TCB *self = SimSelf;
+
+	pthread_mutex_lock(&SimLock);
+	_sim_start_clock();
+	if (self == NULL) {
+		/* other threads just follow the clock */
+		while (SimNow < date)
+			pthread_cond_wait(&SimTime, &SimLock);
+	}
+	else if (date > SimNow) {
+		self->wake = date + SimOvh.wake;
+		if (SimOvh.jitter > 0)
+			self->wake += (PRTIME)rand_r(&SimOvh.seed) % SimOvh.jitter;
+		self->state = SIM_SLEEP;
+		_sim_yield(self);
+	}
+	pthread_mutex_unlock(&SimLock);
+	return 0;
+}
+/*****************************************************************************/
+/* a model mutex, no process shares the simulated cpu */
+int pt_sim_mutex_init(PT_MUTEX* mutex, int pshared)
+{
+	if (pshared == PTHREAD_PROCESS_SHARED)
+		return -ENOTSUP;
+	mutex->sim = calloc(1, sizeof(SIM_MUTEX));
+	return (mutex->sim != NULL) ? 0 : -ENOMEM;
+}
+/*****************************************************************************/
+int pt_sim_mutex_destroy(PT_MUTEX* mutex)
+{
+	free(mutex->sim);
+	mutex->sim = NULL;
+	return 0;
+}
+/*****************************************************************************/
+int pt_sim_mutex_lock(PT_MUTEX* mutex)
+{
+	SIM_MUTEX *m = mutex->sim;
+	SIM_TCB *self = SimSelf;
+
+	if (self == NULL)
+		return -EPERM;
+	pthread_mutex_lock(&SimLock);
+	if (m->owner == self) {
+		pthread_mutex_unlock(&SimLock);
+		return -EDEADLK;
+	}
+	if (m->owner != NULL) {
+		SimStats.blocked++;
+		self->blocked_on = m;
+		self->state = SIM_BLOCKED;
+		_sim_boost(m->owner);
+		_sim_yield(self); // back as the owner, see pt_sim_mutex_unlock()
+	}
+	else
+		m->owner = self;
+	if (self->nheld < SIM_MAX_HELD)
+		self->held[self->nheld++] = m;
+	pthread_mutex_unlock(&SimLock);
+	return 0;
+}
+/*****************************************************************************/
+int pt_sim_mutex_trylock(PT_MUTEX* mutex)
+{
+	SIM_MUTEX *m = mutex->sim;
+	SIM_TCB *self = SimSelf;
+	int ret = 0;
+
+	if (self == NULL)
+		return -EPERM;
+	pthread_mutex_lock(&SimLock);
+	if (m->owner != NULL)
+		ret = (m->owner == self) ? -EDEADLK : -EBUSY;
+	else {
+		m->owner = self;
+		if (self->nheld < SIM_MAX_HELD)
+			self->held[self->nheld++] = m;
+	}
+	pthread_mutex_unlock(&SimLock);
+	return ret;
+}
+/*****************************************************************************/
+/* hands the mutex to its highest waiter, drops the inherited priority */
+int pt_sim_mutex_unlock(PT_MUTEX* mutex)
+{
+	SIM_MUTEX *m = mutex->sim;
+	SIM_TCB *self = SimSelf, *t, *next = NULL;
+	int i;
+
+	if (self == NULL || m->owner != self)
+		return -EPERM;
+	pthread_mutex_lock(&SimLock);
+	for (i = 0; i < self->nheld; ++i)
+		if (self->held[i] == m) {
+			self->held[i] = self->held[--self->nheld];
+			break;
+		}
+	for (t = SimTasks; t != NULL; t = t->next)
+		if (t->state == SIM_BLOCKED && t->blocked_on == m &&
+				(next == NULL || t->eff > next->eff || (t->eff == next->eff && t->seq < next->seq)))
+			next = t;
+	m->owner = next;
+	if (next != NULL) {
+		next->blocked_on = NULL;
+		next->state = SIM_READY;
+		next->seq = ++SimSeq;
+	}
+	self->eff = _sim_eff(self);
+	_sim_preempt_check(self);
+	pthread_mutex_unlock(&SimLock);
+	return 0;
+}
+/*****************************************************************************/
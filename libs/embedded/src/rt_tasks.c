@@ -11,7 +11,7 @@
 #define DEFAULT_TASK_MODE RT
 #endif
 int _create_rt_task(RT_TASK *task, char *name, int stksize, int prio, int mode);
-int _set_rt_task_period(RT_TASK *task, SRTIME period);
+int _set_rt_task_period(RT_TASK *task, RTIME idate, SRTIME period);
 /*
 ****************************************************************************/
 int _create_rt_task(RT_TASK *task, char *name, int stksize, int prio, int mode) {
@@ -31,7 +31,7 @@ int _create_rt_task(RT_TASK *task, char *name, int stksize, int prio, int mode)
 	return ret;
 }
 /*****************************************************************************/
-int _set_rt_task_period(RT_TASK *task, SRTIME period) {
+int _set_rt_task_period(RT_TASK *task, RTIME idate, SRTIME period) {
 	int ret = -1;
 	char str[1024]={0,};
 
@@ -41,10 +41,10 @@ int _set_rt_task_period(RT_TASK *task, SRTIME period) {
 	if (ret != 0) {
 		return ret;
 	}
-	ret = rt_task_set_periodic(task, TM_NOW, period);
+	ret = rt_task_set_periodic(task, idate, period);
 
 #else
-	ret = pt_task_set_periodic(task, TM_NOW, period);
+	ret = pt_task_set_periodic(task, idate, period);
 	RT_TASK info = *task;
 #endif
 
@@ -60,8 +60,100 @@ int create_rt_task(RT_TASK *task, char *name, int prio) {
 	return _create_rt_task(task, name, DEFAULT_TASK_STKSIZE, prio, DEFAULT_TASK_MODE);
 }
 /*****************************************************************************/
+int create_rt_task_joinable(RT_TASK *task, char *name, int prio) {
+	int ret = -1;
+
+#ifdef _XENOMAI_TASKS_
+	ret = _create_rt_task(task, name, DEFAULT_TASK_STKSIZE, prio, DEFAULT_TASK_MODE | T_JOINABLE);
+#else
+	ret = _create_rt_task(task, name, DEFAULT_TASK_STKSIZE, prio, DEFAULT_TASK_MODE);
+	if (ret == 0)
+		ret = pt_task_set_joinable(task);
+#endif
+	return ret;
+}
+/*****************************************************************************/
+int join_rt_task(RT_TASK *task)
+{
+	int ret = -1;
+	char str[1024]={0,};
+
+#ifdef _XENOMAI_TASKS_
+	ret = rt_task_join(task);
+#else
+	ret = pt_task_join(task);
+#endif
+
+	if (ret != 0) {
+		snprintf(str, sizeof(str), "[ERROR] Failed to join RT task,%d", ret);
+		perror(str);
+	}
+	return ret;
+}
+/*****************************************************************************/
+int discard_rt_task(RT_TASK *task)
+{
+#ifdef _XENOMAI_TASKS_
+	return rt_task_delete(task);
+#else
+	return pt_task_discard(task);
+#endif
+}
+/*****************************************************************************/
 int set_rt_task_period(RT_TASK *task, RTIME period) {
-	return _set_rt_task_period(task, (period));
+	return _set_rt_task_period(task, TM_NOW, (period));
+}
+/*****************************************************************************/
+int set_rt_task_release(RT_TASK *task, RTIME release, RTIME period) {
+	return _set_rt_task_period(task, release, (period));
+}
+/*****************************************************************************/
+int set_rt_task_affinity(RT_TASK *task, int cpu)
+{
+	int ret = -1;
+	char str[1024]={0,};
+
+#ifdef _XENOMAI_TASKS_
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	ret = rt_task_set_affinity(task, &cpus);
+#else
+	ret = pt_task_set_affinity(task, cpu);
+#endif
+
+	if (ret != 0) {
+		snprintf(str, sizeof(str), "[ERROR] Failed to pin RT task to cpu %d,%d", cpu, ret);
+		perror(str);
+	}
+	return ret;
+}
+/*****************************************************************************/
+int set_rt_task_cpus(RT_TASK *task, cpu_set_t *cpus)
+{
+	int ret = -1;
+	char str[1024]={0,};
+
+#ifdef _XENOMAI_TASKS_
+	ret = rt_task_set_affinity(task, cpus);
+#else
+	ret = pt_task_set_cpus(task, cpus);
+#endif
+
+	if (ret != 0) {
+		snprintf(str, sizeof(str), "[ERROR] Failed to set the cpus of RT task,%d", ret);
+		perror(str);
+	}
+	return ret;
+}
+/*****************************************************************************/
+int set_rt_task_budget(RT_TASK *task, RTIME runtime, RTIME period)
+{
+#ifdef _XENOMAI_TASKS_
+	return 0;
+#else
+	return pt_task_set_budget(task, runtime, period);
+#endif
 }
 /*****************************************************************************/
 void wait_rt_period(RT_TASK *task)
@@ -82,7 +174,20 @@ void wait_rt_period(RT_TASK *task)
 	#endif
 }
 /*****************************************************************************/
+int sleep_rt_task_until(RTIME date)
+{
+#ifdef _XENOMAI_TASKS_
+	return rt_task_sleep_until(date);
+#else
+	return pt_task_sleep_until(date);
+#endif
+}
+/*****************************************************************************/
 int start_rt_task(int enable, RT_TASK *task, void (*fun)(void *cookie)) {
+	return start_rt_task_arg(enable, task, fun, NULL);
+}
+/*****************************************************************************/
+int start_rt_task_arg(int enable, RT_TASK *task, void (*fun)(void *cookie), void *arg) {
 	int ret = -1;
 	char str[1024]={0,};
 
@@ -98,9 +203,9 @@ int start_rt_task(int enable, RT_TASK *task, void (*fun)(void *cookie)) {
 
 	if (enable) {
 #ifdef _XENOMAI_TASKS_
-		ret = rt_task_start(task, fun, NULL);
+		ret = rt_task_start(task, fun, arg);
 #else
-		ret = pt_task_start(task, fun, NULL);
+		ret = pt_task_start(task, fun, arg);
 #endif
 		if (ret != 0) {
 			snprintf(str, sizeof(str), "[ERROR] Failed to start RT task \"%s\",%d", info.name, ret);
@@ -114,6 +219,55 @@ int start_rt_task(int enable, RT_TASK *task, void (*fun)(void *cookie)) {
 	return ret;
 }
 /****************************************************************************/
+int set_rt_clock(clockid_t clock)
+{
+#ifdef _XENOMAI_TASKS_
+	/* alchemy timers always run on the Cobalt core clock */
+	return (clock == CLOCK_MONOTONIC) ? 0 : -ENOTSUP;
+#else
+	return pt_timer_set_clock(clock);
+#endif
+}
+/****************************************************************************/
+int set_rt_backend(char *name)
+{
+#ifdef _XENOMAI_TASKS_
+	return (strcmp(name, "alchemy") == 0) ? 0 : -ENOTSUP;
+#else
+	return pt_backend_set(name);
+#endif
+}
+/****************************************************************************/
+char* get_rt_backend(void)
+{
+#ifdef _XENOMAI_TASKS_
+	return "alchemy";
+#else
+	return PtBackend->name;
+#endif
+}
+/****************************************************************************/
+FLAG is_rt_backend_simulated(void)
+{
+#ifdef _XENOMAI_TASKS_
+	return off;
+#else
+	return PtBackend->simulated;
+#endif
+}
+/****************************************************************************/
+void print_rt_backends(FILE *fp)
+{
+#ifdef _XENOMAI_TASKS_
+	fprintf(fp, "  %-10s %s\n", "alchemy", "Xenomai alchemy tasks");
+#else
+	int i;
+
+	for (i = 0; PtBackends[i].name != NULL; ++i)
+		fprintf(fp, "  %-10s %s\n", PtBackends[i].name, PtBackends[i].desc);
+#endif
+}
+/****************************************************************************/
 void delete_rt_task(void)
 {
 	int ret = -1;
@@ -22,18 +22,31 @@
 #include <unistd.h>
 #include <time.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
 #include <malloc.h>
 #include <pthread.h>
 #include <ctype.h>
+#include <getopt.h>
+#include <math.h>
 /*****************************************************************************/
 /* RT_TASKS */
 /*****************************************************************************/
 #include <rt_tasks.h>
 #include <rt_itc.h> // for mutex
+#include <rt_recorder.h> // soak mode
+#include <rt_log.h> // heartbeat from the RT loop
+#include <rt_exec.h> // execution time models
+/*****************************************************************************/
+/* BENCHMARK SCENARIOS */
+/*****************************************************************************/
+#include <bench.h> //./bench
 
 /* comment out to run periodicity test */
 #define _PREEMPTION_TEST_
 
+/* uncomment to subtract the calibrated probe bias from every response time */
+// #define _PROBE_COMPENSATION_
+
 /* conversion of selected jiffy to actual clock ticks in nanoseconds */
 #define JIFFY_TO_USE (NSEC_PER_MSEC) // ms (1M)
 // #define JIFFY_TO_USE (NSEC_PER_USEC) // μs (1k)
@@ -46,35 +59,59 @@
 /* should use enum in future release */
 #define CLOCKTICKS(x) (int)(((float)x * JIFFY_TO_USE))
 
-/* task creation */
-RT_TASK TskTest1;
-RT_TASK TskTest2;
-RT_TASK TskTest3;
-
 #define TASK_1_PRIO		(99) // xeno: 99 
 #define TASK_1_PRD		(100)
 #define TASK_1_EXE		(3)
-char *sTaskName1 = "task_1";
+#define TASK_1_EXE_MODEL "fixed"
 
 #define TASK_2_PRIO		(80)
 #define TASK_2_PRD		(20)
 #define TASK_2_EXE		(5)
-char *sTaskName2 = "task_2";
+#define TASK_2_EXE_MODEL "fixed"
 
 #ifdef _PREEMPTION_TEST_
 #define TEST_NAME "_prmpt_test"
 #define TASK_3_PRIO		(50)
 #define TASK_3_PRD		(40)
 #define TASK_3_EXE		(10)
-char *sTaskName3 = "task_3";
+#define TASK_3_EXE_MODEL "fixed"
+#define TASK_LOCK		on // every task spins inside the mutex
 #else
 #define TEST_NAME "_sched_test"
+#define TASK_LOCK		off // only task_1 takes the mutex
 #endif
 
 #define TASK_TIMESLICE (0.1) //timeslice of 1 cpu spin 
+#define TASK_BUDGET (1.25) // runtime per execution time with the deadline backend
+
+/* execution time of every job from a model of rt_exec.h in jiffies, e.g.
+ * "uniform:2,4", "normal:3,0.5", "bimodal:2,6,0.1", "pareto:2,2.5" or
+ * "trace:exe.csv:4"; "fixed" spins TASK_n_EXE. Demands are capped at the
+ * period, EXE_SEED makes the draws repeatable. */
+#define EXE_SEED (1)
+
+/* response time decomposition of every job from the scheduler statistics of
+ * its thread (bench_sched_sample), taken at the end of the previous job, at
+ * the start and at the end of this one:
+ *   backlog : release to the end of the previous job of the task, overrun
+ *   wake    : then to start, not runnable (timer and wakeup latency)
+ *   run     : on the cpu from start to end (demand and kernel overhead)
+ *   wait    : runnable but not running, preempted before or during the job
+ *   blocked : the rest of the response, asleep on the mutex
+ * The samples add about three system calls to each job; off, a soak run or
+ * a backend without statistics (sim, Xenomai) skips it. */
+#define DECOMP on
+#define DECOMP_TAIL (99) // percentile of the response above which the slow jobs are broken down
+
+/* release phasing: "sync" releases every task at the same epoch (critical
+ * instant), "stagger" offsets each task by the execution times of the higher
+ * priority ones, or a list of phases in jiffies, e.g. "0,3,8" */
+#define TEST_PHASING "sync"
+#define RELEASE_DELAY (NSEC_PER_SEC) // epoch from the start of the run
+#define TEST_CPU (BENCH_CPU_AUTO) // every test task runs here, auto picks the quietest cpu
 
 /* data acquisition */
-#define SEC_TO_BUF(x,y) (x*TICKS_PER_SEC(CLOCKTICKS(y)))
+#define SEC_TO_BUF(x,y) ((x)*TICKS_PER_SEC(CLOCKTICKS(y)))
 #define MAX_BUF (3600000) 
 #define FILE_EXT ".dat"
 #define FILE_PATH "./results/"
@@ -90,212 +127,346 @@ int test_duration = 100;  //1 hour
 int BufPrd1[MAX_BUF] 	= {0,}; 
 int BufResp1[MAX_BUF] 	= {0,};
 int BufJtr1[MAX_BUF]	= {0,};
-int iBufCnt1 = 0; 
+int BufDem1[MAX_BUF]	= {0,};
 
 /* TASK_2 Buffers */
 int BufPrd2[MAX_BUF] 	= {0,}; 
 int BufResp2[MAX_BUF] 	= {0,};
 int BufJtr2[MAX_BUF]	= {0,};
-int iBufCnt2 = 0;
+int BufDem2[MAX_BUF]	= {0,};
 
 #ifdef _PREEMPTION_TEST_
 /* TASK_3 Buffers */
 int BufPrd3[MAX_BUF] 	= {0,}; 
 int BufResp3[MAX_BUF] 	= {0,};
 int BufJtr3[MAX_BUF]	= {0,};
-int iBufCnt3 = 0;
+int BufDem3[MAX_BUF]	= {0,};
 #endif
 
-FLAG bQuitFlag = off;
+typedef struct {
+	int backlog, wake, run, wait, blocked; // ns, see DECOMP
+	short nvcsw, nivcsw; // switches during the job
+}JOB_DECOMP;
+
+/* task creation */
+typedef struct {
+	RT_TASK task;
+	char *name;
+	int prio;
+	int prd; // jiffies
+	int exe; // jiffies
+	char *exe_model; // see EXE_SEED
+	RT_EXEC exec;
+	FLAG lock; // spin inside the mutex
+	int *BufPrd;
+	int *BufResp;
+	int *BufJtr;
+	int *BufDem; // demand of the job, ns
+	int nBuf; // jobs the buffers hold
+	JOB_DECOMP *Decomp; // allocated per run, NULL without DECOMP
+	int nDecomp;
+	int iBufCnt;
+	int rec; // flight recorder id in soak mode
+	float phase; // jiffies after the release epoch
+	RTIME release; // first nominal release
+	volatile int done;
+}TEST_TASK;
+
+/* the first task paces the test: prints the heartbeat and ends the run */
+TEST_TASK TaskSet[] = {
+	{.name = "task_1", .prio = TASK_1_PRIO, .prd = TASK_1_PRD, .exe = TASK_1_EXE, .lock = on,
+		.exe_model = TASK_1_EXE_MODEL, .BufPrd = BufPrd1, .BufResp = BufResp1, .BufJtr = BufJtr1, .BufDem = BufDem1,
+		.nBuf = MAX_BUF},
+	{.name = "task_2", .prio = TASK_2_PRIO, .prd = TASK_2_PRD, .exe = TASK_2_EXE, .lock = TASK_LOCK,
+		.exe_model = TASK_2_EXE_MODEL, .BufPrd = BufPrd2, .BufResp = BufResp2, .BufJtr = BufJtr2, .BufDem = BufDem2,
+		.nBuf = MAX_BUF},
+#ifdef _PREEMPTION_TEST_
+	{.name = "task_3", .prio = TASK_3_PRIO, .prd = TASK_3_PRD, .exe = TASK_3_EXE, .lock = TASK_LOCK,
+		.exe_model = TASK_3_EXE_MODEL, .BufPrd = BufPrd3, .BufResp = BufResp3, .BufJtr = BufJtr3, .BufDem = BufDem3,
+		.nBuf = MAX_BUF},
+#endif
+};
+#define NUM_TASKS (int)(sizeof(TaskSet) / sizeof(TaskSet[0]))
+/* the task set of the run, a copy in shared memory in process mode */
+TEST_TASK *TestTasks = TaskSet;
+
+/* run lifecycle: every task runs WARMUP_JOBS jobs unrecorded, the last one
+ * to finish its warm-up opens the measurement, the first task or a signal
+ * starts the drain. Tasks leave at their next job boundary, raise their
+ * done flag and main, blocked on those flags, joins them. */
+typedef enum {
+	RUN_WARMUP = 0,
+	RUN_MEASURE,
+	RUN_DRAIN
+}RUN_PHASE;
+#define WARMUP_JOBS (2) // omit "irregular" data at start-up
+
+/* what the tasks share during a run */
+typedef struct {
+	int phase; // RUN_PHASE, atomic
+	int warm; // tasks past their warm-up
+	RT_MUTEX lock;
+}RUN_STATE;
+RUN_STATE RunLocal;
+RUN_STATE *Run = &RunLocal;
 
-/* mutex */
-RT_MUTEX lock;
+/* process mode: every task is forked into a process of its own, so a
+ * preemption also switches the address space. The task set, the run state
+ * with a process-shared mutex and the buffers move to one MAP_SHARED
+ * segment, sized for test_duration. */
+typedef struct {
+	RUN_STATE run;
+	TEST_TASK tasks[NUM_TASKS];
+	/* then BufPrd, BufResp, BufJtr, BufDem of every task */
+}RUN_SHARED;
+FLAG bProcess = off;
+RUN_SHARED *Shared = NULL;
+size_t SharedSize = 0;
+
+/* shared release epoch of all tasks */
+RTIME rtmEpoch = 0;
+char *Phasing = TEST_PHASING;
+int TestCpu = 0; // resolved from TEST_CPU in TimingInit()
+
+#ifdef _PROBE_COMPENSATION_
+FLAG bCompensate = on;
+#else
+FLAG bCompensate = off;
+#endif
+
+/* soak mode: samples go to the flight recorder instead of the buffers */
+FLAG bSoak = off;
+RT_RECORDER Recorder;
+
+/* phase mode: response times of every phasing are compared, no raw files */
+FLAG bPhase = off;
+RT_HIST PhaseHists[NUM_TASKS];
+
+/* scenarios selected by the first argument, no argument runs the test above */
+typedef struct {
+	char *name;
+	int (*run)(int argc, char **argv);
+	char *desc;
+	FLAG sim; // on: its tasks only block in the calls the sim backend models
+}BENCH_MODE;
+
+int SoakMain(int argc, char **argv);
+int PhaseMain(int argc, char **argv);
+int ProcessMain(int argc, char **argv);
+
+BENCH_MODE BenchModes[] = {
+	{"soak",	SoakMain,		"the test above for unlimited durations, outlier snapshots + per-minute summaries",	on},
+	{"phase",	PhaseMain,		"the test above with simultaneous vs. staggered releases, response time comparison",	on},
+	{"process",	ProcessMain,	"the test above with the tasks as threads vs. one process each, response time comparison",	off},
+	{"ipc",	bench_ipc_main,	"inter-task round-trip latency over futex/eventfd/pipe/mq/socket/condvar",	off},
+	{"pipeline",	bench_pipeline_main,	"multi-stage task chain, per-stage and end-to-end latency vs. rate",	off},
+	{"cyclic",	bench_cyclic_main,	"many periodic jobs: thread-per-task vs. cyclic executive table / run queue",	off},
+	{"forkjoin",	bench_forkjoin_main,	"parallel fork-join jobs: dispatch, straggler skew, response vs. workers",	off},
+	{"clock",	bench_clock_main,	"time sources: read cost, resolution, monotonicity and cross-core skew",	off},
+	{"sporadic",	bench_sporadic_main,	"event-triggered jobs over periodic load: direct, polling or deferrable server",	off},
+	{"crpd",	bench_crpd_main,	"cache-related preemption delay of L1/L2/LLC-sized working sets",	off},
+	{"global",	bench_global_main,	"global vs. partitioned fixed-priority scheduling, migrations per job",	off},
+	{"exchange",	bench_exchange_main,	"writer/reader state exchange over PI mutex, seqlock and triple buffer",	off},
+	{"suite",	bench_suite_main,	"named, versioned task sets (sched, preempt, inversion, highrate, overload, nested) with one report",	on},
+	{"compare",	bench_compare_main,	"percentile deltas, KS and Mann-Whitney tests of test runs, exit 2 on a tail regression",	on},
+	{NULL,	NULL,			NULL,	off}
+};
 
 /*****************************************************************************/
 /* function macros */
 /*****************************************************************************/
-void XenoInit();
-void XenoStart();
+int RunTest();
+void TimingInit();
+int SetPhasing(char *phasing);
+int XenoInit();
+int XenoStart();
 void SignalHandler(int signum);
-void FilePrintEval(char *task_name,int BufPrd[], int BufExe[], int BufJit[], int ArraySize);
+void RunStop();
+int _file_existence(char* filenames);
+void FilePrintEval(char *task_name,int BufPrd[], int BufExe[], int BufJit[], int BufDem[], int ArraySize);
+int SetExeModels();
+int ParseExeModel(char *arg);
+void PrintDemandTracking();
+int AllocDecomp();
+void* RunAlloc(size_t size);
+void RunFree(void *p, size_t size);
+int SetLayout(FLAG process);
+void ForkTasks();
+int TaskProcess(TEST_TASK *t);
+void DecomposeJob(JOB_DECOMP *d, RTIME backlog, RTIME delay, RTIME resp, BENCH_SCHED *prev, BENCH_SCHED *start, BENCH_SCHED *end);
+void DecompPrintEval(TEST_TASK *t);
+void PrintDecomposition();
 /****************************************************************************/
-void TestTask1(void *arg){
+void TestTask(void *arg){
 	
+	TEST_TASK *t = (TEST_TASK *)arg;
+	FLAG bMaster = (t == &TestTasks[0]) ? on : off;
 	int iTaskTick = 0;
-	int task_runtime;
+	RTIME task_runtime;
 
-	RTIME rtmPrdCurr=0, rtmPrdPrev=0, rtmRespStart=0, rtmResp=0; 
+	RTIME rtmPrdCurr=0, rtmPrdPrev=0, rtmRespStart=0, rtmResp=0, rtmRelease=0, rtmRespPrev=0; 
 	int tmPrd=0, tmResp=0, tmJtr=0;
 	
 	RTIME TaskSpinTime = CLOCKTICKS(TASK_TIMESLICE);
-	RTIME TaskExeTime = CLOCKTICKS(TASK_1_EXE);
+	RTIME TaskExeTime;
 
+	BENCH_SCHED ssPrev, ssStart, ssEnd;
+	int fdSched = (t->Decomp != NULL) ? bench_sched_open() : -1;
+
+	if (fdSched >= 0 && bench_sched_sample(fdSched, &ssPrev) != 0) {
+		close(fdSched);
+		fdSched = -1;
+	}
 	rtmPrdPrev = rt_timer_read();
-	while (1) {
-		rtmPrdCurr = rt_timer_read();
+	while (__atomic_load_n(&Run->phase, __ATOMIC_ACQUIRE) != RUN_DRAIN) {
+		rtmPrdCurr = rt_timer_read(); // start of current iteration
+		if (fdSched >= 0)
+			bench_sched_sample(fdSched, &ssStart);
+		/* iteration 0 runs before the first release */
+		if (iTaskTick > 0)
+			rtmRelease = t->release + (RTIME)(iTaskTick - 1) * CLOCKTICKS(t->prd);
 
-		/* spin the CPU doing nothing until target execution time is reached */
+		/* spin the CPU doing nothing until the demand of this job is reached,
+		 * the last slice is cut to the remainder */
+		TaskExeTime = next_rt_exec(&t->exec);
 		task_runtime = 0;
 		while(task_runtime < TaskExeTime){
-			acquire_rt_mutex(&lock);
-			rt_timer_spin(TaskSpinTime);
-			task_runtime += TaskSpinTime;
-			release_rt_mutex(&lock);
-			// rt_printf("1\n");
+			RTIME slice = (TaskExeTime - task_runtime < TaskSpinTime) ? TaskExeTime - task_runtime : TaskSpinTime;
+			if (t->lock == on)
+				acquire_rt_mutex(&Run->lock);
+			rt_timer_spin(slice);
+			task_runtime += slice;
+			if (t->lock == on)
+				release_rt_mutex(&Run->lock);
 		}
-		rtmResp = rt_timer_read();
+		rtmResp = rt_timer_read(); // end of execution 
+		if (fdSched >= 0)
+			bench_sched_sample(fdSched, &ssEnd);
 
+		tmPrd = ((int)rtmPrdCurr - (int)rtmPrdPrev);
+		tmResp = ((int)rtmResp - (int)rtmRelease); // from the nominal release
+		tmJtr = MathAbsValI(CLOCKTICKS(t->prd) - tmPrd);
+		if (bCompensate == on)
+			tmResp -= (int)BenchProbe.bias;
 
-			tmPrd = ((int)rtmPrdCurr - (int)rtmPrdPrev);
-			tmResp = ((int)rtmResp - (int)rtmPrdCurr); ; 
-			tmJtr = MathAbsValI(CLOCKTICKS(TASK_1_PRD) - tmPrd);	
+		/* the last task out of its warm-up opens the measurement */
+		if (iTaskTick == WARMUP_JOBS &&
+				__atomic_add_fetch(&Run->warm, 1, __ATOMIC_ACQ_REL) == NUM_TASKS) {
+			int warmup = RUN_WARMUP;
+			__atomic_compare_exchange_n(&Run->phase, &warmup, RUN_MEASURE, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+		}
 
-		if(iTaskTick > 1) // omit "irregular" data at start-up
+		if (__atomic_load_n(&Run->phase, __ATOMIC_ACQUIRE) == RUN_MEASURE)
 		{
-			BufPrd1[iBufCnt1] = tmPrd;
-			BufResp1[iBufCnt1] = tmResp;
-			BufJtr1[iBufCnt1] = tmJtr;
-			++iBufCnt1;
-			
-			if(iBufCnt1 == FULL_BUF)
-				bQuitFlag = ON;
+			if (bSoak == on)
+			{
+				log_rt_recorder(&Recorder, t->rec, tmPrd, tmResp, tmJtr,
+						tmResp > CLOCKTICKS(t->prd) ? on : off);
+				++t->iBufCnt;
+				/* a soak run without duration lasts until ctrl+c */
+				if (bMaster == on && test_duration > 0 && t->iBufCnt == FULL_BUF)
+					RunStop();
+			}
+			else if (t->iBufCnt < t->nBuf)
+			{
+				t->BufPrd[t->iBufCnt] = tmPrd;
+				t->BufResp[t->iBufCnt] = tmResp;
+				t->BufJtr[t->iBufCnt] = tmJtr;
+				t->BufDem[t->iBufCnt] = (int)TaskExeTime;
+				if (fdSched >= 0 && t->iBufCnt < t->nDecomp)
+					DecomposeJob(&t->Decomp[t->iBufCnt], rtmRespPrev > rtmRelease ? rtmRespPrev - rtmRelease : 0,
+							rtmPrdCurr - rtmRelease, rtmResp - rtmRelease, &ssPrev, &ssStart, &ssEnd);
+				++t->iBufCnt;
+
+				if(bMaster == on && t->iBufCnt == FULL_BUF)
+					RunStop();
+			}
 		}
 
-		/* print a dot every one second to check if program is still running */
-		if (!(iTaskTick % TICKS_PER_SEC(CLOCKTICKS(TASK_1_PRD))))
-			printf(".\n");
+		/* print a dot every one second to check if program is still running,
+		 * deferred to the flusher thread so stdio never blocks this loop */
+		if (bMaster == on && !(iTaskTick % TICKS_PER_SEC(CLOCKTICKS(t->prd))))
+			rt_log(".\n");
 
 		rtmPrdPrev = rtmPrdCurr;
+		rtmRespPrev = rtmResp;
+		ssPrev = ssEnd;
 		++iTaskTick;
 
-		if (bQuitFlag == on){
-			delete_rt_task();
-			break;
-		}else
-			wait_rt_period(&TskTest1);
+		if (__atomic_load_n(&Run->phase, __ATOMIC_ACQUIRE) != RUN_DRAIN)
+			wait_rt_period(&t->task);
 	}
+	if (fdSched >= 0)
+		close(fdSched);
+	/* joinable: return instead of delete_rt_task() */
+	bench_signal_done(&t->done);
 }
 /****************************************************************************/
-void TestTask2(void *arg){
-	int iTaskTick = 0;
-	int task_runtime;
-
-	RTIME rtmPrdCurr=0, rtmPrdPrev=0, rtmRespStart=0, rtmResp=0; 
-	int tmPrd=0, tmResp=0, tmJtr=0;
-	int tmMsg = 0;
-
-	RTIME TaskSpinTime = CLOCKTICKS(TASK_TIMESLICE);
-	RTIME TaskExeTime = CLOCKTICKS(TASK_2_EXE);
+int main(int argc, char **argv){
+	int c;
 
-	rtmPrdPrev = rt_timer_read();
-	while (1)
+	/* -b selects the scheduling backend of every task, for a mode too */
+	if (argc > 2 && strcmp(argv[1], "-b") == 0)
 	{
-		rtmPrdCurr = rt_timer_read(); // start of current iteration
-		
-		task_runtime = 0;
-		while(task_runtime < TaskExeTime){
-#ifdef _PREEMPTION_TEST_
-			acquire_rt_mutex(&lock);
-#endif
-			rt_timer_spin(TaskSpinTime);
-			task_runtime += TaskSpinTime;
-#ifdef _PREEMPTION_TEST_
-			release_rt_mutex(&lock);
-#endif
-			// rt_printf("2\n");
-		}
-		rtmResp = rt_timer_read(); // end of execution 
-
-		tmPrd = ((int)rtmPrdCurr - (int)rtmPrdPrev);
-		tmResp = ((int)rtmResp - (int)rtmPrdCurr);
-		tmJtr = MathAbsValI(CLOCKTICKS(TASK_2_PRD) - tmPrd);
-
-		if(iTaskTick > 1) // omit "irregular" data at start-up
+		if (set_rt_backend(argv[2]) != 0)
 		{
-			BufPrd2[iBufCnt2] = tmPrd;
-			BufResp2[iBufCnt2] = tmResp;
-			BufJtr2[iBufCnt2] = tmJtr;
-			++iBufCnt2;
+			printf("unknown backend '%s', one of:\n", argv[2]);
+			print_rt_backends(stdout);
+			return 1;
 		}
-		rtmPrdPrev = rtmPrdCurr;
-		iTaskTick++;
-
-		if (bQuitFlag == on)
-		{
-			delete_rt_task();
-			break;
-		}
-		else
-			wait_rt_period(&TskTest2);
-   	}
-}
-/****************************************************************************/
-#ifdef _PREEMPTION_TEST_
-void TestTask3(void *arg){
-	int iTaskTick = 0;
-	int task_runtime;
-
-	RTIME rtmPrdCurr=0, rtmPrdPrev=0, rtmRespStart=0, rtmResp=0; 
-	int tmPrd=0, tmResp=0, tmJtr=0;
-	int tmMsg = 0;
-
-	RTIME TaskSpinTime = CLOCKTICKS(TASK_TIMESLICE);
-	RTIME TaskExeTime = CLOCKTICKS(TASK_3_EXE);
+		argc -= 2;
+		argv += 2;
+	}
 
-	rtmPrdPrev = rt_timer_read();
-	while (1)
+	if (argc > 1)
 	{
-		rtmPrdCurr = rt_timer_read(); // start of current iteration
-		
-		task_runtime = 0;
-		while(task_runtime < TaskExeTime){
-#ifdef _PREEMPTION_TEST_
-			acquire_rt_mutex(&lock);
-#endif
-			rt_timer_spin(TaskSpinTime);
-			task_runtime += TaskSpinTime;
-#ifdef _PREEMPTION_TEST_
-			release_rt_mutex(&lock);
+		for (c = 0; BenchModes[c].name != NULL; ++c)
+			if (strcmp(argv[1], BenchModes[c].name) == 0)
+			{
+#ifndef _XENOMAI_TASKS_
+				/* a task blocking elsewhere would stall the simulated cpu */
+				if (PtBackend->simulated == on && BenchModes[c].sim == off)
+				{
+					printf("%s is not simulated, run it on a kernel backend\n", BenchModes[c].name);
+					return 1;
+				}
 #endif
-			// rt_printf("3\n");
-		}
-		
-		rtmResp = rt_timer_read(); // end of execution 
-
-		tmPrd = ((int)rtmPrdCurr - (int)rtmPrdPrev);
-		tmResp = ((int)rtmResp - (int)rtmPrdCurr);
-		tmJtr = MathAbsValI(CLOCKTICKS(TASK_3_PRD) - tmPrd);
+				return BenchModes[c].run(argc - 1, argv + 1);
+			}
 
-		if(iTaskTick > 1) // omit "irregular" data at start-up
-		{
-			BufPrd3[iBufCnt3] = tmPrd;
-			BufResp3[iBufCnt3] = tmResp;
-			BufJtr3[iBufCnt3] = tmJtr;
-			++iBufCnt3;
-		}
-		rtmPrdPrev = rtmPrdCurr;
-		iTaskTick++;
+		printf("usage: %s [-b backend] [mode] [options]\n", argv[0]);
+		for (c = 0; BenchModes[c].name != NULL; ++c)
+			printf("  %-10s %s\n", BenchModes[c].name, BenchModes[c].desc);
+		printf("backends:\n");
+		print_rt_backends(stdout);
+		return 1;
+	}
 
-		if (bQuitFlag == on)
-		{
-			delete_rt_task();
-			break;
-		}
-		else
-			wait_rt_period(&TskTest3);
-   	}
+	TimingInit();
+	if (SetPhasing(Phasing) != 0)
+		return 1;
+	return RunTest();
 }
-#endif
 /****************************************************************************/
-int main(int argc, char **argv){
-	int c, err;
+int RunTest(){
+	int i, nstarted;
+
+	__atomic_store_n(&Run->phase, RUN_WARMUP, __ATOMIC_RELEASE);
+	Run->warm = 0;
+	for (i = 0; i < NUM_TASKS; ++i) {
+		TestTasks[i].iBufCnt = 0;
+		TestTasks[i].done = 0;
+	}
+	if (SetExeModels() != 0 || AllocDecomp() != 0)
+		return 1;
 
 	/* Interrupt Handler "ctrl+c"  */
 	signal(SIGTERM, SignalHandler);
 	signal(SIGINT, SignalHandler);
 
 	/* init mutex */
-	if (create_rt_mutex(&lock, NULL) != 0)
+	if ((bProcess == on ? create_rt_mutex_shared(&Run->lock, NULL) : create_rt_mutex(&Run->lock, NULL)) != 0)
     {
         printf("\n mutex init failed\n");
         return 1;
@@ -303,53 +474,405 @@ int main(int argc, char **argv){
 
 	/* RT-tasks */
 	mlockall(MCL_CURRENT|MCL_FUTURE); 
-	XenoInit();
-	XenoStart();
 
-	while (1) {
-		usleep(1);
-		if (bQuitFlag==ON) break;
+	/* every task is released on the same time grid */
+	rtmEpoch = rt_timer_read() + RELEASE_DELAY;
+	bench_meta("release_epoch_ns: %lu", (unsigned long)rtmEpoch);
+	/* response times are measured from the nominal release, not the wakeup */
+	bench_meta("resp_origin: release");
+
+	if (bProcess == on)
+		ForkTasks();
+	else
+	{
+		if (XenoInit() != 0) {
+			delete_rt_mutex(&Run->lock);
+			return 1;
+		}
+		init_rt_log(NUM_TASKS, LOG_DEPTH);
+		nstarted = XenoStart();
+
+		/* main sleeps until the drain, no wakeups of its own during the run */
+		for (i = 0; i < nstarted; ++i)
+			if (bench_wait_done(&TestTasks[i].done) == 0)
+				join_rt_task(&TestTasks[i].task);
+		stop_rt_log();
+	}
+	bench_sim_report();
+	if (bSoak == off) {
+		PrintDemandTracking();
+		PrintDecomposition();
 	}
 
-	FilePrintEval(sTaskName1,BufPrd1,BufResp1,BufJtr1,iBufCnt1);
-	FilePrintEval(sTaskName2,BufPrd2,BufResp2,BufJtr2,iBufCnt2);
-#ifdef _PREEMPTION_TEST_
-	FilePrintEval(sTaskName3,BufPrd3,BufResp3,BufJtr3,iBufCnt3);
+	if (bSoak == off && bPhase == off)
+		for (i = 0; i < NUM_TASKS; ++i) {
+			FilePrintEval(TestTasks[i].name,TestTasks[i].BufPrd,TestTasks[i].BufResp,TestTasks[i].BufJtr,
+					is_rt_exec_fixed(&TestTasks[i].exec) == on ? NULL : TestTasks[i].BufDem,TestTasks[i].iBufCnt);
+			DecompPrintEval(&TestTasks[i]);
+		}
+	delete_rt_mutex(&Run->lock);
+	for (i = 0; i < NUM_TASKS; ++i) {
+		delete_rt_exec(&TestTasks[i].exec);
+		RunFree(TestTasks[i].Decomp, TestTasks[i].nDecomp * sizeof(JOB_DECOMP));
+		TestTasks[i].Decomp = NULL;
+	}
+	return 0;
+}
+/****************************************************************************/
+/* ./start.sh soak [-d seconds, 0 = until ctrl+c] [-j jitter_us] [-r resp_us]
+ *                 [-w window_s] [-b events_before] [-a events_after] [-c]
+ *                 [-p sync|stagger|phases] [-x task=exe_model] */
+int SoakMain(int argc, char **argv){
+	char prefix[200];
+	char filename[256];
+	int jtr_limit = 100, resp_limit = 0; // us, deadline misses always trigger
+	int window = REC_WINDOW, pre = REC_PRE, post = REC_POST;
+	int c, i, k = 1, ret;
+
+	test_duration = 0;
+	optind = 1;
+	while ((c = getopt(argc, argv, "d:j:r:w:b:a:cp:x:h")) != -1) {
+		switch (c) {
+			case 'd': test_duration = atoi(optarg); break;
+			case 'j': jtr_limit = atoi(optarg); break;
+			case 'r': resp_limit = atoi(optarg); break;
+			case 'w': window = atoi(optarg); break;
+			case 'b': pre = atoi(optarg); break;
+			case 'a': post = atoi(optarg); break;
+			case 'c': bCompensate = on; break;
+			case 'p': Phasing = optarg; break;
+			case 'x':
+				if (ParseExeModel(optarg) != 0)
+					return 1;
+				break;
+			default:
+				printf("usage: soak [-d sec] [-j jitter_us] [-r resp_us] [-w window_sec] [-b pre] [-a post] [-c]\n");
+				printf("            [-p sync|stagger|phase,...] [-x task=exe_model]...\n");
+				return 1;
+		}
+	}
+
+	if (create_rt_recorder(&Recorder, REC_DEPTH, pre, post, (RTIME)window * NSEC_PER_SEC) != 0)
+	{
+		printf("\n flight recorder init failed\n");
+		return 1;
+	}
+	set_rt_recorder_limits(&Recorder, jtr_limit * NSEC_PER_USEC, resp_limit * NSEC_PER_USEC);
+	for (i = 0; i < NUM_TASKS; ++i)
+		TestTasks[i].rec = add_rt_recorder_task(&Recorder, TestTasks[i].name);
+
+	do {
+		snprintf(prefix, sizeof(prefix), "%ssoak%s_%d", FILE_PATH, TEST_NAME, k++);
+		snprintf(filename, sizeof(filename), "%s_summary.dat", prefix);
+	} while (_file_existence(filename) == 0);
+
+	/* the summary file is opened by start_rt_recorder(), calibrate first */
+	TimingInit();
+	if (SetPhasing(Phasing) != 0)
+		return 1;
+	set_rt_recorder_meta(&Recorder, bench_meta_text());
+	if (start_rt_recorder(&Recorder, prefix) != 0)
+		return 1;
+
+	bSoak = on;
+	ret = RunTest();
+	stop_rt_recorder(&Recorder);
+	delete_rt_recorder(&Recorder);
+	return ret;
+}
+/****************************************************************************/
+/* ./start.sh phase [-d seconds per phasing] [-p sync|stagger|phases]...
+ *                  [-x task=exe_model]...
+ * runs the test once per phasing (default sync, then stagger) */
+#define PHASE_MAX_RUNS (8)
+int PhaseMain(int argc, char **argv){
+	char *phasings[PHASE_MAX_RUNS] = {"sync", "stagger"};
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[NUM_TASKS];
+	RTIME worst[PHASE_MAX_RUNS][NUM_TASKS];
+	int nphasings = 0, c, i, k, n;
+	FILE *summary, *fp;
+
+	test_duration = 10;
+	optind = 1;
+	while ((c = getopt(argc, argv, "d:p:x:h")) != -1) {
+		switch (c) {
+			case 'd': test_duration = atoi(optarg); break;
+			case 'p':
+				if (nphasings < PHASE_MAX_RUNS)
+					phasings[nphasings++] = optarg;
+				break;
+			case 'x':
+				if (ParseExeModel(optarg) != 0)
+					return 1;
+				break;
+			default:
+				printf("usage: phase [-d sec] [-p sync|stagger|phase,...]... [-x task=exe_model]...\n");
+				return 1;
+		}
+	}
+	if (nphasings == 0)
+		nphasings = 2;
+
+	bPhase = on;
+	TimingInit();
+	summary = bench_open_result("phase_summary", filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# phasing,task,phase_jiffies,count,resp_min_ns,resp_p50_ns,resp_p99_ns,resp_max_ns,misses\n");
+
+	for (k = 0; k < nphasings && bBenchQuit == off; ++k) {
+		if (SetPhasing(phasings[k]) != 0)
+			break;
+		printf("Phasing %s, %d sec\n", phasings[k], test_duration);
+		RunTest();
+
+		print_rt_hist_header(stdout);
+		for (i = 0; i < NUM_TASKS; ++i) {
+			init_rt_hist(&PhaseHists[i], TestTasks[i].name);
+			for (c = 0, n = 0; n < TestTasks[i].iBufCnt; ++n) {
+				add_rt_hist(&PhaseHists[i], TestTasks[i].BufResp[n] > 0 ? TestTasks[i].BufResp[n] : 0);
+				if (TestTasks[i].BufResp[n] > CLOCKTICKS(TestTasks[i].prd))
+					++c;
+			}
+			print_rt_hist(stdout, &PhaseHists[i]);
+			fprintf(summary, "%s,%s,%g,%lu,%lu,%lu,%lu,%lu,%d\n", phasings[k], TestTasks[i].name,
+					TestTasks[i].phase, (unsigned long)PhaseHists[i].count, (unsigned long)PhaseHists[i].min,
+					(unsigned long)get_rt_hist_percentile(&PhaseHists[i], 50),
+					(unsigned long)get_rt_hist_percentile(&PhaseHists[i], 99),
+					(unsigned long)PhaseHists[i].max, c);
+			worst[k][i] = PhaseHists[i].max;
+			hists[i] = &PhaseHists[i];
+		}
+
+		snprintf(name, sizeof(name), "phase%s_%s_hist", TEST_NAME, isdigit(phasings[k][0]) ? "custom" : phasings[k]);
+		fp = bench_open_result(name, NULL, 0);
+		if (fp != NULL) {
+			write_rt_hist(fp, hists, NUM_TASKS);
+			fclose(fp);
+		}
+	}
+	fclose(summary);
+
+	printf("Worst-case response [us]\n%-10s", "");
+	for (n = 0; n < k; ++n)
+		printf(" %12.12s", phasings[n]);
+	printf("\n");
+	for (i = 0; i < NUM_TASKS; ++i) {
+		printf("%-10s", TestTasks[i].name);
+		for (n = 0; n < k; ++n)
+			printf(" %12.3f", worst[n][i] / 1000.0);
+		printf("\n");
+	}
+	printf("Phasing summary datafile is generated at:%s\n", filename);
+	return 0;
+}
+/****************************************************************************/
+/* ./start.sh process [-d seconds per layout] [-m thread|process]...
+ *                    [-p sync|stagger|phases] [-x task=exe_model]...
+ * runs the test once per task layout (default thread, then process) */
+#define LAYOUT_MAX_RUNS (4)
+int ProcessMain(int argc, char **argv){
+	char *layouts[LAYOUT_MAX_RUNS] = {"thread", "process"};
+	char name[128];
+	char filename[256];
+	RT_HIST *hists[NUM_TASKS];
+	RTIME p99[LAYOUT_MAX_RUNS][NUM_TASKS], worst[LAYOUT_MAX_RUNS][NUM_TASKS];
+	int nlayouts = 0, c, i, k, n;
+	FILE *summary, *fp;
+
+#ifdef _XENOMAI_TASKS_
+	printf("process mode needs the POSIX tasks\n");
+	return 1;
 #endif
-	delete_rt_mutex(&lock);
+	test_duration = 10;
+	optind = 1;
+	while ((c = getopt(argc, argv, "d:m:p:x:h")) != -1) {
+		switch (c) {
+			case 'd': test_duration = atoi(optarg); break;
+			case 'm':
+				if (strcmp(optarg, "thread") != 0 && strcmp(optarg, "process") != 0) {
+					printf("unknown layout '%s', use thread or process\n", optarg);
+					return 1;
+				}
+				if (nlayouts < LAYOUT_MAX_RUNS)
+					layouts[nlayouts++] = optarg;
+				break;
+			case 'p': Phasing = optarg; break;
+			case 'x':
+				if (ParseExeModel(optarg) != 0)
+					return 1;
+				break;
+			default:
+				printf("usage: process [-d sec] [-m thread|process]... [-p sync|stagger|phase,...] [-x task=exe_model]...\n");
+				return 1;
+		}
+	}
+	if (nlayouts == 0)
+		nlayouts = 2;
+	if (test_duration < 1)
+		test_duration = 1;
+
+	bPhase = on; // no raw files, as in phase mode
+	TimingInit();
+	if (SetPhasing(Phasing) != 0)
+		return 1;
+	summary = bench_open_result("process_summary", filename, sizeof(filename));
+	if (summary == NULL)
+		return 1;
+	fprintf(summary, "# layout,task,count,resp_min_ns,resp_p50_ns,resp_p99_ns,resp_max_ns,misses\n");
+
+	for (k = 0; k < nlayouts && bBenchQuit == off; ++k) {
+		if (SetLayout(strcmp(layouts[k], "process") == 0 ? on : off) != 0)
+			break;
+		printf("Layout %s, %d sec\n", layouts[k], test_duration);
+		if (RunTest() != 0)
+			break;
+
+		print_rt_hist_header(stdout);
+		for (i = 0; i < NUM_TASKS; ++i) {
+			init_rt_hist(&PhaseHists[i], TestTasks[i].name);
+			for (c = 0, n = 0; n < TestTasks[i].iBufCnt; ++n) {
+				add_rt_hist(&PhaseHists[i], TestTasks[i].BufResp[n] > 0 ? TestTasks[i].BufResp[n] : 0);
+				if (TestTasks[i].BufResp[n] > CLOCKTICKS(TestTasks[i].prd))
+					++c;
+			}
+			print_rt_hist(stdout, &PhaseHists[i]);
+			p99[k][i] = get_rt_hist_percentile(&PhaseHists[i], 99);
+			worst[k][i] = PhaseHists[i].max;
+			fprintf(summary, "%s,%s,%lu,%lu,%lu,%lu,%lu,%d\n", layouts[k], TestTasks[i].name,
+					(unsigned long)PhaseHists[i].count, (unsigned long)PhaseHists[i].min,
+					(unsigned long)get_rt_hist_percentile(&PhaseHists[i], 50),
+					(unsigned long)p99[k][i], (unsigned long)worst[k][i], c);
+			hists[i] = &PhaseHists[i];
+		}
+
+		snprintf(name, sizeof(name), "process%s_%s_hist", TEST_NAME, layouts[k]);
+		fp = bench_open_result(name, NULL, 0);
+		if (fp != NULL) {
+			write_rt_hist(fp, hists, NUM_TASKS);
+			fclose(fp);
+		}
+	}
+	fclose(summary);
+	SetLayout(off);
+
+	printf("Response p99 / max [us]\n%-10s", "");
+	for (n = 0; n < k; ++n)
+		printf(" %21.21s", layouts[n]);
+	printf("\n");
+	for (i = 0; i < NUM_TASKS; ++i) {
+		printf("%-10s", TestTasks[i].name);
+		for (n = 0; n < k; ++n)
+			printf(" %10.3f %10.3f", p99[n][i] / 1000.0, worst[n][i] / 1000.0);
+		printf("\n");
+	}
+	printf("Layout summary datafile is generated at:%s\n", filename);
 	return 0;
 }
 /****************************************************************************/
+int SetPhasing(char *phasing){
+	char phases[128];
+	char *tok, *end;
+	float phase = 0;
+	int i, len = 0;
+
+	if (strcmp(phasing, "sync") == 0) {
+		for (i = 0; i < NUM_TASKS; ++i)
+			TestTasks[i].phase = 0;
+	} else if (strcmp(phasing, "stagger") == 0) {
+		/* the tasks are listed by decreasing priority, each one is released
+		 * once the jobs released before it are done */
+		for (i = 0; i < NUM_TASKS; ++i) {
+			TestTasks[i].phase = phase;
+			phase += TestTasks[i].exe;
+		}
+	} else {
+		tok = phasing;
+		for (i = 0; i < NUM_TASKS; ++i) {
+			TestTasks[i].phase = strtof(tok, &end);
+			if (end == tok || TestTasks[i].phase < 0 || TestTasks[i].phase >= TestTasks[i].prd) {
+				printf("invalid phasing '%s', use sync, stagger or %d phases in jiffies below each period\n",
+						phasing, NUM_TASKS);
+				return -EINVAL;
+			}
+			tok = (*end == ',') ? end + 1 : end;
+		}
+	}
+
+	for (i = 0; i < NUM_TASKS; ++i)
+		len += snprintf(phases + len, sizeof(phases) - len, "%s%g", i ? "," : "", TestTasks[i].phase);
+	bench_meta("phasing: %s", phasing);
+	bench_meta("phase_jiffies: %s", phases);
+	return 0;
+}
+/****************************************************************************/
+void TimingInit(){
+	/* profile the host, then select the clock and calibrate on the cpu the
+	 * test tasks are pinned to */
+	bench_host_init();
+	TestCpu = bench_select_cpu(TEST_CPU);
+	bench_meta("rt_cpu: %d", TestCpu);
+	bench_meta("backend: %s", get_rt_backend());
+	bench_sim_init();
+	bench_clock_init(TestCpu);
+	bench_calibrate(TestCpu);
+	bench_meta("probe_compensation: %s", bCompensate == on ? "on" : "off");
+}
+/****************************************************************************/
+void RunStop(){
+	__atomic_store_n(&Run->phase, RUN_DRAIN, __ATOMIC_RELEASE);
+}
+/****************************************************************************/
 void SignalHandler(int signum){
-		bQuitFlag=on;
+		RunStop();
+		bench_quit(); // also ends the remaining runs of a phase comparison
 }
 /****************************************************************************/
-void XenoInit(){
+int XenoInit(){
+	int i;
+
 	printf("Creating Real-time task(s)...");
-	create_rt_task(&TskTest1,sTaskName1, TASK_1_PRIO);
-	create_rt_task(&TskTest2,sTaskName2, TASK_2_PRIO);
-#ifdef _PREEMPTION_TEST_
-	create_rt_task(&TskTest3,sTaskName3, TASK_3_PRIO);
-#endif
+	for (i = 0; i < NUM_TASKS; ++i) {
+		if (create_rt_task_joinable(&TestTasks[i].task,TestTasks[i].name, TestTasks[i].prio) != 0) {
+			printf("failed!\n");
+			while (--i >= 0)
+				discard_rt_task(&TestTasks[i].task);
+			return -1;
+		}
+		set_rt_task_affinity(&TestTasks[i].task, TestCpu);
+		set_rt_task_budget(&TestTasks[i].task, CLOCKTICKS(TestTasks[i].exe * TASK_BUDGET),
+				CLOCKTICKS(TestTasks[i].prd));
+	}
 	printf("OK!\n");
 
 	printf("Making Real-time task(s) Periodic...");
-	set_rt_task_period(&TskTest1,CLOCKTICKS(TASK_1_PRD));
-	set_rt_task_period(&TskTest2,CLOCKTICKS(TASK_2_PRD));
-#ifdef _PREEMPTION_TEST_
-	set_rt_task_period(&TskTest3,CLOCKTICKS(TASK_3_PRD));
-#endif
+	for (i = 0; i < NUM_TASKS; ++i) {
+		TestTasks[i].release = rtmEpoch + CLOCKTICKS(TestTasks[i].phase);
+		set_rt_task_release(&TestTasks[i].task,TestTasks[i].release,CLOCKTICKS(TestTasks[i].prd));
+	}
 	printf("OK!\n");
+	return 0;
 }
 /****************************************************************************/
-void XenoStart(){
+/* the number of started tasks, a failed start drains the ones before it
+ * and discards the ones after it */
+int XenoStart(){
+	int i, k;
+
 	printf("Starting Xenomai Real-time Task(s)...");
-	start_rt_task(1,&TskTest1,&TestTask1);
-	start_rt_task(1,&TskTest2,&TestTask2);
-#ifdef _PREEMPTION_TEST_
-	start_rt_task(1,&TskTest3,&TestTask3);
-#endif
+	for (i = 0; i < NUM_TASKS; ++i)
+		if (start_rt_task_arg(1,&TestTasks[i].task,&TestTask,&TestTasks[i]) != 0) {
+			printf("failed!\n");
+			for (k = i + 1; k < NUM_TASKS; ++k)
+				discard_rt_task(&TestTasks[k].task);
+			RunStop();
+			bBenchQuit = on;
+			return i;
+		}
 	printf("OK!\n");
+	return NUM_TASKS;
 }
 /****************************************************************************/
 int _file_existence(char* filenames)
@@ -357,26 +880,31 @@ int _file_existence(char* filenames)
 	return access(filenames,F_OK); 
 }
 /****************************************************************************/
-void _filePrintEval(char *FileName,int BufPrd[], int BufExe[], int BufJit[], int ArraySize){
+/* period,response,jitter per job, the demand as a 4th column when it varies */
+void _filePrintEval(char *FileName,int BufPrd[], int BufExe[], int BufJit[], int BufDem[], int ArraySize){
 	FILE *fptemp;
 	int iCnt;
 
 	fptemp = fopen(FileName, "w");
+	bench_write_meta(fptemp);
 
 	for(iCnt=0; iCnt < ArraySize; ++iCnt)
 	{
-		fprintf(fptemp,"%d.%06d,%d.%06d,%d.%06d\n",
+		fprintf(fptemp,"%d.%06d,%d.%06d,%d.%06d",
 				BufPrd[iCnt]/CLOCKTICKS(1),
 				BufPrd[iCnt]%CLOCKTICKS(1),
 				BufExe[iCnt]/CLOCKTICKS(1),
 				BufExe[iCnt]%CLOCKTICKS(1),
 				BufJit[iCnt]/CLOCKTICKS(1),
 				BufJit[iCnt]%CLOCKTICKS(1));
+		if (BufDem != NULL)
+			fprintf(fptemp,",%d.%06d", BufDem[iCnt]/CLOCKTICKS(1), BufDem[iCnt]%CLOCKTICKS(1));
+		fprintf(fptemp,"\n");
 	}
 	fclose(fptemp);
 }
 /****************************************************************************/
-void FilePrintEval(char *task_name,int BufPrd[], int BufExe[], int BufJit[],int ArraySize)
+void FilePrintEval(char *task_name,int BufPrd[], int BufExe[], int BufJit[], int BufDem[], int ArraySize)
 {
 	char task_filename[100];
 	char number_buffer[32];
@@ -392,7 +920,7 @@ void FilePrintEval(char *task_name,int BufPrd[], int BufExe[], int BufJit[],int
 	while(1)
 	{
 		if(_file_existence(task_filename) == -1){
-			_filePrintEval(task_filename,BufPrd,BufExe,BufJit,ArraySize);
+			_filePrintEval(task_filename,BufPrd,BufExe,BufJit,BufDem,ArraySize);
 			break;
 		}
 		else{
@@ -406,4 +934,327 @@ void FilePrintEval(char *task_name,int BufPrd[], int BufExe[], int BufJit[],int
 	}
 	printf("Performance analysis datafile is generated at:%s\n",task_filename);
 }
-/***************************************************************************/
\ No newline at end of file
+/***************************************************************************/
+int SetExeModels(){
+	char key[32];
+	int i, ret;
+
+	for (i = 0; i < NUM_TASKS; ++i) {
+		ret = parse_rt_exec(&TestTasks[i].exec, TestTasks[i].exe_model, CLOCKTICKS(TestTasks[i].exe),
+				JIFFY_TO_USE, CLOCKTICKS(TestTasks[i].prd), EXE_SEED + i);
+		if (ret != 0) {
+			printf("invalid execution time model '%s' of %s\n", TestTasks[i].exe_model, TestTasks[i].name);
+			return ret;
+		}
+		snprintf(key, sizeof(key), "exe_model_%s", TestTasks[i].name);
+		bench_meta("%s: %s", key, TestTasks[i].exec.spec);
+	}
+	return 0;
+}
+/***************************************************************************/
+/* "n=spec" from the command line, n counts the tasks from 1 */
+int ParseExeModel(char *arg){
+	char *eq = strchr(arg, '=');
+	int n = atoi(arg);
+
+	if (eq == NULL || n < 1 || n > NUM_TASKS) {
+		printf("use -x n=model with n of 1..%d\n", NUM_TASKS);
+		return -EINVAL;
+	}
+	TestTasks[n - 1].exe_model = eq + 1;
+	return 0;
+}
+/***************************************************************************/
+/* how the response follows the demand of the job: correlation and the
+ * interference (response - demand) of the tasks with a varying demand */
+void PrintDemandTracking(){
+	RT_HIST interf;
+	double sd, sr, sdd, srr, sdr, n, r;
+	int i, k;
+
+	for (i = 0; i < NUM_TASKS; ++i) {
+		TEST_TASK *t = &TestTasks[i];
+
+		if (is_rt_exec_fixed(&t->exec) == on || t->iBufCnt < 2)
+			continue;
+		init_rt_hist(&interf, t->name);
+		sd = sr = sdd = srr = sdr = 0;
+		for (k = 0; k < t->iBufCnt; ++k) {
+			sd += t->BufDem[k];
+			sr += t->BufResp[k];
+			sdd += (double)t->BufDem[k] * t->BufDem[k];
+			srr += (double)t->BufResp[k] * t->BufResp[k];
+			sdr += (double)t->BufDem[k] * t->BufResp[k];
+			add_rt_hist(&interf, t->BufResp[k] > t->BufDem[k] ? t->BufResp[k] - t->BufDem[k] : 0);
+		}
+		n = t->iBufCnt;
+		r = (n * sdd - sd * sd) > 0 && (n * srr - sr * sr) > 0 ?
+				(n * sdr - sd * sr) / sqrt((n * sdd - sd * sd) * (n * srr - sr * sr)) : 0;
+		printf("%s (%s): demand mean %.3f ms, response mean %.3f ms, correlation %.3f, "
+				"interference p50 %.3f p99 %.3f max %.3f ms\n", t->name, t->exec.spec,
+				sd / n / NSEC_PER_MSEC, sr / n / NSEC_PER_MSEC, r,
+				get_rt_hist_percentile(&interf, 50) / (double)NSEC_PER_MSEC,
+				get_rt_hist_percentile(&interf, 99) / (double)NSEC_PER_MSEC, interf.max / (double)NSEC_PER_MSEC);
+	}
+}
+/***************************************************************************/
+/* per job decomposition buffers of a buffered run, sized for its duration
+ * plus the drain */
+int AllocDecomp(){
+	int i;
+
+	for (i = 0; i < NUM_TASKS; ++i) {
+		TestTasks[i].Decomp = NULL;
+		TestTasks[i].nDecomp = 0;
+	}
+	if (DECOMP == off || bSoak == on)
+		return 0;
+	i = bench_sched_open();
+	if (i < 0) {
+		bench_meta("decomposition: off");
+		return 0;
+	}
+	close(i);
+	bench_meta("decomposition: on");
+
+	for (i = 0; i < NUM_TASKS; ++i) {
+		int n = SEC_TO_BUF(test_duration + 1, TestTasks[i].prd);
+
+		TestTasks[i].Decomp = RunAlloc((n > MAX_BUF ? MAX_BUF : n) * sizeof(JOB_DECOMP));
+		if (TestTasks[i].Decomp == NULL) {
+			printf("\n decomposition buffers failed\n");
+			return -ENOMEM;
+		}
+		TestTasks[i].nDecomp = n > MAX_BUF ? MAX_BUF : n;
+	}
+	return 0;
+}
+/***************************************************************************/
+/* prev is taken at the end of the previous job: the runnable time up to the
+ * start of this one is the part of the release delay spent preempted */
+void DecomposeJob(JOB_DECOMP *d, RTIME backlog, RTIME delay, RTIME resp, BENCH_SCHED *prev, BENCH_SCHED *start, BENCH_SCHED *end){
+	int64_t wait_release = (int64_t)(start->wait - prev->wait);
+	int64_t blocked;
+
+	if (backlog > delay)
+		backlog = delay;
+	if (wait_release > (int64_t)(delay - backlog))
+		wait_release = delay - backlog;
+	d->backlog = (int)backlog;
+	d->wake = (int)((int64_t)(delay - backlog) - wait_release);
+	d->run = (int)(end->run - start->run);
+	d->wait = (int)(wait_release + (int64_t)(end->wait - start->wait));
+	blocked = (int64_t)resp - d->backlog - d->wake - d->run - d->wait;
+	d->blocked = blocked > 0 ? (int)blocked : 0;
+	d->nvcsw = (short)(end->nvcsw - start->nvcsw);
+	d->nivcsw = (short)(end->nivcsw - start->nivcsw);
+}
+/***************************************************************************/
+void DecompPrintEval(TEST_TASK *t){
+	char name[128];
+	char filename[256];
+	FILE *fp;
+	int k, n;
+
+	if (t->Decomp == NULL)
+		return;
+	snprintf(name, sizeof(name), "decomp_%s%s", t->name, TEST_NAME);
+	fp = bench_open_result(name, filename, sizeof(filename));
+	if (fp == NULL)
+		return;
+	fprintf(fp, "# resp_ns,demand_ns,backlog_ns,wake_ns,run_ns,wait_ns,blocked_ns,nvcsw,nivcsw\n");
+	n = t->iBufCnt < t->nDecomp ? t->iBufCnt : t->nDecomp;
+	for (k = 0; k < n; ++k) {
+		JOB_DECOMP *d = &t->Decomp[k];
+
+		fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d,%d\n", t->BufResp[k], t->BufDem[k],
+				d->backlog, d->wake, d->run, d->wait, d->blocked, d->nvcsw, d->nivcsw);
+	}
+	fclose(fp);
+	printf("Response decomposition datafile is generated at:%s\n", filename);
+}
+/***************************************************************************/
+/* mean of every component over all jobs and over the jobs above the
+ * DECOMP_TAIL percentile of the response, and the largest interference there */
+void PrintDecomposition(){
+	static const char *source[] = {"run time only", "own backlog", "wakeup latency", "preemption", "mutex blocking"};
+	RT_HIST resp;
+	double all[5], tail[5], sw[2], ntail;
+	int i, k, n, src;
+	RTIME limit;
+
+	for (i = 0; i < NUM_TASKS; ++i) {
+		TEST_TASK *t = &TestTasks[i];
+
+		n = t->iBufCnt < t->nDecomp ? t->iBufCnt : t->nDecomp;
+		if (t->Decomp == NULL || n == 0)
+			continue;
+		init_rt_hist(&resp, t->name);
+		for (k = 0; k < n; ++k)
+			add_rt_hist(&resp, t->BufResp[k] > 0 ? t->BufResp[k] : 0);
+		limit = get_rt_hist_percentile(&resp, DECOMP_TAIL);
+		if (limit > resp.max)
+			limit = resp.max; // bucket bound
+
+		memset(all, 0, sizeof(all));
+		memset(tail, 0, sizeof(tail));
+		sw[0] = sw[1] = ntail = 0;
+		for (k = 0; k < n; ++k) {
+			JOB_DECOMP *d = &t->Decomp[k];
+			int part[5] = {d->run, d->backlog, d->wake, d->wait, d->blocked};
+
+			for (src = 0; src < 5; ++src)
+				all[src] += part[src];
+			sw[0] += d->nivcsw;
+			sw[1] += d->nvcsw;
+			if (t->BufResp[k] >= (int)limit) {
+				for (src = 0; src < 5; ++src)
+					tail[src] += part[src];
+				++ntail;
+			}
+		}
+		/* run time is the demand, not interference */
+		for (src = 1, k = 0; src < 5; ++src)
+			if (tail[src] > tail[k] || (k == 0 && tail[src] > 0))
+				k = src;
+		if (ntail == 0)
+			ntail = 1;
+		printf("%s [ms]: run %.3f backlog %.3f wake %.3f wait %.3f blocked %.3f, %.2f preemptions %.2f blockings per job\n",
+				t->name, all[0] / n / NSEC_PER_MSEC, all[1] / n / NSEC_PER_MSEC, all[2] / n / NSEC_PER_MSEC,
+				all[3] / n / NSEC_PER_MSEC, all[4] / n / NSEC_PER_MSEC, sw[0] / n, sw[1] / n);
+		printf("%*s p%d+ %d jobs: run %.3f backlog %.3f wake %.3f wait %.3f blocked %.3f, mostly %s\n",
+				(int)strlen(t->name), "", DECOMP_TAIL, (int)ntail, tail[0] / ntail / NSEC_PER_MSEC,
+				tail[1] / ntail / NSEC_PER_MSEC, tail[2] / ntail / NSEC_PER_MSEC, tail[3] / ntail / NSEC_PER_MSEC,
+				tail[4] / ntail / NSEC_PER_MSEC, source[k]);
+	}
+}
+/***************************************************************************/
+/* buffers the tasks write during a run, shared with their processes in
+ * process mode */
+void* RunAlloc(size_t size){
+	void *p;
+
+	if (bProcess == off)
+		return calloc(1, size);
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	return (p == MAP_FAILED) ? NULL : p;
+}
+/***************************************************************************/
+void RunFree(void *p, size_t size){
+	if (p == NULL)
+		return;
+	if (bProcess == off)
+		free(p);
+	else
+		munmap(p, size);
+}
+/***************************************************************************/
+/* on: the task set, run state and buffers in the shared segment, mapped
+ * once for test_duration; off: back to the static ones */
+int SetLayout(FLAG process){
+	size_t nbuf[NUM_TASKS];
+	int *buf;
+	int i;
+
+	if (process == off) {
+		Run = &RunLocal;
+		TestTasks = TaskSet;
+		bProcess = off;
+		bench_meta("task_layout: thread");
+		return 0;
+	}
+#ifndef _XENOMAI_TASKS_
+	if (PtBackend->simulated == on) {
+		printf("the sim backend runs in one process, no process layout\n");
+		return -ENOTSUP;
+	}
+#endif
+	if (Shared == NULL) {
+		SharedSize = sizeof(RUN_SHARED);
+		for (i = 0; i < NUM_TASKS; ++i) {
+			nbuf[i] = SEC_TO_BUF(test_duration + 1, TaskSet[i].prd);
+			if (nbuf[i] > MAX_BUF)
+				nbuf[i] = MAX_BUF;
+			SharedSize += 4 * nbuf[i] * sizeof(int);
+		}
+		Shared = mmap(NULL, SharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (Shared == MAP_FAILED) {
+			perror("shared segment");
+			Shared = NULL;
+			return -ENOMEM;
+		}
+		memcpy(Shared->tasks, TaskSet, sizeof(TaskSet));
+		buf = (int *)(Shared + 1);
+		for (i = 0; i < NUM_TASKS; ++i) {
+			Shared->tasks[i].BufPrd = buf;
+			Shared->tasks[i].BufResp = buf + nbuf[i];
+			Shared->tasks[i].BufJtr = buf + 2 * nbuf[i];
+			Shared->tasks[i].BufDem = buf + 3 * nbuf[i];
+			Shared->tasks[i].nBuf = nbuf[i];
+			buf += 4 * nbuf[i];
+		}
+	}
+	Run = &Shared->run;
+	TestTasks = Shared->tasks;
+	bProcess = on;
+	bench_meta("task_layout: process");
+	return 0;
+}
+/***************************************************************************/
+/* one process per task, main waits for all of them */
+void ForkTasks(){
+	pid_t pid[NUM_TASKS];
+	int i, status;
+
+	printf("Forking Real-time task process(es)...");
+	fflush(stdout); // not twice from the children
+	for (i = 0; i < NUM_TASKS; ++i) {
+		pid[i] = fork();
+		if (pid[i] == 0)
+			_exit(TaskProcess(&TestTasks[i]));
+		if (pid[i] < 0) {
+			perror("fork");
+			RunStop();
+		}
+	}
+	printf("OK!\n");
+
+	for (i = 0; i < NUM_TASKS; ++i) {
+		if (pid[i] <= 0)
+			continue;
+		if (waitpid(pid[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			printf("%s process failed\n", TestTasks[i].name);
+			RunStop();
+		}
+	}
+}
+/***************************************************************************/
+/* child side: memory locks are not inherited, but MCL_CURRENT would copy
+ * every private page of the parent (the static buffers), so only new
+ * mappings are locked and the inherited pages stay resident through the
+ * locks of the parent; the warm-up jobs take their first-touch faults.
+ * The log flusher is not forked either. */
+int TaskProcess(TEST_TASK *t){
+	mlockall(MCL_FUTURE);
+	init_rt_log(1, LOG_DEPTH);
+
+	if (create_rt_task_joinable(&t->task, t->name, t->prio) != 0) {
+		RunStop();
+		return 1;
+	}
+	set_rt_task_affinity(&t->task, TestCpu);
+	set_rt_task_budget(&t->task, CLOCKTICKS(t->exe * TASK_BUDGET), CLOCKTICKS(t->prd));
+	t->release = rtmEpoch + CLOCKTICKS(t->phase);
+	set_rt_task_release(&t->task, t->release, CLOCKTICKS(t->prd));
+	if (start_rt_task_arg(1, &t->task, &TestTask, t) != 0) {
+		RunStop();
+		stop_rt_log();
+		return 1;
+	}
+
+	if (bench_wait_done(&t->done) == 0)
+		join_rt_task(&t->task);
+	stop_rt_log();
+	return 0;
+}
+/***************************************************************************/